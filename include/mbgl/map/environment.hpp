@@ -17,6 +17,10 @@ class Request;
 class Response;
 struct Resource;
 
+namespace util {
+template <class T> class Async;
+}
+
 enum class ThreadType : uint8_t {
     Unknown    = 0,
     Main       = 1 << 0,
@@ -27,6 +31,10 @@ enum class ThreadType : uint8_t {
 class Environment final : private util::noncopyable {
 public:
     Environment(FileSource&);
+
+    // Requests made through this environment answer in the thread that runs the given loop,
+    // which it doesn't own.
+    Environment(FileSource&, uv_loop_t*);
     ~Environment();
 
     static Environment& Get();
@@ -38,7 +46,19 @@ public:
 
     // #############################################################################################
 
-    // File request APIs
+    // File request APIs. Steps chained to the request returned by request() run in the Map
+    // thread, those chained to requestAsync() in an unknown thread. Canceling a step that waits
+    // for the request cancels the request.
+    util::Async<Response> requestAsync(const Resource&);
+    util::Async<Response> request(const Resource&);
+
+    // Like request(), but when the step completed with a stale response, onUpdate runs in the Map
+    // thread with the revalidated response if it changed. Canceling the step after it completed
+    // cancels the revalidation.
+    util::Async<Response> requestWithUpdates(const Resource&,
+                                             std::function<void(const Response&)> onUpdate);
+
+    // Callback adapters of the above.
     void requestAsync(const Resource&, std::function<void(const Response&)>);
     Request* request(const Resource&, std::function<void(const Response&)>);
     void cancelRequest(Request*);
@@ -163,6 +163,24 @@ public:
     size_t getSourceTileCacheSize() const { return sourceCacheSize; }
     void onLowMemory();
 
+    // Workers
+    // The number of threads that parse tiles. 0 starts one thread per hardware thread, which is
+    // the default. Can be changed while the map is running.
+    void setWorkerThreadCount(size_t);
+    size_t getWorkerThreadCount() const;
+
+    // Pins each worker thread to one of the CPUs that the map's thread may run on, where the
+    // platform supports it. Takes effect on start().
+    void setWorkerCPUAffinity(bool);
+    bool getWorkerCPUAffinity() const;
+
+    // Parses tiles on the worker threads shared by all maps of the process that opt in, instead
+    // of starting threads for this map alone. The maps take turns, so that a busy map doesn't
+    // starve the others. Changing the thread count then resizes the shared threads, and the CPU
+    // affinity setting doesn't apply. Takes effect on start().
+    void setSharedWorkers(bool);
+    bool getSharedWorkers() const;
+
     // Debug
     void setDebug(bool value);
     void toggleDebug();
@@ -0,0 +1,76 @@
+#ifndef MBGL_MAP_OFFLINE_REGION
+#define MBGL_MAP_OFFLINE_REGION
+
+#include <mbgl/util/geo.hpp>
+#include <mbgl/util/noncopyable.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+typedef struct uv_loop_s uv_loop_t;
+
+namespace mbgl {
+
+class FileSource;
+
+struct OfflineRegionDefinition {
+    std::string styleURL;
+    LatLngBounds bounds;
+    uint8_t minZoom = 0;
+    uint8_t maxZoom = 0;
+    float pixelRatio = 1;
+};
+
+// Loads everything a style needs to render a region, from its minimum to its maximum zoom level,
+// ahead of time: the style, the TileJSON and the tiles of its vector and raster sources, its
+// sprites and all glyph ranges of the fonts its symbol layers use. The resources are requested
+// through the file source, which stores them in its file cache. Resources that are fresh in the
+// cache already are answered from it without going to the network, so downloading a region again
+// only fetches what expired since.
+//
+// It doesn't need a Map. It must be used in the thread that runs the loop, which also runs the
+// progress callback.
+class OfflineRegion : private util::noncopyable {
+public:
+    struct Progress {
+        // The resources that finished loading, including the ones that failed to.
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+
+        // The resources known so far. This grows as the style and the TileJSON of its sources
+        // are loaded, and is final once the download is complete.
+        uint64_t total = 0;
+
+        // The size of the responses that were loaded.
+        uint64_t bytes = 0;
+
+        bool complete = false;
+    };
+
+    using Callback = std::function<void(const Progress&)>;
+
+    OfflineRegion(FileSource&, uv_loop_t*, const OfflineRegionDefinition&,
+                  const std::string& accessToken = "");
+
+    // Cancels the download if it is still running.
+    ~OfflineRegion();
+
+    // The number of requests that run at the same time. Defaults to 8.
+    void setMaximumConcurrency(std::size_t);
+
+    // Starts the download. The callback runs each time a resource finished loading.
+    void download(Callback);
+    void cancel();
+
+    const Progress& getProgress() const;
+
+private:
+    class Impl;
+    const std::unique_ptr<Impl> impl;
+};
+
+}
+
+#endif
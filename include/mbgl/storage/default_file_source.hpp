@@ -4,12 +4,17 @@
 #include <mbgl/storage/file_source.hpp>
 #include <mbgl/storage/file_cache.hpp>
 
+#include <chrono>
+#include <cstdint>
+
 namespace mbgl {
 
 namespace util {
 template <typename T> class Thread;
 }
 
+class ResponseCache;
+
 class DefaultFileSource : public FileSource {
 public:
     DefaultFileSource(FileCache *cache, const std::string &root = "");
@@ -23,9 +28,33 @@ public:
 
     void abort(const Environment &env) override;
 
+    // Recent responses are kept in memory, in front of the file cache, up to this many bytes.
+    // Fresh ones are answered without reading the file cache. Defaults to 8 MB, and 0 disables it.
+    void setMemoryCacheSize(std::size_t size);
+
+    // Answers requests with stale responses from the caches right away, and revalidates them in
+    // the background. Requests are notified again if the response changed. Off by default.
+    void setStaleWhileRevalidate(bool enabled);
+
+    // Missing and empty tiles are cached for this long, unless the server says how long they are
+    // valid. Requests for them are answered from the caches meanwhile. Other missing resources,
+    // such as styles or glyphs, are requested again. Defaults to 1 hour.
+    void setNegativeCacheTTL(std::chrono::seconds ttl);
+
+    // At most this many connections are opened to one host, and to all hosts together, where the
+    // HTTP implementation supports it. Requests beyond that wait, and style resources go before
+    // tiles. Requests that share HTTP/2 connections start up to 8 per connection. Defaults to 8
+    // and 16.
+    void setMaximumConnections(std::size_t perHost, std::size_t total);
+
+    // The requests that were answered from memory, and the ones that weren't.
+    uint64_t getMemoryCacheHits() const;
+    uint64_t getMemoryCacheMisses() const;
+
 public:
     class Impl;
 private:
+    const std::unique_ptr<ResponseCache> memoryCache;
     const std::unique_ptr<util::Thread<Impl>> thread;
 };
 
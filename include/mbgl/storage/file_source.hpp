@@ -27,7 +27,9 @@ public:
     using Callback = std::function<void(const Response &)>;
 
     // These can be called from any thread. The callback will be invoked in the loop.
-    // You can only cancel a request from the same thread it was created in.
+    // You can only cancel a request from the same thread it was created in. Without a loop, the
+    // callback is invoked in an arbitrary other thread, and the request can be canceled from any
+    // thread until it was answered for the last time, after which it is gone.
     virtual Request *request(const Resource &resource, uv_loop_t *loop, const Environment &env,
                              Callback callback) = 0;
     virtual void cancel(Request *request) = 0;
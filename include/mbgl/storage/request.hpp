@@ -27,11 +27,14 @@ public:
     Request(const Resource &resource, uv_loop_t *loop, const Environment &env, Callback callback);
 
 public:
-    // May be called from any thread.
-    void notify(const std::shared_ptr<const Response> &response);
+    // May be called from any thread. A request that was notified with a stale response is notified
+    // again once the response was revalidated: with the new response if it changed, or with none.
+    void notify(const std::shared_ptr<const Response> &response, bool stale = false);
     void destruct();
 
-    // May be called only from the thread the Request was created in.
+    // May be called only from the thread the Request was created in, or from any thread if it
+    // has no loop. A request without a loop deletes itself once it was notified for the last
+    // time unless it was canceled before.
     void cancel();
 
 private:
@@ -44,7 +47,11 @@ private:
     struct Canceled;
     std::unique_ptr<Canceled> canceled;
     Callback callback;
+
+    // Guards the response that wasn't passed to the callback yet, and whether more will follow.
+    std::mutex mutex;
     std::shared_ptr<const Response> response;
+    bool done = false;
 
 public:
     const Resource resource;
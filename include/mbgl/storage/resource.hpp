@@ -15,9 +15,21 @@ struct Resource {
         JSON = 4,
     };
 
+    // Prefetched resources, such as those of offline regions, aren't needed to render the map
+    // right away. They are loaded after the regular ones that are waiting.
+    enum class Priority : bool {
+        Regular = false,
+        Prefetch = true,
+    };
+
+    Resource(Kind kind_, const std::string &url_, Priority priority_ = Priority::Regular)
+        : kind(kind_), url(url_), priority(priority_) {}
+
     const Kind kind;
     const std::string url;
+    const Priority priority;
 
+    // The priority doesn't make a resource different from another one.
     inline bool operator==(const Resource &res) const {
         return kind == res.kind && url == res.url;
     }
@@ -1,20 +1,29 @@
 #ifndef MBGL_STORAGE_RESPONSE
 #define MBGL_STORAGE_RESPONSE
 
+#include <cstdint>
+#include <memory>
 #include <string>
 
 namespace mbgl {
 
 class Response {
 public:
-    enum Status : bool { Error, Successful };
+    Response();
+
+    // NotFound responses say that there is nothing at this URL. They are cached like successful
+    // ones, so that missing resources aren't requested again until they expire.
+    enum Status : uint8_t { Error, Successful, NotFound };
 
     Status status = Error;
     std::string message;
     int64_t modified = 0;
     int64_t expires = 0;
     std::string etag;
-    std::string data;
+
+    // The body is immutable, so that the tiles, glyphs and caches that hold on to it share it
+    // instead of copying it. Never null.
+    std::shared_ptr<const std::string> data;
 };
 
 }
@@ -2,8 +2,12 @@
 #define MBGL_STORAGE_DEFAULT_SQLITE_CACHE
 
 #include <mbgl/storage/file_cache.hpp>
+#include <mbgl/util/chrono.hpp>
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace mbgl {
 
@@ -16,13 +20,34 @@ public:
     SQLiteCache(const std::string &path = ":memory:");
     ~SQLiteCache() override;
 
+    // Limits the size of the database in bytes and the number of responses it holds. Once the
+    // cache grows beyond either limit, it evicts responses that expired first, then the ones that
+    // weren't accessed for the longest time. A limit of 0 disables it, which is the default.
+    void setMaximumCacheSize(uint64_t size);
+    void setMaximumCacheEntries(uint64_t entries);
+
+    // Writes are committed in one transaction once `count` of them are pending, or `interval`
+    // after the first of them, whichever comes first. Reads see the writes that aren't committed
+    // yet, and the cache commits them when it is destroyed. A count of 1 commits every write
+    // right away. Defaults to 64 writes or 500 ms.
+    void setWriteBatch(std::size_t count, Duration interval);
+
     // FileCache API
     void get(const Resource &resource, Callback callback) override;
     void put(const Resource &resource, std::shared_ptr<const Response> response, Hint hint) override;
 
 private:
+    class PendingWrites;
     class Impl;
+    class Reader;
+
+    const std::shared_ptr<PendingWrites> pending;
     const std::unique_ptr<util::Thread<Impl>> thread;
+
+    // Reads are spread over the readers once the database is set up. In-memory databases can't
+    // be shared between connections, so the writer answers all reads.
+    std::vector<std::unique_ptr<util::Thread<Reader>>> readers;
+    std::atomic<std::size_t> nextReader { 0 };
 };
 
 }
@@ -2,13 +2,12 @@
 #define MBGL_UTIL_ASYNC_QUEUE
 
 #include "std.hpp"
+#include "mpsc_queue.hpp"
 
 #include <uv.h>
 
-#include <thread>
-#include <mutex>
 #include <functional>
-#include <queue>
+#include <memory>
 #include <string>
 
 
@@ -34,19 +33,13 @@ public:
     }
 
     void send(T &&data) {
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            queue.push(util::make_unique<T>(std::move(data)));
+        if (queue.push(new Node(std::move(data)))) {
+            uv_async_send(&async);
         }
-        uv_async_send(&async);
     }
 
     void send(std::unique_ptr<T> data) {
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            queue.push(std::move(data));
-        }
-        uv_async_send(&async);
+        send(std::move(*data));
     }
 
     void stop() {
@@ -64,28 +57,37 @@ public:
     }
 
 private:
+    // Items are stored in the node that queues them, so that sending allocates once.
+    struct Node {
+        Node(T&& data_) : data(std::move(data_)) {}
+
+        T data;
+        Node* next = nullptr;
+    };
+
     ~AsyncQueue() {
+        // Drop what was sent after the last time the loop processed the queue.
+        Node* node = queue.drain();
+        while (node) {
+            std::unique_ptr<Node> current(node);
+            node = node->next;
+        }
     }
 
     void process() {
-        std::unique_ptr<T> item;
-        while (true) {
-            mutex.lock();
-            if (queue.empty()) {
-                mutex.unlock();
-                break;
-            }
-            item = std::move(queue.front());
-            queue.pop();
-            mutex.unlock();
-            callback(*item);
+        // Processes everything that was sent until now. Items that are sent meanwhile wake up the
+        // loop again.
+        Node* node = queue.drain();
+        while (node) {
+            std::unique_ptr<Node> current(node);
+            node = node->next;
+            callback(current->data);
         }
     }
 
 private:
-    std::mutex mutex;
     uv_async_t async;
-    std::queue<std::unique_ptr<T>> queue;
+    MPSCQueue<Node> queue;
     std::function<void(T &)> callback;
 };
 
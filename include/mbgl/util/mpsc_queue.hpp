@@ -0,0 +1,54 @@
+#ifndef MBGL_UTIL_MPSC_QUEUE
+#define MBGL_UTIL_MPSC_QUEUE
+
+#include <mbgl/util/noncopyable.hpp>
+
+#include <atomic>
+
+namespace mbgl {
+namespace util {
+
+// A lock-free queue that any number of threads push to and a single thread drains. Nodes are
+// linked through their `next` member, so queueing a node doesn't allocate. The consumer takes
+// everything that was pushed so far in one go, which keeps it off the shared head while it
+// processes the batch.
+template <class Node>
+class MPSCQueue : private util::noncopyable {
+public:
+    // Returns whether the queue was empty before, in which case the consumer may need waking up.
+    // Pushing to a queue that isn't empty doesn't need to: the consumer didn't drain it yet.
+    bool push(Node* node) {
+        Node* head = top.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!top.compare_exchange_weak(head, node, std::memory_order_release,
+                                            std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Takes all queued nodes, linked oldest first. Must only be called by the consumer.
+    Node* drain() {
+        Node* node = top.exchange(nullptr, std::memory_order_acquire);
+        Node* oldest = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = oldest;
+            oldest = node;
+            node = next;
+        }
+        return oldest;
+    }
+
+    bool empty() const {
+        return top.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+    // The most recently pushed node.
+    std::atomic<Node*> top { nullptr };
+};
+
+}
+}
+
+#endif
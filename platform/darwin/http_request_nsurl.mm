@@ -54,6 +54,7 @@ public:
     void cancelTimer();
 
     void start();
+    void prioritize();
     void handleResult(NSData *data, NSURLResponse *res, NSError *error);
     void handleResponse();
 
@@ -170,10 +171,25 @@ void HTTPRequestImpl::start() {
                                               NSError *error) { handleResult(data, res, error); }];
         [req release];
         [task retain];
+        prioritize();
         [task resume];
     }
 }
 
+void HTTPRequestImpl::prioritize() {
+    // The session limits the connections per host itself. Style resources go before tiles, and
+    // prefetched resources last.
+    if (!task) {
+        return;
+    } else if (request->prefetch) {
+        task.priority = NSURLSessionTaskPriorityLow;
+    } else if (request->resource.kind != Resource::Kind::Tile) {
+        task.priority = NSURLSessionTaskPriorityHigh;
+    } else {
+        task.priority = NSURLSessionTaskPriorityDefault;
+    }
+}
+
 void HTTPRequestImpl::handleResponse() {
     if (task) {
         [task release];
@@ -301,7 +317,7 @@ void HTTPRequestImpl::handleResult(NSData *data, NSURLResponse *res, NSError *er
         const long responseCode = [(NSHTTPURLResponse *)res statusCode];
 
         response = util::make_unique<Response>();
-        response->data = {(const char *)[data bytes], [data length]};
+        response->data = std::make_shared<std::string>((const char *)[data bytes], [data length]);
 
         NSDictionary *headers = [(NSHTTPURLResponse *)res allHeaderFields];
         NSString *cache_control = [headers objectForKey:@"Cache-Control"];
@@ -339,9 +355,13 @@ void HTTPRequestImpl::handleResult(NSData *data, NSURLResponse *res, NSError *er
                 response->status = Response::Successful;
                 status = ResponseStatus::Successful;
             }
-        } else if (responseCode == 200) {
+        } else if (responseCode == 200 || responseCode == 204) {
             response->status = Response::Successful;
             status = ResponseStatus::Successful;
+        } else if (responseCode == 404) {
+            response->status = Response::NotFound;
+            response->message = "HTTP status code " + std::to_string(responseCode);
+            status = ResponseStatus::PermanentError;
         } else if (responseCode >= 500 && responseCode < 600) {
             // Server errors may be temporary, so back off exponentially.
             response->status = Response::Error;
@@ -398,7 +418,8 @@ void HTTPRequestImpl::restart(uv_timer_t *timer, int) {
 // -------------------------------------------------------------------------------------------------
 
 HTTPRequest::HTTPRequest(DefaultFileSource::Impl *source, const Resource &resource)
-    : SharedRequestBase(source, resource) {
+    : SharedRequestBase(source, resource),
+      prefetch(resource.priority == Resource::Priority::Prefetch) {
 }
 
 HTTPRequest::~HTTPRequest() {
@@ -416,6 +437,15 @@ void HTTPRequest::start(uv_loop_t *loop, std::shared_ptr<const Response> respons
     ptr = new HTTPRequestImpl(this, loop, response);
 }
 
+void HTTPRequest::prioritize() {
+    MBGL_VERIFY_THREAD(tid);
+
+    prefetch = false;
+    if (ptr) {
+        reinterpret_cast<HTTPRequestImpl *>(ptr)->prioritize();
+    }
+}
+
 void HTTPRequest::retryImmediately() {
     MBGL_VERIFY_THREAD(tid);
 
@@ -136,8 +136,10 @@ void AssetRequestImpl::fileStated(uv_fs_t *req) {
 #endif
             self->response->etag = std::to_string(stat->st_ino);
             const auto size = (unsigned int)(stat->st_size);
-            self->response->data.resize(size);
-            self->buffer = uv_buf_init(const_cast<char *>(self->response->data.data()), size);
+            // The file is read into the data of the response directly.
+            auto data = std::make_shared<std::string>(size, '\0');
+            self->buffer = uv_buf_init(&(*data)[0], size);
+            self->response->data = std::move(data);
             uv_fs_req_cleanup(req);
 #if UV_VERSION_MAJOR == 0 && UV_VERSION_MINOR <= 10
             uv_fs_read(req->loop, req, self->fd, self->buffer.base, self->buffer.len, -1, fileRead);
@@ -14,9 +14,11 @@
 #include <openssl/ssl.h>
 #endif
 
+#include <algorithm>
 #include <queue>
 #include <map>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 
 void handleError(CURLMcode code) {
@@ -33,6 +35,22 @@ void handleError(CURLcode code) {
 
 namespace mbgl {
 
+// The most that is allocated up front for a body, based on its Content-Length.
+const unsigned long maxReservedLength = 16 * 1024 * 1024;
+
+// Requests that share an HTTP/2 connection start up to this many per connection. The rest wait
+// in the context's queue, so that later requests of a higher priority still go first.
+const std::size_t maxStreamsPerConnection = 8;
+
+// The scheme and authority of a URL. libcurl limits the connections to each of them.
+std::string originOf(const std::string& url) {
+    const std::size_t scheme = url.find("://");
+    if (scheme == std::string::npos) {
+        return url;
+    }
+    return url.substr(0, url.find('/', scheme + 3));
+}
+
 enum class ResponseStatus : int8_t {
     // This error probably won't be resolved by retrying anytime soon. We are giving up.
     PermanentError,
@@ -74,6 +92,20 @@ public:
     void returnHandle(CURL *handle);
     void checkMultiInfo();
 
+    void setMaximumConnections(std::size_t perHost, std::size_t total);
+
+    // Adds the request to the multi handle, or lets it wait until one of the running ones is done.
+    // Waiting requests start in the order of their priority, and then in the order they came,
+    // once libcurl can start them right away.
+    void schedule(HTTPRequestImpl *impl);
+
+    // Forgets a request whose handle was removed from the multi handle, and starts the next one.
+    void unschedule(HTTPRequestImpl *impl);
+    void prioritize(HTTPRequestImpl *impl);
+
+private:
+    void next();
+
 public:
     // Used as the CURL timer function to periodically check for socket updates.
     uv_timer_t *timeout = nullptr;
@@ -88,6 +120,24 @@ public:
     // A queue that we use for storing resuable CURL easy handles to avoid creating and destroying
     // them all the time.
     std::queue<CURL *> handles;
+
+    // Whether libcurl can send several requests over one HTTP/2 connection.
+    bool multiplex = false;
+
+    // The requests waiting for one of the running ones, by their rank and sequence number.
+    using Key = std::pair<uint8_t, uint64_t>;
+    std::map<Key, HTTPRequestImpl *> waiting;
+    uint64_t sequence = 0;
+
+    // The connections that the requests that were added to the multi handle use, in total and
+    // by origin, counted in streams: a request that needs a connection of its own uses
+    // maxStreamsPerConnection of them. They stay within the limits of the multi handle, so that
+    // requests that come later with a higher priority don't wait behind the ones in libcurl's
+    // own queue.
+    std::size_t running = 0;
+    std::map<std::string, std::size_t> runningByOrigin;
+    std::size_t maxConnections = 0;
+    std::size_t maxConnectionsPerHost = 0;
 };
 
 
@@ -101,6 +151,25 @@ public:
     void handleResult(CURLcode code);
     void abandon();
     void retryImmediately();
+    void prioritize();
+
+    // Adds the handle to the multi handle once the context scheduled it.
+    void run();
+
+    // Style resources go before tiles, and prefetched resources last.
+    uint8_t rank() const;
+
+    // Whether the request can be a stream of an HTTP/2 connection that it shares with others.
+    // libcurl only negotiates HTTP/2 for HTTPS.
+    bool stream = false;
+
+    // The share of a connection that the request uses once it runs, in streams.
+    std::size_t streams() const;
+
+    // Set by the context while the request is waiting or running.
+    enum class State : uint8_t { Idle, Waiting, Running } state = State::Idle;
+    HTTPCURLContext::Key key;
+    std::string origin;
 
 private:
     static size_t headerCallback(char *const buffer, const size_t size, const size_t nmemb, void *userp);
@@ -122,6 +191,9 @@ private:
     // Will store the current response.
     std::unique_ptr<Response> response;
 
+    // The body received so far. It becomes the data of the response without being copied.
+    std::shared_ptr<std::string> data;
+
     // In case of revalidation requests, this will store the old response.
     const std::shared_ptr<const Response> existingResponse;
 
@@ -194,6 +266,14 @@ HTTPCURLContext::HTTPCURLContext(uv_loop_t *loop_) : HTTPContext(loop_) {
     handleError(curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this));
     handleError(curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, startTimeout));
     handleError(curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this));
+
+#if LIBCURL_VERSION_NUM >= 0x072f00 // 7.47.0
+    // Requests to the same host share a connection where the server and libcurl support HTTP/2.
+    multiplex = curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2;
+    if (multiplex) {
+        handleError(curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX));
+    }
+#endif
 }
 
 HTTPCURLContext::~HTTPCURLContext() {
@@ -222,6 +302,86 @@ void HTTPCURLContext::returnHandle(CURL *handle) {
     handles.push(handle);
 }
 
+void HTTPCURLContext::setMaximumConnections(std::size_t perHost, std::size_t total) {
+    if (perHost == maxConnectionsPerHost && total == maxConnections) {
+        return;
+    }
+
+    maxConnectionsPerHost = perHost;
+    maxConnections = total;
+#if LIBCURL_VERSION_NUM >= 0x071e00 // 7.30.0
+    handleError(curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, long(perHost)));
+    handleError(curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, long(total)));
+#endif
+
+    // There may be room for more requests now.
+    next();
+}
+
+void HTTPCURLContext::schedule(HTTPRequestImpl *impl) {
+    MBGL_VERIFY_THREAD(tid);
+    assert(impl->state == HTTPRequestImpl::State::Idle);
+
+    impl->key = { impl->rank(), sequence++ };
+    impl->state = HTTPRequestImpl::State::Waiting;
+    waiting.emplace(impl->key, impl);
+    next();
+}
+
+void HTTPCURLContext::unschedule(HTTPRequestImpl *impl) {
+    MBGL_VERIFY_THREAD(tid);
+
+    if (impl->state == HTTPRequestImpl::State::Waiting) {
+        waiting.erase(impl->key);
+    } else if (impl->state == HTTPRequestImpl::State::Running) {
+        running -= impl->streams();
+        auto it = runningByOrigin.find(impl->origin);
+        it->second -= impl->streams();
+        if (!it->second) {
+            runningByOrigin.erase(it);
+        }
+    }
+    impl->state = HTTPRequestImpl::State::Idle;
+    next();
+}
+
+void HTTPCURLContext::prioritize(HTTPRequestImpl *impl) {
+    MBGL_VERIFY_THREAD(tid);
+
+    if (impl->state == HTTPRequestImpl::State::Waiting) {
+        // Keeps its place among the requests of the new rank.
+        waiting.erase(impl->key);
+        impl->key.first = impl->rank();
+        waiting.emplace(impl->key, impl);
+    }
+}
+
+void HTTPCURLContext::next() {
+    const std::size_t total = maxConnections * maxStreamsPerConnection;
+    const std::size_t perOrigin = maxConnectionsPerHost * maxStreamsPerConnection;
+
+    // Requests for an origin that has no room left keep their place, and those behind them for
+    // other origins may go first.
+    for (auto it = waiting.begin(); it != waiting.end() && running < total;) {
+        HTTPRequestImpl *impl = it->second;
+        const std::size_t streams = impl->streams();
+        std::size_t& byOrigin = runningByOrigin[impl->origin];
+        if (running + streams > total || byOrigin + streams > perOrigin) {
+            if (!byOrigin) {
+                runningByOrigin.erase(impl->origin);
+            }
+            ++it;
+            continue;
+        }
+
+        it = waiting.erase(it);
+        impl->state = HTTPRequestImpl::State::Running;
+        running += streams;
+        byOrigin += streams;
+        impl->run();
+    }
+}
+
 void HTTPCURLContext::checkMultiInfo() {
     MBGL_VERIFY_THREAD(tid);
     CURLMsg *message = nullptr;
@@ -432,6 +592,8 @@ HTTPRequestImpl::HTTPRequestImpl(HTTPRequest *request_, uv_loop_t *loop, std::sh
       handle(context->getHandle()) {
     assert(request);
     context->addRequest(request);
+    context->setMaximumConnections(request->source->maxConnectionsPerHost,
+                                   request->source->maxConnections);
 
     // Zero out the error buffer.
     memset(error, 0, sizeof(error));
@@ -470,6 +632,15 @@ HTTPRequestImpl::HTTPRequestImpl(HTTPRequest *request_, uv_loop_t *loop, std::sh
     handleError(curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "gzip, deflate"));
     handleError(curl_easy_setopt(handle, CURLOPT_USERAGENT, "MapboxGL/1.0"));
     handleError(curl_easy_setopt(handle, CURLOPT_SHARE, context->share));
+    origin = originOf(request->resource.url);
+#if LIBCURL_VERSION_NUM >= 0x072f00 // 7.47.0
+    stream = context->multiplex && request->resource.url.compare(0, 8, "https://") == 0;
+    if (stream) {
+        handleError(curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, long(CURL_HTTP_VERSION_2TLS)));
+        // Wait for a connection that the request can share rather than opening another one.
+        handleError(curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L));
+    }
+#endif
 
     start();
 }
@@ -481,10 +652,28 @@ void HTTPRequestImpl::abandon() {
     }
 }
 
+void HTTPRequestImpl::prioritize() {
+    context->prioritize(this);
+}
+
+std::size_t HTTPRequestImpl::streams() const {
+    return stream ? 1 : maxStreamsPerConnection;
+}
+
+uint8_t HTTPRequestImpl::rank() const {
+    assert(request);
+    return (request->prefetch ? 2 : 0) + (request->resource.kind == Resource::Kind::Tile ? 1 : 0);
+}
+
 void HTTPRequestImpl::start() {
     // Count up the attempts.
     attempts++;
 
+    // Wait for a connection.
+    context->schedule(this);
+}
+
+void HTTPRequestImpl::run() {
     // Start requesting the information.
     handleError(curl_multi_add_handle(context->multi, handle));
 }
@@ -498,6 +687,7 @@ HTTPRequestImpl::~HTTPRequestImpl() {
     }
 
     handleError(curl_multi_remove_handle(context->multi, handle));
+    context->unschedule(this);
     context->returnHandle(handle);
     handle = nullptr;
 
@@ -521,11 +711,11 @@ size_t HTTPRequestImpl::writeCallback(void *const contents, const size_t size, c
     auto impl = reinterpret_cast<HTTPRequestImpl *>(userp);
     MBGL_VERIFY_THREAD(impl->tid);
 
-    if (!impl->response) {
-        impl->response = util::make_unique<Response>();
+    if (!impl->data) {
+        impl->data = std::make_shared<std::string>();
     }
 
-    impl->response->data.append((char *)contents, size * nmemb);
+    impl->data->append((char *)contents, size * nmemb);
     return size * nmemb;
 }
 
@@ -584,6 +774,14 @@ size_t HTTPRequestImpl::headerCallback(char *const buffer, const size_t size, co
     } else if ((begin = headerMatches("expires: ", buffer, length)) != std::string::npos) {
         const std::string value { buffer + begin, length - begin - 2 }; // remove \r\n
         baton->response->expires = curl_getdate(value.c_str(), nullptr);
+    } else if ((begin = headerMatches("content-length: ", buffer, length)) != std::string::npos) {
+        // Allocate the body once rather than growing it as it arrives. Don't trust the server
+        // with allocating more than that, though: larger bodies still grow.
+        const std::string value { buffer + begin, length - begin - 2 }; // remove \r\n
+        if (!baton->data) {
+            baton->data = std::make_shared<std::string>();
+        }
+        baton->data->reserve(std::min(std::strtoul(value.c_str(), nullptr, 10), maxReservedLength));
     }
 
     return length;
@@ -592,8 +790,10 @@ size_t HTTPRequestImpl::headerCallback(char *const buffer, const size_t size, co
 
 void HTTPRequestImpl::retry(uint64_t timeout) {
     handleError(curl_multi_remove_handle(context->multi, handle));
+    context->unschedule(this);
 
     response.reset();
+    data.reset();
 
     assert(!timer);
     timer = new uv_timer_t;
@@ -665,6 +865,10 @@ void HTTPRequestImpl::handleResult(CURLcode code) {
         response = util::make_unique<Response>();
     }
 
+    if (data) {
+        response->data = std::move(data);
+    }
+
     // Add human-readable error code
     if (code != CURLE_OK) {
         response->status = Response::Error;
@@ -688,7 +892,7 @@ void HTTPRequestImpl::handleResult(CURLcode code) {
 
         if (responseCode == 304) {
             if (existingResponse) {
-                // We're going to copy over the existing response's data.
+                // We're going to copy over the existing response, which shares its data.
                 response->status = existingResponse->status;
                 response->message = existingResponse->message;
                 response->modified = existingResponse->modified;
@@ -701,9 +905,13 @@ void HTTPRequestImpl::handleResult(CURLcode code) {
                 response->status = Response::Successful;
                 return finish(ResponseStatus::Successful);
             }
-        } else if (responseCode == 200) {
+        } else if (responseCode == 200 || responseCode == 204) {
             response->status = Response::Successful;
             return finish(ResponseStatus::Successful);
+        } else if (responseCode == 404) {
+            response->status = Response::NotFound;
+            response->message = "HTTP status code " + std::to_string(responseCode);
+            return finish(ResponseStatus::PermanentError);
         } else if (responseCode >= 500 && responseCode < 600) {
             // Server errors may be temporary, so back off exponentially.
             response->status = Response::Error;
@@ -723,7 +931,8 @@ void HTTPRequestImpl::handleResult(CURLcode code) {
 // -------------------------------------------------------------------------------------------------
 
 HTTPRequest::HTTPRequest(DefaultFileSource::Impl *source_, const Resource &resource_)
-    : SharedRequestBase(source_, resource_) {
+    : SharedRequestBase(source_, resource_),
+      prefetch(resource_.priority == Resource::Priority::Prefetch) {
 }
 
 HTTPRequest::~HTTPRequest() {
@@ -741,6 +950,15 @@ void HTTPRequest::start(uv_loop_t *loop, std::shared_ptr<const Response> respons
     ptr = new HTTPRequestImpl(this, loop, response);
 }
 
+void HTTPRequest::prioritize() {
+    MBGL_VERIFY_THREAD(tid);
+
+    prefetch = false;
+    if (ptr) {
+        reinterpret_cast<HTTPRequestImpl *>(ptr)->prioritize();
+    }
+}
+
 void HTTPRequest::retryImmediately() {
     MBGL_VERIFY_THREAD(tid);
 
@@ -0,0 +1,167 @@
+#include <mbgl/storage/mbtiles_request.hpp>
+#include <mbgl/storage/response.hpp>
+
+#include <mbgl/util/compression.hpp>
+#include <mbgl/util/std.hpp>
+#include <mbgl/util/thread.hpp>
+#include <mbgl/platform/log.hpp>
+
+#include "sqlite3.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace mbgl {
+
+using namespace mapbox::sqlite;
+
+namespace {
+
+// Reads are answered by this many read-only connections, each on a thread of its own.
+const std::size_t readerCount = 4;
+
+// Tiles are read through memory mapped I/O, which saves copying pages into SQLite's cache, up to
+// this far into each file.
+const char *const mmapPragma = "PRAGMA mmap_size = 1073741824";
+
+const std::size_t schemeLength = std::strlen("mbtiles://");
+
+// Parses a number that may be followed by a file extension, as in "12.pbf".
+bool parseCoordinate(const std::string& text, int32_t& result) {
+    char* end = nullptr;
+    const long value = std::strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || (*end != '\0' && *end != '.') || value < 0) {
+        return false;
+    }
+    result = int32_t(value);
+    return true;
+}
+
+// Splits mbtiles://path/z/x/y into the path and the tile coordinates. Rows are counted from the
+// bottom with 1 << z, so zoom levels beyond 30 are invalid.
+bool parseURL(const std::string& url, std::string& path, int32_t& z, int32_t& x, int32_t& y) {
+    const std::size_t ySeparator = url.rfind('/');
+    if (ySeparator == std::string::npos || ySeparator < schemeLength) return false;
+    const std::size_t xSeparator = url.rfind('/', ySeparator - 1);
+    if (xSeparator == std::string::npos || xSeparator < schemeLength) return false;
+    const std::size_t zSeparator = url.rfind('/', xSeparator - 1);
+    if (zSeparator == std::string::npos || zSeparator <= schemeLength) return false;
+
+    path = url.substr(schemeLength, zSeparator - schemeLength);
+    return parseCoordinate(url.substr(zSeparator + 1, xSeparator - zSeparator - 1), z) &&
+           parseCoordinate(url.substr(xSeparator + 1, ySeparator - xSeparator - 1), x) &&
+           parseCoordinate(url.substr(ySeparator + 1), y) && z <= 30;
+}
+
+bool isGzip(const std::string& data) {
+    return data.size() >= 2 && uint8_t(data[0]) == 0x1F && uint8_t(data[1]) == 0x8B;
+}
+
+}
+
+class MBTilesPool::Reader {
+public:
+    ~Reader();
+
+    std::unique_ptr<Response> get(const std::string& url, const std::string& root);
+
+private:
+    struct File {
+        std::unique_ptr<Database> db;
+        std::unique_ptr<Statement> getStmt;
+    };
+
+    File& open(const std::string& path);
+
+    std::unordered_map<std::string, File> files;
+};
+
+MBTilesPool::Reader::~Reader() {
+    try {
+        files.clear();
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Error(Event::Database, ex.code, ex.what());
+    }
+}
+
+MBTilesPool::Reader::File& MBTilesPool::Reader::open(const std::string& path) {
+    auto it = files.find(path);
+    if (it != files.end()) {
+        return it->second;
+    }
+
+    File file;
+    file.db = util::make_unique<Database>(path.c_str(), ReadOnly | NoMutex);
+    file.db->exec(mmapPragma);
+    file.getStmt = util::make_unique<Statement>(file.db->prepare(
+        "SELECT `tile_data` FROM `tiles` WHERE `zoom_level` = ? AND `tile_column` = ? AND `tile_row` = ?"));
+    return files.emplace(path, std::move(file)).first->second;
+}
+
+std::unique_ptr<Response> MBTilesPool::Reader::get(const std::string& url, const std::string& root) {
+    auto response = util::make_unique<Response>();
+
+    std::string path;
+    int32_t z = 0, x = 0, y = 0;
+    if (!parseURL(url, path, z, x, y)) {
+        response->message = "Invalid MBTiles URL";
+        return response;
+    }
+
+    if (path[0] != '/') {
+        // This is a relative path. Prefix with the application root.
+        path = root + "/" + path;
+    }
+
+    try {
+        Statement& getStmt = *open(path).getStmt;
+        getStmt.reset();
+        getStmt.bind(1, z);
+        getStmt.bind(2, x);
+        // MBTiles count rows from the bottom, as in TMS.
+        getStmt.bind(3, (1 << z) - 1 - y);
+
+        if (getStmt.run()) {
+            std::string data = getStmt.get<std::string>(0);
+            if (isGzip(data)) {
+                data = util::decompress(data);
+            }
+            response->status = Response::Successful;
+            response->data = std::make_shared<std::string>(std::move(data));
+        } else {
+            response->status = Response::NotFound;
+            response->message = "Tile not found";
+        }
+
+        // Don't keep the file locked for reading.
+        getStmt.reset();
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Error(Event::Database, ex.code, ex.what());
+        response->message = ex.what();
+
+        // Open the file again on the next read, in case it was replaced.
+        files.erase(path);
+    } catch (std::runtime_error& ex) {
+        response->message = ex.what();
+    }
+    return response;
+}
+
+MBTilesPool::MBTilesPool() = default;
+
+MBTilesPool::~MBTilesPool() = default;
+
+void MBTilesPool::get(const std::string& url, const std::string& root, Callback callback) {
+    // Most file sources never read MBTiles, so the readers are only started once one does.
+    if (readers.empty()) {
+        for (std::size_t i = 0; i < readerCount; i++) {
+            readers.emplace_back(util::make_unique<util::Thread<Reader>>("MBTiles Reader"));
+        }
+    }
+
+    const std::size_t reader = nextReader++ % readers.size();
+    readers[reader]->invokeWithResult(&Reader::get, callback, url, root);
+}
+
+}
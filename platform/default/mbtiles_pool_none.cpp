@@ -0,0 +1,26 @@
+#include <mbgl/storage/mbtiles_request.hpp>
+#include <mbgl/storage/response.hpp>
+
+#include <mbgl/util/run_loop.hpp>
+#include <mbgl/util/std.hpp>
+#include <mbgl/util/thread.hpp>
+
+namespace mbgl {
+
+// Without SQLite, there are no readers, and reading MBTiles files fails.
+class MBTilesPool::Reader {};
+
+MBTilesPool::MBTilesPool() = default;
+
+MBTilesPool::~MBTilesPool() = default;
+
+void MBTilesPool::get(const std::string&, const std::string&, Callback callback) {
+    // Calls back later, as the request isn't subscribed to yet.
+    util::RunLoop::Get()->invoke([callback] {
+        auto response = util::make_unique<Response>();
+        response->message = "MBTiles files are not supported";
+        callback(std::move(response));
+    });
+}
+
+}
@@ -68,6 +68,22 @@ Statement Database::prepare(const char *query) {
     return std::move(Statement(db, query));
 }
 
+int Database::changes() const {
+    assert(db);
+    return sqlite3_changes(db);
+}
+
+bool Database::hasMoved() const {
+    assert(db);
+#ifdef SQLITE_FCNTL_HAS_MOVED
+    int moved = 0;
+    if (sqlite3_file_control(db, "main", SQLITE_FCNTL_HAS_MOVED, &moved) == SQLITE_OK) {
+        return moved;
+    }
+#endif
+    return false;
+}
+
 Statement::Statement(sqlite3 *db, const char *sql) {
     const int err = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (err != SQLITE_OK) {
@@ -42,6 +42,12 @@ public:
     void exec(const std::string &sql);
     Statement prepare(const char *query);
 
+    // The number of rows changed by the most recent statement.
+    int changes() const;
+
+    // Whether the database file was deleted or renamed since it was opened.
+    bool hasMoved() const;
+
 private:
     sqlite3 *db = nullptr;
 };
@@ -2,16 +2,47 @@
 #include <mbgl/storage/request.hpp>
 #include <mbgl/storage/response.hpp>
 
+#include <mbgl/util/chrono.hpp>
 #include <mbgl/util/compression.hpp>
 #include <mbgl/util/io.hpp>
 #include <mbgl/util/thread.hpp>
+#include <mbgl/util/uv_detail.hpp>
 #include <mbgl/platform/log.hpp>
 
 #include "sqlite3.hpp"
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <future>
+
 namespace mbgl {
 
+namespace {
+
+// Writes are committed in one transaction once this many are pending, or once the first of them
+// waited for this long.
+const std::size_t defaultWriteBatchSize = 64;
+const Duration defaultWriteInterval = std::chrono::milliseconds(500);
+
+// Reads are answered by this many read-only connections, each on a thread of its own.
+const std::size_t readerCount = 2;
+
+// Access times are written once this many responses were read.
+const std::size_t accessTimesBatchSize = 64;
+
+// Evictions delete at most this many responses at a time, so that reads and writes that are
+// queued in the meantime don't wait for long.
+const uint64_t evictionBatchSize = 32;
+
+// Once evicting, the cache shrinks to this fraction of its limits.
+const double evictionTarget = 0.9;
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(SystemClock::now().time_since_epoch()).count();
+}
+
+}
+
 std::string removeAccessTokenFromURL(const std::string &url) {
     const size_t token_start = url.find("access_token=");
     // Ensure that token exists, isn't at the front and is preceded by either & or ?.
@@ -62,22 +93,67 @@ std::string unifyMapboxURLs(const std::string &url) {
 using namespace mapbox::sqlite;
 
 SQLiteCache::SQLiteCache(const std::string& path_)
-    : thread(util::make_unique<util::Thread<Impl>>("SQLite Cache", path_)) {
+    : pending(std::make_shared<PendingWrites>()),
+      thread(util::make_unique<util::Thread<Impl>>("SQLite Cache", path_, pending)) {
+    // In-memory databases are private to their connection.
+    if (path_ == ":memory:") {
+        return;
+    }
+
+    const auto touch = [this](const std::string& url) {
+        thread->invoke(&Impl::touch, url);
+    };
+
+    // Waits for the writer to answer a read the reader can't answer.
+    const auto fallback = [this](const Resource& resource) {
+        std::promise<std::unique_ptr<Response>> promise;
+        thread->invoke([&](Impl* impl) {
+            promise.set_value(impl->get(resource));
+        });
+        return promise.get_future().get();
+    };
+
+    for (std::size_t i = 0; i < readerCount; i++) {
+        readers.emplace_back(util::make_unique<util::Thread<Reader>>("SQLite Cache Reader", path_,
+                                                                     pending, touch, fallback));
+    }
 }
 
 SQLiteCache::~SQLiteCache() = default;
 
-SQLiteCache::Impl::Impl(const std::string& path_)
-    : path(path_) {
+SQLiteCache::Impl::Impl(const std::string& path_, std::shared_ptr<PendingWrites> pending_)
+    : path(path_),
+      pending(std::move(pending_)),
+      writeBatchSize(defaultWriteBatchSize),
+      writeInterval(defaultWriteInterval) {
 }
 
 SQLiteCache::Impl::~Impl() {
     // Deleting these SQLite objects may result in exceptions, but we're in a destructor, so we
     // can't throw anything.
+    // Nothing is scheduled on the loop from now on, since it would run after the cache is gone.
+    // The cache is evicted when it is used again.
+    destroying = true;
+    commit();
+    writeAccessTimes();
+
+    // The loop still runs, and frees the timer once it is closed.
+    if (timer) {
+        uv_timer_stop(timer);
+        uv::close(timer);
+        timer = nullptr;
+    }
+
     try {
         getStmt.reset();
         putStmt.reset();
         refreshStmt.reset();
+        accessStmt.reset();
+        evictExpiredStmt.reset();
+        evictStmt.reset();
+        countStmt.reset();
+        pageCountStmt.reset();
+        freePageCountStmt.reset();
         db.reset();
     } catch (mapbox::sqlite::Exception& ex) {
         Log::Error(Event::Database, ex.code, ex.what());
@@ -92,19 +168,33 @@ void SQLiteCache::Impl::createSchema() {
     constexpr const char *const sql = ""
         "CREATE TABLE IF NOT EXISTS `http_cache` ("
         "    `url` TEXT PRIMARY KEY NOT NULL,"
-        "    `status` INTEGER NOT NULL," // The response status (Successful or Error).
+        "    `status` INTEGER NOT NULL," // The response status (Error, Successful or NotFound).
         "    `kind` INTEGER NOT NULL," // The kind of file.
         "    `modified` INTEGER," // Timestamp when the file was last modified.
         "    `etag` TEXT,"
         "    `expires` INTEGER," // Timestamp when the server says the file expires.
         "    `data` BLOB,"
-        "    `compressed` INTEGER NOT NULL DEFAULT 0" // Whether the data is compressed.
+        "    `compressed` INTEGER NOT NULL DEFAULT 0," // Whether the data is compressed.
+        "    `accessed` INTEGER NOT NULL DEFAULT 0" // Timestamp when the file was last read.
         ");"
         "CREATE INDEX IF NOT EXISTS `http_cache_kind_idx` ON `http_cache` (`kind`);";
 
+    constexpr const char *const accessedIndex = ""
+        "CREATE INDEX IF NOT EXISTS `http_cache_accessed_idx` ON `http_cache` (`accessed`);";
+
     try {
         db->exec(sql);
+
+        // Databases created by earlier versions don't have access times yet.
+        try {
+            db->prepare("SELECT `accessed` FROM `http_cache` LIMIT 0");
+        } catch (mapbox::sqlite::Exception&) {
+            db->exec("ALTER TABLE `http_cache` ADD COLUMN `accessed` INTEGER NOT NULL DEFAULT 0");
+        }
+
+        db->exec(accessedIndex);
         schema = true;
+        enableReaders();
     } catch (mapbox::sqlite::Exception &ex) {
         if (ex.code == SQLITE_NOTADB) {
             Log::Warning(Event::Database, "Trashing invalid database");
@@ -123,6 +213,27 @@ void SQLiteCache::Impl::createSchema() {
         // with different columsn. Drop it and try to create a new one.
         db->exec("DROP TABLE IF EXISTS `http_cache`");
         db->exec(sql);
+        db->exec(accessedIndex);
+    }
+}
+
+void SQLiteCache::Impl::enableReaders() {
+    if (path == ":memory:") {
+        return;
+    }
+
+    try {
+        // In WAL mode, readers don't block the writer and the writer doesn't block readers. The
+        // mode is stored in the database, so the readers use it too. Changing it fails while
+        // another connection reads, in which case reads stay with the writer.
+        Statement stmt = db->prepare("PRAGMA journal_mode = WAL");
+        if (stmt.run() && stmt.get<std::string>(0) == "wal") {
+            // Losing the last commits on a power failure is fine for a cache.
+            db->exec("PRAGMA synchronous = NORMAL");
+            pending->ready = true;
+        }
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Warning(Event::Database, ex.code, ex.what());
     }
 }
 
@@ -131,7 +242,12 @@ void SQLiteCache::get(const Resource &resource, Callback callback) {
     // Will try to load the URL from the SQLite database and call the callback when done.
     // Note that the callback is probably going to invoked from another thread, so the caller
     // must make sure that it can run in that thread.
-    thread->invokeWithResult(&Impl::get, callback, resource);
+    if (!readers.empty() && pending->ready) {
+        const std::size_t reader = nextReader++ % readers.size();
+        readers[reader]->invokeWithResult(&Reader::get, callback, resource);
+    } else {
+        thread->invokeWithResult(&Impl::get, callback, resource);
+    }
 }
 
 std::unique_ptr<Response> SQLiteCache::Impl::get(const Resource &resource) {
@@ -145,33 +261,105 @@ std::unique_ptr<Response> SQLiteCache::Impl::get(const Resource &resource) {
             createSchema();
         }
 
-        if (!getStmt) {
-            // Initialize the statement                                   0         1
-            getStmt = util::make_unique<Statement>(db->prepare("SELECT `status`, `modified`, "
-            //     2         3        4          5                                       1
-                "`etag`, `expires`, `data`, `compressed` FROM `http_cache` WHERE `url` = ?"));
-        } else {
-            getStmt->reset();
+        const std::string unifiedURL = unifyMapboxURLs(resource.url);
+        auto response = read(*pending, *db, getStmt, unifiedURL);
+        if (response) {
+            touch(unifiedURL);
         }
+        return response;
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Error(Event::Database, ex.code, ex.what());
+        return nullptr;
+    }
+}
 
-        const std::string unifiedURL = unifyMapboxURLs(resource.url);
-        getStmt->bind(1, unifiedURL.c_str());
-        if (getStmt->run()) {
-            // There is data.
-            auto response = util::make_unique<Response>();
-            response->status = Response::Status(getStmt->get<int>(0));
-            response->modified = getStmt->get<int64_t>(1);
-            response->etag = getStmt->get<std::string>(2);
-            response->expires = getStmt->get<int64_t>(3);
-            response->data = getStmt->get<std::string>(4);
-            if (getStmt->get<int>(5)) { // == compressed
-                response->data = util::decompress(response->data);
+std::unique_ptr<Response> SQLiteCache::Impl::read(PendingWrites& pending, Database& db,
+                                                  std::unique_ptr<Statement>& getStmt,
+                                                  const std::string& url) {
+    // Writes that aren't committed yet take precedence. A write that is committed in the meantime
+    // is only removed from the pending writes afterwards, so it is found in one or the other.
+    PendingWrites::Write write;
+    const bool found = pending.find(url, write);
+    if (found && write.response) {
+        auto response = util::make_unique<Response>(*write.response);
+        response->expires = write.expires;
+        return std::move(response);
+    }
+
+    if (!getStmt) {
+        // Initialize the statement                                   0         1
+        getStmt = util::make_unique<Statement>(db.prepare("SELECT `status`, `modified`, "
+        //     2         3        4          5                                       1
+            "`etag`, `expires`, `data`, `compressed` FROM `http_cache` WHERE `url` = ?"));
+    } else {
+        getStmt->reset();
+    }
+
+    getStmt->bind(1, url.c_str());
+    if (getStmt->run()) {
+        // There is data.
+        auto response = util::make_unique<Response>();
+        response->status = Response::Status(getStmt->get<int>(0));
+        response->modified = getStmt->get<int64_t>(1);
+        response->etag = getStmt->get<std::string>(2);
+        response->expires = getStmt->get<int64_t>(3);
+        std::string data = getStmt->get<std::string>(4);
+        if (getStmt->get<int>(5)) { // == compressed
+            data = util::decompress(data);
+        }
+        response->data = std::make_shared<std::string>(std::move(data));
+        if (found) {
+            // A refresh that isn't committed yet.
+            response->expires = write.expires;
+        }
+
+        // Don't keep the database locked for reading, which would keep the WAL from being reset.
+        getStmt->reset();
+        return std::move(response);
+    } else {
+        // There is no data.
+        return nullptr;
+    }
+}
+
+SQLiteCache::Reader::Reader(const std::string& path_, std::shared_ptr<PendingWrites> pending_,
+                            std::function<void (const std::string&)> touch_,
+                            std::function<std::unique_ptr<Response> (const Resource&)> fallback_)
+    : path(path_),
+      pending(std::move(pending_)),
+      touch(std::move(touch_)),
+      fallback(std::move(fallback_)) {
+}
+
+SQLiteCache::Reader::~Reader() {
+    try {
+        getStmt.reset();
+        db.reset();
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Error(Event::Database, ex.code, ex.what());
+    }
+}
+
+std::unique_ptr<Response> SQLiteCache::Reader::get(const Resource& resource) {
+    try {
+        // Readers are only used once the writer created the database.
+        if (!db) {
+            try {
+                db = util::make_unique<Database>(path.c_str(), ReadOnly);
+            } catch (mapbox::sqlite::Exception&) {
+                // The database was deleted since, which the writer doesn't notice as it keeps it
+                // open. It answers all reads from now on.
+                pending->ready = false;
+                return fallback(resource);
             }
-            return std::move(response);
-        } else {
-            // There is no data.
-            return nullptr;
         }
+
+        const std::string unifiedURL = unifyMapboxURLs(resource.url);
+        auto response = Impl::read(*pending, *db, getStmt, unifiedURL);
+        if (response) {
+            touch(unifiedURL);
+        }
+        return response;
     } catch (mapbox::sqlite::Exception& ex) {
         Log::Error(Event::Database, ex.code, ex.what());
         return nullptr;
@@ -181,15 +369,104 @@ std::unique_ptr<Response> SQLiteCache::Impl::get(const Resource &resource) {
 void SQLiteCache::put(const Resource &resource, std::shared_ptr<const Response> response, Hint hint) {
     // Can be called from any thread, but most likely from the file source thread. We are either
     // storing a new response or updating the currently stored response, potentially setting a new
-    // expiry date.
+    // expiry date. The write is pending right away, so that reads that follow see it, and is
+    // committed by the writer later.
     if (hint == Hint::Full) {
-        thread->invoke(&Impl::put, resource, std::move(response));
+        pending->put(unifyMapboxURLs(resource.url), resource.kind, std::move(response));
     } else if (hint == Hint::Refresh) {
-        thread->invoke(&Impl::refresh, resource, int64_t(response->expires));
+        pending->refresh(unifyMapboxURLs(resource.url), response->expires);
+    } else {
+        return;
     }
+
+    thread->invoke(&Impl::scheduleCommit);
+}
+
+void SQLiteCache::PendingWrites::put(const std::string& url, Resource::Kind kind,
+                                     std::shared_ptr<const Response> response) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const int64_t expires = response->expires;
+    writes[url] = { kind, std::move(response), expires, ++sequence };
+}
+
+void SQLiteCache::PendingWrites::refresh(const std::string& url, int64_t expires) {
+    // A refresh of a response that isn't committed yet updates the pending write instead.
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& write = writes[url];
+    write.expires = expires;
+    write.sequence = ++sequence;
+}
+
+bool SQLiteCache::PendingWrites::find(const std::string& url, Write& write) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = writes.find(url);
+    if (it == writes.end()) {
+        return false;
+    }
+    write = it->second;
+    return true;
+}
+
+std::size_t SQLiteCache::PendingWrites::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writes.size();
+}
+
+SQLiteCache::PendingWrites::Writes SQLiteCache::PendingWrites::take() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return Writes(writes.begin(), writes.end());
+}
+
+void SQLiteCache::PendingWrites::remove(const Writes& committed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& write : committed) {
+        const auto it = writes.find(write.first);
+        if (it != writes.end() && it->second.sequence == write.second.sequence) {
+            writes.erase(it);
+        }
+    }
+}
+
+void SQLiteCache::Impl::scheduleCommit() {
+    if (pending->size() >= writeBatchSize) {
+        commit();
+        return;
+    }
+
+    if (!timer) {
+        timer = new uv_timer_t;
+        timer->data = this;
+        uv_timer_init(util::RunLoop::Get()->get(), timer);
+
+        // Pending writes are committed when the cache is destroyed, so they don't need to keep
+        // the loop running.
+        uv_unref(reinterpret_cast<uv_handle_t*>(timer));
+    }
+
+    if (!uv_is_active(reinterpret_cast<uv_handle_t*>(timer))) {
+        const auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(writeInterval);
+        uv_timer_start(timer, onCommitTimeout, interval.count(), 0);
+    }
+}
+
+#if UV_VERSION_MAJOR == 0 && UV_VERSION_MINOR <= 10
+void SQLiteCache::Impl::onCommitTimeout(uv_timer_t *req, int /* status */) {
+#else
+void SQLiteCache::Impl::onCommitTimeout(uv_timer_t *req) {
+#endif
+    reinterpret_cast<Impl *>(req->data)->commit();
 }
 
-void SQLiteCache::Impl::put(const Resource& resource, std::shared_ptr<const Response> response) {
+void SQLiteCache::Impl::commit() {
+    if (timer) {
+        uv_timer_stop(timer);
+    }
+
+    const PendingWrites::Writes writes = pending->take();
+    if (writes.empty()) {
+        return;
+    }
+
     try {
         if (!db) {
             createDatabase();
@@ -199,69 +476,300 @@ void SQLiteCache::Impl::put(const Resource& resource, std::shared_ptr<const Resp
             createSchema();
         }
 
-        if (!putStmt) {
-            putStmt = util::make_unique<Statement>(db->prepare("REPLACE INTO `http_cache` ("
-            //     1       2       3         4         5         6        7          8
-                "`url`, `status`, `kind`, `modified`, `etag`, `expires`, `data`, `compressed`"
-                ") VALUES(?, ?, ?, ?, ?, ?, ?, ?)"));
-        } else {
-            putStmt->reset();
+        // SQLite only notices that the database file was deleted in rollback journal mode. In
+        // WAL mode, it would keep writing to a file that is gone.
+        if (db->hasMoved()) {
+            throw mapbox::sqlite::Exception { SQLITE_READONLY, sqlite3_errstr(SQLITE_READONLY) };
         }
 
-        const std::string unifiedURL = unifyMapboxURLs(resource.url);
-        putStmt->bind(1 /* url */, unifiedURL.c_str());
-        putStmt->bind(2 /* status */, int(response->status));
-        putStmt->bind(3 /* kind */, int(resource.kind));
-        putStmt->bind(4 /* modified */, response->modified);
-        putStmt->bind(5 /* etag */, response->etag.c_str());
-        putStmt->bind(6 /* expires */, response->expires);
-
-        std::string data;
-        if (resource.kind != Resource::Image) {
-            // Do not compress images, since they are typically compressed already.
-            data = util::compress(response->data);
+        // A single write doesn't need a transaction of its own.
+        const bool transaction = writes.size() > 1;
+        if (transaction) {
+            db->exec("BEGIN");
         }
 
-        if (!data.empty() && data.size() < response->data.size()) {
-            // Store the compressed data when it is smaller than the original
-            // uncompressed data.
-            putStmt->bind(7 /* data */, data, false); // do not retain the string internally.
-            putStmt->bind(8 /* compressed */, true);
-        } else {
-            putStmt->bind(7 /* data */, response->data, false); // do not retain the string internally.
-            putStmt->bind(8 /* compressed */, false);
+        try {
+            for (const auto& write : writes) {
+                if (write.second.response) {
+                    writeResponse(write.first, write.second.kind, *write.second.response, write.second.expires);
+                } else {
+                    writeExpires(write.first, write.second.expires);
+                }
+            }
+
+            if (transaction) {
+                db->exec("COMMIT");
+            }
+        } catch (mapbox::sqlite::Exception&) {
+            if (transaction) {
+                try {
+                    db->exec("ROLLBACK");
+                } catch (mapbox::sqlite::Exception&) {
+                    // The transaction may have been rolled back already.
+                }
+            }
+            throw;
         }
 
-        putStmt->run();
+        // Responses may have replaced others, so this over-estimates the count.
+        entries += writes.size();
     } catch (mapbox::sqlite::Exception& ex) {
         Log::Error(Event::Database, ex.code, ex.what());
     }
+
+    // Writes that failed are dropped, like the responses of reads that failed. Writes that
+    // replaced these in the meantime are committed with the next batch.
+    pending->remove(writes);
+    checkLimits();
+}
+
+void SQLiteCache::Impl::writeResponse(const std::string& url, Resource::Kind kind,
+                                      const Response& response, int64_t expires) {
+    if (!putStmt) {
+        putStmt = util::make_unique<Statement>(db->prepare("REPLACE INTO `http_cache` ("
+        //     1       2       3         4         5         6        7          8            9
+            "`url`, `status`, `kind`, `modified`, `etag`, `expires`, `data`, `compressed`, `accessed`"
+            ") VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    } else {
+        putStmt->reset();
+    }
+
+    putStmt->bind(1 /* url */, url.c_str());
+    putStmt->bind(2 /* status */, int(response.status));
+    putStmt->bind(3 /* kind */, int(kind));
+    putStmt->bind(4 /* modified */, response.modified);
+    putStmt->bind(5 /* etag */, response.etag.c_str());
+    putStmt->bind(6 /* expires */, expires);
+
+    // Missing resources are stored without the error page that the server sent along.
+    const std::string noBody;
+    const std::string& body = response.status == Response::NotFound ? noBody : *response.data;
+
+    std::string data;
+    if (kind != Resource::Image) {
+        // Do not compress images, since they are typically compressed already.
+        data = util::compress(body);
+    }
+
+    if (!data.empty() && data.size() < body.size()) {
+        // Store the compressed data when it is smaller than the original
+        // uncompressed data.
+        putStmt->bind(7 /* data */, data, false); // do not retain the string internally.
+        putStmt->bind(8 /* compressed */, true);
+    } else {
+        putStmt->bind(7 /* data */, body, false); // do not retain the string internally.
+        putStmt->bind(8 /* compressed */, false);
+    }
+    putStmt->bind(9 /* accessed */, now());
+
+    putStmt->run();
 }
 
-void SQLiteCache::Impl::refresh(const Resource& resource, int64_t expires) {
+void SQLiteCache::Impl::writeExpires(const std::string& url, int64_t expires) {
+    if (!refreshStmt) {
+        refreshStmt = util::make_unique<Statement>( //       1               2
+            db->prepare("UPDATE `http_cache` SET `expires` = ? WHERE `url` = ?"));
+    } else {
+        refreshStmt->reset();
+    }
+
+    refreshStmt->bind(1, int64_t(expires));
+    refreshStmt->bind(2, url.c_str());
+    refreshStmt->run();
+}
+
+void SQLiteCache::setWriteBatch(std::size_t count, Duration interval) {
+    thread->invoke(&Impl::setWriteBatch, count, interval);
+}
+
+void SQLiteCache::Impl::setWriteBatch(std::size_t count, Duration interval) {
+    writeBatchSize = count;
+    writeInterval = interval;
+    if (pending->size() >= writeBatchSize) {
+        commit();
+    }
+}
+
+void SQLiteCache::setMaximumCacheSize(uint64_t size) {
+    thread->invoke(&Impl::setMaximumCacheSize, size);
+}
+
+void SQLiteCache::setMaximumCacheEntries(uint64_t entries) {
+    thread->invoke(&Impl::setMaximumCacheEntries, entries);
+}
+
+void SQLiteCache::Impl::setMaximumCacheSize(uint64_t size) {
+    maximumSize = size;
+    checkLimits();
+}
+
+void SQLiteCache::Impl::setMaximumCacheEntries(uint64_t entries_) {
+    maximumEntries = entries_;
+    checkLimits();
+}
+
+void SQLiteCache::Impl::touch(const std::string& url) {
+    accessTimes[url] = now();
+
+    // Write the batch once the reads that are queued already were answered.
+    if (accessTimes.size() >= accessTimesBatchSize && !accessTimesScheduled && !destroying) {
+        accessTimesScheduled = true;
+        util::RunLoop::Get()->invoke([this] {
+            accessTimesScheduled = false;
+            writeAccessTimes();
+        });
+    }
+}
+
+void SQLiteCache::Impl::writeAccessTimes() {
+    if (accessTimes.empty() || !db || !schema) {
+        return;
+    }
+
     try {
-        if (!db) {
-            createDatabase();
+        if (!accessStmt) {
+            accessStmt = util::make_unique<Statement>( //       1               2
+                db->prepare("UPDATE `http_cache` SET `accessed` = ? WHERE `url` = ?"));
         }
 
-        if (!schema) {
-            createSchema();
+        db->exec("BEGIN");
+        try {
+            for (const auto& access : accessTimes) {
+                accessStmt->reset();
+                accessStmt->bind(1, access.second);
+                accessStmt->bind(2, access.first.c_str());
+                accessStmt->run();
+            }
+            db->exec("COMMIT");
+        } catch (mapbox::sqlite::Exception&) {
+            db->exec("ROLLBACK");
+            throw;
         }
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Error(Event::Database, ex.code, ex.what());
+    }
 
-        if (!refreshStmt) {
-            refreshStmt = util::make_unique<Statement>( //       1               2
-                db->prepare("UPDATE `http_cache` SET `expires` = ? WHERE `url` = ?"));
-        } else {
-            refreshStmt->reset();
+    // Access times that couldn't be written are dropped: they only affect the eviction order.
+    accessTimes.clear();
+}
+
+void SQLiteCache::Impl::checkLimits() {
+    if (evicting || destroying || (!maximumSize && !maximumEntries) || !db || !schema) {
+        return;
+    }
+
+    try {
+        if (excess(1.0)) {
+            evicting = true;
+            util::RunLoop::Get()->invoke([this] { evict(); });
         }
+    } catch (mapbox::sqlite::Exception& ex) {
+        Log::Error(Event::Database, ex.code, ex.what());
+    }
+}
 
-        const std::string unifiedURL = unifyMapboxURLs(resource.url);
-        refreshStmt->bind(1, int64_t(expires));
-        refreshStmt->bind(2, unifiedURL.c_str());
-        refreshStmt->run();
+void SQLiteCache::Impl::evict() {
+    try {
+        // Evict based on all writes and reads so far.
+        commit();
+        writeAccessTimes();
+
+        const uint64_t count = excess(evictionTarget);
+        if (count) {
+            if (!evictExpiredStmt) {
+                evictExpiredStmt = util::make_unique<Statement>(db->prepare(
+                    "DELETE FROM `http_cache` WHERE `url` IN (SELECT `url` FROM `http_cache` "
+                    //                    1                           2
+                    "WHERE `expires` < ? ORDER BY `accessed` LIMIT ?)"));
+            } else {
+                evictExpiredStmt->reset();
+            }
+
+            evictExpiredStmt->bind(1, now());
+            evictExpiredStmt->bind(2, int64_t(count));
+            evictExpiredStmt->run();
+            uint64_t evicted = db->changes();
+
+            if (evicted < count) {
+                if (!evictStmt) {
+                    evictStmt = util::make_unique<Statement>(db->prepare(
+                        "DELETE FROM `http_cache` WHERE `url` IN (SELECT `url` FROM `http_cache` "
+                        //                         1
+                        "ORDER BY `accessed` LIMIT ?)"));
+                } else {
+                    evictStmt->reset();
+                }
+
+                evictStmt->bind(1, int64_t(count - evicted));
+                evictStmt->run();
+                evicted += db->changes();
+            }
+
+            entries -= std::min(entries, evicted);
+
+            if (evicted) {
+                // Let the reads and writes that were queued in the meantime go first.
+                util::RunLoop::Get()->invoke([this] { evict(); });
+                return;
+            }
+        }
     } catch (mapbox::sqlite::Exception& ex) {
         Log::Error(Event::Database, ex.code, ex.what());
     }
+
+    evicting = false;
+}
+
+uint64_t SQLiteCache::Impl::excess(double fraction) {
+    uint64_t count = 0;
+
+    if (maximumEntries) {
+        const uint64_t target = maximumEntries * fraction;
+        if (!counted || entries > target) {
+            if (!countStmt) {
+                countStmt = util::make_unique<Statement>(
+                    db->prepare("SELECT COUNT(*) FROM `http_cache`"));
+            }
+
+            countStmt->run();
+            entries = countStmt->get<int64_t>(0);
+            countStmt->reset();
+            counted = true;
+        }
+
+        if (entries > target) {
+            count = entries - target;
+        }
+    }
+
+    // The size of the responses isn't known before they are evicted, so this evicts whole batches.
+    if (maximumSize && databaseSize() > maximumSize * fraction) {
+        count = evictionBatchSize;
+    }
+
+    return std::min(count, evictionBatchSize);
+}
+
+uint64_t SQLiteCache::Impl::databaseSize() {
+    if (!pageSize) {
+        Statement stmt = db->prepare("PRAGMA page_size");
+        stmt.run();
+        pageSize = stmt.get<int64_t>(0);
+    }
+
+    if (!pageCountStmt) {
+        pageCountStmt = util::make_unique<Statement>(db->prepare("PRAGMA page_count"));
+        freePageCountStmt = util::make_unique<Statement>(db->prepare("PRAGMA freelist_count"));
+    }
+
+    pageCountStmt->run();
+    freePageCountStmt->run();
+    const uint64_t pages = pageCountStmt->get<int64_t>(0) - freePageCountStmt->get<int64_t>(0);
+
+    // Don't keep the database locked for reading.
+    pageCountStmt->reset();
+    freePageCountStmt->reset();
+    return pages * pageSize;
 }
 
 }
@@ -2,6 +2,17 @@
 #define MBGL_STORAGE_DEFAULT_SQLITE_CACHE_IMPL
 
 #include <mbgl/storage/sqlite_cache.hpp>
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/util/chrono.hpp>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <uv.h>
 
 namespace mapbox {
 namespace sqlite {
@@ -12,25 +23,150 @@ class Statement;
 
 namespace mbgl {
 
+// The writes that weren't committed yet, by URL. They are recorded by the thread calling put(), so
+// that reads see them right away no matter which connection answers them. A later write to a URL
+// replaces the earlier one, which keeps the writes to a URL in order. Can be used from any thread.
+class SQLiteCache::PendingWrites {
+public:
+    // A write without a response only updates the expiration of the stored one.
+    struct Write {
+        Resource::Kind kind;
+        std::shared_ptr<const Response> response;
+        int64_t expires;
+        uint64_t sequence;
+    };
+
+    using Writes = std::vector<std::pair<std::string, Write>>;
+
+    void put(const std::string& url, Resource::Kind, std::shared_ptr<const Response>);
+    void refresh(const std::string& url, int64_t expires);
+    bool find(const std::string& url, Write&);
+    std::size_t size();
+
+    // Returns the writes to commit. Once committed, they are removed unless they were replaced
+    // in the meantime.
+    Writes take();
+    void remove(const Writes&);
+
+    // Set once the writer set up the database, so that readers can open it.
+    std::atomic<bool> ready { false };
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, Write> writes;
+    uint64_t sequence = 0;
+};
+
+// The writer. It owns the only connection that writes to the database, and answers reads until
+// the database is set up.
 class SQLiteCache::Impl {
 public:
-    Impl(const std::string &path = ":memory:");
+    Impl(const std::string &path, std::shared_ptr<PendingWrites>);
     ~Impl();
 
     std::unique_ptr<Response> get(const Resource&);
-    void put(const Resource& resource, std::shared_ptr<const Response> response);
-    void refresh(const Resource& resource, int64_t expires);
+
+    void setMaximumCacheSize(uint64_t size);
+    void setMaximumCacheEntries(uint64_t entries);
+    void setWriteBatch(std::size_t count, Duration interval);
+
+    // Commits the pending writes once there are enough of them, or once the timer fires.
+    void scheduleCommit();
+
+    // Records that a response was read. Access times are written in batches.
+    void touch(const std::string& url);
+
+    // Reads a response from the pending writes, or else from the database.
+    static std::unique_ptr<Response> read(PendingWrites&, ::mapbox::sqlite::Database&,
+                                          std::unique_ptr<::mapbox::sqlite::Statement>& stmt,
+                                          const std::string& url);
 
 private:
     void createDatabase();
     void createSchema();
 
+    // Switches the database to WAL mode, which lets the readers answer reads.
+    void enableReaders();
+
+    void commit();
+#if UV_VERSION_MAJOR == 0 && UV_VERSION_MINOR <= 10
+    static void onCommitTimeout(uv_timer_t *req, int status);
+#else
+    static void onCommitTimeout(uv_timer_t *req);
+#endif
+
+    void writeResponse(const std::string& url, Resource::Kind, const Response&, int64_t expires);
+    void writeExpires(const std::string& url, int64_t expires);
+
+    void writeAccessTimes();
+
+    // Starts evicting responses in the background if the cache grew beyond its limits.
+    void checkLimits();
+
+    // Evicts a batch of responses, and schedules the next batch until the cache shrank to a
+    // fraction of its limits, so that it doesn't have to evict again on the next put.
+    void evict();
+
+    // The number of responses to evict in one batch so that the cache shrinks to the fraction
+    // of its limits.
+    uint64_t excess(double fraction);
+
+    // The size of the pages that are in use, which excludes the space freed by evictions.
+    uint64_t databaseSize();
+
     const std::string path;
     std::unique_ptr<::mapbox::sqlite::Database> db;
     std::unique_ptr<::mapbox::sqlite::Statement> getStmt;
     std::unique_ptr<::mapbox::sqlite::Statement> putStmt;
     std::unique_ptr<::mapbox::sqlite::Statement> refreshStmt;
+    std::unique_ptr<::mapbox::sqlite::Statement> accessStmt;
+    std::unique_ptr<::mapbox::sqlite::Statement> evictExpiredStmt;
+    std::unique_ptr<::mapbox::sqlite::Statement> evictStmt;
+    std::unique_ptr<::mapbox::sqlite::Statement> countStmt;
+    std::unique_ptr<::mapbox::sqlite::Statement> pageCountStmt;
+    std::unique_ptr<::mapbox::sqlite::Statement> freePageCountStmt;
     bool schema = false;
+
+    const std::shared_ptr<PendingWrites> pending;
+    std::size_t writeBatchSize;
+    Duration writeInterval;
+    uv_timer_t *timer = nullptr;
+
+    std::unordered_map<std::string, int64_t> accessTimes;
+    bool accessTimesScheduled = false;
+
+    uint64_t maximumSize = 0;
+    uint64_t maximumEntries = 0;
+    uint64_t pageSize = 0;
+
+    // The number of responses, which is counted again when it may have exceeded the limit:
+    // puts that replace a response still increment it.
+    uint64_t entries = 0;
+    bool counted = false;
+    bool evicting = false;
+
+    // Set once the loop stopped, so that nothing is scheduled on it anymore.
+    bool destroying = false;
+};
+
+// Answers reads with a read-only connection of its own. In WAL mode, readers don't wait for the
+// writer, nor for each other.
+class SQLiteCache::Reader {
+public:
+    Reader(const std::string &path, std::shared_ptr<PendingWrites>,
+           std::function<void (const std::string&)> touch,
+           std::function<std::unique_ptr<Response> (const Resource&)> fallback);
+    ~Reader();
+
+    std::unique_ptr<Response> get(const Resource&);
+
+private:
+    const std::string path;
+    const std::shared_ptr<PendingWrites> pending;
+    const std::function<void (const std::string&)> touch;
+    const std::function<std::unique_ptr<Response> (const Resource&)> fallback;
+    std::unique_ptr<::mapbox::sqlite::Database> db;
+    std::unique_ptr<::mapbox::sqlite::Statement> getStmt;
 };
 
 
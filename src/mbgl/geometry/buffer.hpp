@@ -6,6 +6,7 @@
 #include <mbgl/map/environment.hpp>
 
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 #include <stdexcept>
 
@@ -67,6 +68,26 @@ public:
         return buffer;
     }
 
+    // Appends the elements of another buffer of the same kind. Neither of them may have been
+    // transferred to the GPU yet.
+    void append(const Buffer& other) {
+        if (buffer != 0 || other.buffer != 0) {
+            throw std::runtime_error("Can't append buffers that were bound to GPU");
+        }
+        if (other.pos == 0) {
+            return;
+        }
+        if (length < pos + other.pos) {
+            while (length < pos + other.pos) length += defaultLength;
+            array = realloc(array, length);
+            if (array == nullptr) {
+                throw std::runtime_error("Buffer reallocation failed");
+            }
+        }
+        std::memcpy(reinterpret_cast<char *>(array) + pos, other.array, other.pos);
+        pos += other.pos;
+    }
+
 protected:
     // increase the buffer size by at least /required/ bytes.
     inline void *addElement() {
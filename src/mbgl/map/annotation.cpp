@@ -127,7 +127,7 @@ std::pair<std::vector<TileID>, AnnotationIDs> AnnotationManager::addPointAnnotat
             // calculate tile coordinate
             const Coordinate coordinate(extent * (p.x * z2 - x), extent * (p.y * z2 - y));
 
-            const GeometryCollection geometries({ { { { coordinate } } } });
+            const GeometryCollection geometries({ { coordinate } });
 
             // at render time we style the annotation according to its {sprite} field
             const std::map<std::string, std::string> properties = {
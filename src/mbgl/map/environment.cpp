@@ -1,11 +1,14 @@
 #include <mbgl/map/environment.hpp>
 #include <mbgl/storage/file_source.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/util/async.hpp>
 #include <mbgl/platform/gl.hpp>
 
 #include <uv.h>
 
 #include <atomic>
 #include <cassert>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -31,13 +34,11 @@ public:
         assert(threadSet.size() == 0);
     }
 
+    // Scopes nest: a thread that enters one while it is in another one returns to the outer
+    // one when it leaves. The Map thread of a static map is the Main thread, for example.
     void registerThread(Environment* env, ThreadType type, const std::string& name) {
         std::lock_guard<std::mutex> lock(mtx);
-
-        // FIXME: We should never need to overwrite a thread here and we only allow
-        // this today because on the Static mode, the Map thread and the Main thread
-        // are same. Replace this with emplace() when this gets fixed.
-        threadSet[std::this_thread::get_id()] = ThreadInfo{ env, type, name };
+        threadSet[std::this_thread::get_id()].push_back(ThreadInfo{ env, type, name });
     }
 
     void unregisterThread() {
@@ -45,7 +46,10 @@ public:
 
         ThreadSet::iterator it = threadSet.find(std::this_thread::get_id());
         if (it != threadSet.end()) {
-            threadSet.erase(it);
+            it->second.pop_back();
+            if (it->second.empty()) {
+                threadSet.erase(it);
+            }
         }
     }
 
@@ -55,14 +59,14 @@ public:
 
         ThreadSet::const_iterator it = threadSet.find(std::this_thread::get_id());
         if (it != threadSet.end()) {
-            return it->second;
+            return it->second.back();
         } else {
             return emptyInfo;
         }
     }
 
 private:
-    typedef std::unordered_map<std::thread::id, ThreadInfo> ThreadSet;
+    typedef std::unordered_map<std::thread::id, std::vector<ThreadInfo>> ThreadSet;
     ThreadSet threadSet;
 
     mutable std::mutex mtx;
@@ -75,6 +79,16 @@ unsigned makeEnvironmentID() {
 
 ThreadInfoStore threadInfoStore;
 
+// Releases the canceler of a request's step when the request is done.
+struct Subscription {
+    explicit Subscription(util::Async<Response> async_) : async(std::move(async_)) {}
+    ~Subscription() {
+        async.release();
+    }
+
+    const util::Async<Response> async;
+};
+
 } // namespace
 
 EnvironmentScope::EnvironmentScope(Environment& env, ThreadType type, const std::string& name)
@@ -91,6 +105,10 @@ Environment::Environment(FileSource& fs)
     : id(makeEnvironmentID()), fileSource(fs), loop(uv_loop_new()) {
 }
 
+Environment::Environment(FileSource& fs, uv_loop_t* loop_)
+    : id(makeEnvironmentID()), fileSource(fs), loop(loop_) {
+}
+
 Environment::~Environment() {
     assert(abandonedVAOs.empty());
     assert(abandonedTextures.empty());
@@ -120,9 +138,68 @@ unsigned Environment::getID() const {
     return id;
 }
 
+util::Async<Response> Environment::requestAsync(const Resource& resource) {
+    // The request is gone once it was answered, so it is only canceled before that. The response
+    // may arrive in any thread, before request() returns or while the step is canceled.
+    struct Answered {
+        std::mutex mutex;
+        bool answered = false;
+    };
+    auto state = std::make_shared<Answered>();
+
+    auto async = util::Async<Response>::pending();
+    Request* req = fileSource.request(resource, nullptr, *this, [async, state](const Response& res) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->answered = true;
+        }
+        async.resolve(res);
+    });
+    if (req) {
+        async.onCancel([this, req, state] {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (!state->answered) {
+                fileSource.cancel(req);
+            }
+        });
+    }
+    return async;
+}
+
+util::Async<Response> Environment::request(const Resource& resource) {
+    return requestWithUpdates(resource, nullptr);
+}
+
+util::Async<Response> Environment::requestWithUpdates(const Resource& resource,
+                                                      std::function<void(const Response&)> onUpdate) {
+    assert(currentlyOn(ThreadType::Map));
+    auto async = util::Async<Response>::pending();
+
+    // A request that answered with a stale response goes on until it was revalidated, so the
+    // step keeps canceling it after it completed. The request is deleted along with its callback
+    // once it was notified for the last time, which releases the step's canceler.
+    std::shared_ptr<Subscription> subscription = std::make_shared<Subscription>(async);
+    Request* req = request(resource, [async, onUpdate, subscription](const Response& res) {
+        if (!async.isResolved()) {
+            async.resolveAndKeepCanceler(res);
+        } else if (onUpdate) {
+            onUpdate(res);
+        }
+    });
+    if (req) {
+        async.onCancel([this, req] {
+            cancelRequest(req);
+        });
+    }
+    return async;
+}
+
 void Environment::requestAsync(const Resource& resource,
                                std::function<void(const Response&)> callback) {
-    fileSource.request(resource, *this, std::move(callback));
+    auto async = requestAsync(resource);
+    if (callback) {
+        async.then(std::move(callback));
+    }
 }
 
 Request* Environment::request(const Resource& resource,
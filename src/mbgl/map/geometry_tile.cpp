@@ -1,9 +1,25 @@
 #include <mbgl/map/geometry_tile.hpp>
 #include <mbgl/style/filter_expression.hpp>
 #include <mbgl/style/filter_expression_private.hpp>
+#include <mbgl/util/std.hpp>
 
 namespace mbgl {
 
+GeometryCollection::GeometryCollection(std::initializer_list<std::initializer_list<Coordinate>> lines) {
+    for (const auto& line : lines) {
+        addLine();
+        coordinates.insert(coordinates.end(), line.begin(), line.end());
+    }
+}
+
+void GeometryCollection::append(const GeometryCollection& other) {
+    const uint32_t base = coordinates.size();
+    for (uint32_t offset : other.offsets) {
+        offsets.push_back(base + offset);
+    }
+    coordinates.insert(coordinates.end(), other.coordinates.begin(), other.coordinates.end());
+}
+
 mapbox::util::optional<Value> GeometryTileFeatureExtractor::getValue(const std::string& key) const {
     if (key == "$type") {
         return Value(uint64_t(feature.getType()));
@@ -14,4 +30,25 @@ mapbox::util::optional<Value> GeometryTileFeatureExtractor::getValue(const std::
 
 template bool evaluate(const FilterExpression&, const GeometryTileFeatureExtractor&);
 
+namespace {
+
+class ExpressionFilter : public GeometryTileFilter {
+public:
+    ExpressionFilter(const FilterExpression& expression_)
+        : expression(expression_) {}
+
+    bool evaluate(const GeometryTileFeature& feature) const override {
+        return mbgl::evaluate(expression, GeometryTileFeatureExtractor(feature));
+    }
+
+private:
+    const FilterExpression& expression;
+};
+
+}
+
+std::unique_ptr<GeometryTileFilter> GeometryTileLayer::compileFilter(const FilterExpression& expression) const {
+    return util::make_unique<ExpressionFilter>(expression);
+}
+
 }
@@ -2,6 +2,7 @@
 #define MBGL_MAP_GEOMETRY_TILE
 
 #include <mbgl/style/value.hpp>
+#include <mbgl/style/filter_expression.hpp>
 #include <mbgl/util/optional.hpp>
 #include <mbgl/util/ptr.hpp>
 #include <mbgl/util/variant.hpp>
@@ -9,6 +10,8 @@
 #include <mbgl/util/noncopyable.hpp>
 
 #include <cstdint>
+#include <initializer_list>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -21,19 +24,131 @@ enum class FeatureType : uint8_t {
     Polygon = 3
 };
 
-typedef std::vector<std::vector<Coordinate>> GeometryCollection;
+class GeometryCollection;
+
+// A line or ring of a geometry. It refers to coordinates owned by a GeometryCollection and is only
+// valid until that collection is modified.
+class GeometryLine {
+public:
+    GeometryLine(const Coordinate* begin_, const Coordinate* end_)
+        : first(begin_), last(end_) {}
+
+    const Coordinate* begin() const { return first; }
+    const Coordinate* end() const { return last; }
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    const Coordinate& front() const { return *first; }
+    const Coordinate& back() const { return *(last - 1); }
+    const Coordinate& operator[](std::size_t i) const { return first[i]; }
+
+private:
+    const Coordinate* first;
+    const Coordinate* last;
+};
+
+// A run of consecutive lines of a GeometryCollection, typically the lines of one feature.
+class GeometryLines {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const GeometryCollection& collection_, std::size_t index_)
+            : collection(&collection_), index(index_) {}
+
+        inline GeometryLine operator*() const;
+        const_iterator& operator++() { ++index; return *this; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+    private:
+        const GeometryCollection* collection;
+        std::size_t index;
+    };
+
+    GeometryLines(const GeometryCollection& collection_, std::size_t first_, std::size_t last_)
+        : collection(collection_), first(first_), last(last_) {}
+
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    inline GeometryLine operator[](std::size_t i) const;
+    const_iterator begin() const { return const_iterator(collection, first); }
+    const_iterator end() const { return const_iterator(collection, last); }
+
+private:
+    const GeometryCollection& collection;
+    const std::size_t first;
+    const std::size_t last;
+};
+
+// The lines of one or more geometries, stored in one contiguous coordinate array along with the
+// offset at which each line starts. Clearing a collection keeps its memory, so decoding features
+// into the same collection one after another doesn't allocate for every feature.
+class GeometryCollection {
+public:
+    GeometryCollection() = default;
+    GeometryCollection(std::initializer_list<std::initializer_list<Coordinate>>);
+
+    std::size_t size() const { return offsets.size(); }
+    bool empty() const { return offsets.empty(); }
+    GeometryLine operator[](std::size_t i) const {
+        const Coordinate* data = coordinates.data();
+        return GeometryLine(data + offsets[i],
+                            data + (i + 1 < offsets.size() ? offsets[i + 1] : coordinates.size()));
+    }
+    GeometryLine back() const { return (*this)[size() - 1]; }
+
+    operator GeometryLines() const { return GeometryLines(*this, 0, size()); }
+    GeometryLines::const_iterator begin() const { return GeometryLines::const_iterator(*this, 0); }
+    GeometryLines::const_iterator end() const { return GeometryLines::const_iterator(*this, size()); }
+
+    void clear() {
+        coordinates.clear();
+        offsets.clear();
+    }
+
+    // Starts a new line. Subsequent coordinates are added to it.
+    void addLine() { offsets.push_back(coordinates.size()); }
+    void addCoordinate(const Coordinate& coordinate) { coordinates.push_back(coordinate); }
+
+    // Appends all lines of another collection.
+    void append(const GeometryCollection&);
+
+private:
+    std::vector<Coordinate> coordinates;
+    std::vector<uint32_t> offsets;
+};
+
+GeometryLine GeometryLines::const_iterator::operator*() const {
+    return (*collection)[index];
+}
+
+GeometryLine GeometryLines::operator[](std::size_t i) const {
+    return collection[first + i];
+}
 
 class GeometryTileFeature : private util::noncopyable {
 public:
     virtual FeatureType getType() const = 0;
     virtual mapbox::util::optional<Value> getValue(const std::string& key) const = 0;
-    virtual GeometryCollection getGeometries() const = 0;
+
+    // Appends the lines of this feature to the collection.
+    virtual void getGeometries(GeometryCollection&) const = 0;
+};
+
+// A filter expression prepared for evaluating the features of one particular layer.
+class GeometryTileFilter : private util::noncopyable {
+public:
+    virtual ~GeometryTileFilter() = default;
+    virtual bool evaluate(const GeometryTileFeature&) const = 0;
 };
 
 class GeometryTileLayer : private util::noncopyable {
 public:
     virtual std::size_t featureCount() const = 0;
     virtual util::ptr<const GeometryTileFeature> getFeature(std::size_t) const = 0;
+
+    // The returned filter may only be used with features of this layer, and only from one thread
+    // at a time. The default implementation evaluates the expression against each feature's values.
+    virtual std::unique_ptr<GeometryTileFilter> compileFilter(const FilterExpression&) const;
 };
 
 class GeometryTile : private util::noncopyable {
@@ -13,7 +13,7 @@ public:
 
     FeatureType getType() const override { return type; }
     mapbox::util::optional<Value> getValue(const std::string&) const override;
-    GeometryCollection getGeometries() const override { return geometries; }
+    void getGeometries(GeometryCollection& lines) const override { lines.append(geometries); }
 
 private:
     FeatureType type = FeatureType::Unknown;
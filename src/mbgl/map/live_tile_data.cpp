@@ -27,7 +27,7 @@ LiveTileData::LiveTileData(const TileID& id_,
 LiveTileData::~LiveTileData() {}
 
 void LiveTileData::parse() {
-    if (state != State::loaded) {
+    if (state != State::loaded && state != State::partial) {
         return;
     }
 
@@ -35,19 +35,26 @@ void LiveTileData::parse() {
 
     if (tile) {
         try {
-            if (!style) {
+            const util::ptr<Style> parseStyle = style ? style : partialStyle.lock();
+            if (!parseStyle) {
                 throw std::runtime_error("style isn't present in LiveTileData object anymore");
             }
 
             // Parsing creates state that is encapsulated in TileParser. While parsing,
             // the TileParser object writes results into this objects. All other state
             // is going to be discarded afterwards.
-            TileParser parser(*tile, *this, style, glyphAtlas, glyphStore, spriteAtlas, sprite);
+            TileParser parser(*tile, *this, parseStyle, glyphAtlas, glyphStore, spriteAtlas, sprite);
 
             // Clear the style so that we don't have a cycle in the shared_ptr references.
             style.reset();
 
             parser.parse();
+
+            if (dependencies.empty()) {
+                partialStyle.reset();
+            } else {
+                partialStyle = parseStyle;
+            }
         } catch (const std::exception& ex) {
             Log::Error(Event::ParseTile, "Live-parsing [%d/%d/%d] failed: %s", id.z, id.x, id.y, ex.what());
             state = State::obsolete;
@@ -61,6 +68,6 @@ void LiveTileData::parse() {
     }
 
     if (state != State::obsolete) {
-        state = State::parsed;
+        state = dependencies.empty() ? State::parsed : State::partial;
     }
 }
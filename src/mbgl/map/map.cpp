@@ -29,8 +29,10 @@
 #include <mbgl/util/mapbox.hpp>
 #include <mbgl/util/exception.hpp>
 #include <mbgl/util/worker.hpp>
+#include <mbgl/util/async.hpp>
 
 #include <algorithm>
+#include <future>
 #include <iostream>
 
 #define _USE_MATH_DEFINES
@@ -136,6 +138,9 @@ void Map::start(bool startPaused, Mode renderMode) {
 
         terminating = true;
 
+        // Glyphs that arrive from now on don't post to the handles anymore.
+        glyphStore->setObserver(nullptr);
+
         // Closes all open handles on the loop. This means that the loop will automatically terminate.
         asyncRender.reset();
         asyncUpdate.reset();
@@ -169,6 +174,11 @@ void Map::start(bool startPaused, Mode renderMode) {
         condRendered.notify_all();
     });
 
+    // Called from the file source's thread, so the update is posted to the Map thread.
+    glyphStore->setObserver([this] {
+        invokeTask([this] { triggerUpdate(); });
+    });
+
     // Do we need to pause first?
     if (startPaused) {
         pause();
@@ -276,7 +286,15 @@ void Map::run() {
     view.activate();
     view.discard();
 
-    workers = util::make_unique<Worker>(env->loop, 4);
+    if (data->getSharedWorkers()) {
+        workers = util::make_unique<Worker>(env->loop, WorkerPool::shared());
+        if (data->getWorkerThreadCount()) {
+            workers->setThreadCount(data->getWorkerThreadCount());
+        }
+    } else {
+        workers = util::make_unique<Worker>(env->loop, data->getWorkerThreadCount(), data->getWorkerCPUAffinity());
+    }
+    Log::Info(Event::Setup, "Parsing tiles on %u worker threads", unsigned(workers->getThreadCount()));
 
     setup();
     prepare();
@@ -454,6 +472,7 @@ util::ptr<Sprite> Map::getSprite() {
     const std::string &sprite_url = style->getSpriteURL();
     if (!sprite || !sprite->hasPixelRatio(pixelRatio)) {
         sprite = Sprite::Create(sprite_url, pixelRatio, *env);
+        sprite->setObserver([this] { triggerUpdate(); });
     }
 
     return sprite;
@@ -716,12 +735,21 @@ Duration Map::getDefaultTransitionDuration() {
 void Map::updateTiles() {
     assert(Environment::currentlyOn(ThreadType::Map));
     if (!style) return;
+    bool partial = false;
     for (const auto& source : style->sources) {
         source->update(*this, getWorker(), style, *glyphAtlas, *glyphStore,
                                *spriteAtlas, getSprite(), *texturePool, [this]() {
             assert(Environment::currentlyOn(ThreadType::Map));
             triggerUpdate();
         });
+        partial |= source->hasPartialTiles();
+    }
+
+    // Glyphs and sprites trigger an update once they are loaded, which resumes parsing the
+    // partially parsed tiles. Until then, keep the loop running so that still images wait for
+    // the symbols.
+    if (partial) {
+        asyncUpdate->ref();
     }
 }
 
@@ -743,9 +771,9 @@ void Map::reloadStyle() {
     if (!styleInfo.url.empty()) {
         const auto base = styleInfo.base;
         // We have a style URL
-        env->request({ Resource::Kind::JSON, styleInfo.url }, [this, base](const Response &res) {
+        env->request({ Resource::Kind::JSON, styleInfo.url }).then([this, base](const Response &res) {
             if (res.status == Response::Successful) {
-                loadStyleJSON(res.data, base);
+                loadStyleJSON(*res.data, base);
             } else {
                 Log::Error(Event::Setup, "loading style failed: %s", res.message.c_str());
             }
@@ -875,6 +903,36 @@ void Map::setSourceTileCacheSize(size_t size) {
     }
 }
 
+void Map::setWorkerThreadCount(size_t count) {
+    data->setWorkerThreadCount(count);
+    invokeTask([=] {
+        if (!workers) return;
+        workers->setThreadCount(count);
+        Log::Info(Event::Setup, "Parsing tiles on %u worker threads", unsigned(workers->getThreadCount()));
+    });
+}
+
+size_t Map::getWorkerThreadCount() const {
+    const size_t count = data->getWorkerThreadCount();
+    return count ? count : Worker::defaultThreadCount();
+}
+
+void Map::setWorkerCPUAffinity(bool value) {
+    data->setWorkerCPUAffinity(value);
+}
+
+bool Map::getWorkerCPUAffinity() const {
+    return data->getWorkerCPUAffinity();
+}
+
+void Map::setSharedWorkers(bool value) {
+    data->setSharedWorkers(value);
+}
+
+bool Map::getSharedWorkers() const {
+    return data->getSharedWorkers();
+}
+
 void Map::onLowMemory() {
     invokeTask([=] {
         if (!style) return;
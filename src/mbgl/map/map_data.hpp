@@ -80,6 +80,28 @@ public:
         animationTime = timePoint.time_since_epoch();
     };
 
+    // A worker thread count of 0 means one thread per hardware thread.
+    inline std::size_t getWorkerThreadCount() const {
+        return workerThreadCount;
+    }
+    inline void setWorkerThreadCount(std::size_t count) {
+        workerThreadCount = count;
+    }
+
+    inline bool getWorkerCPUAffinity() const {
+        return workerCPUAffinity;
+    }
+    inline void setWorkerCPUAffinity(bool value) {
+        workerCPUAffinity = value;
+    }
+
+    inline bool getSharedWorkers() const {
+        return sharedWorkers;
+    }
+    inline void setSharedWorkers(bool value) {
+        sharedWorkers = value;
+    }
+
     inline Duration getDefaultTransitionDuration() const {
         return defaultTransitionDuration;
     }
@@ -96,6 +118,9 @@ private:
     std::atomic<uint8_t> debug { false };
     std::atomic<Duration> animationTime;
     std::atomic<Duration> defaultTransitionDuration;
+    std::atomic<std::size_t> workerThreadCount { 0 };
+    std::atomic<bool> workerCPUAffinity { false };
+    std::atomic<bool> sharedWorkers { false };
 };
 
 }
@@ -0,0 +1,284 @@
+#include <mbgl/map/offline_region.hpp>
+#include <mbgl/map/environment.hpp>
+#include <mbgl/map/source.hpp>
+#include <mbgl/style/style.hpp>
+#include <mbgl/style/style_layer.hpp>
+#include <mbgl/style/style_bucket.hpp>
+#include <mbgl/style/style_layout.hpp>
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/platform/log.hpp>
+#include <mbgl/util/async.hpp>
+#include <mbgl/util/box.hpp>
+#include <mbgl/util/constants.hpp>
+#include <mbgl/util/mapbox.hpp>
+#include <mbgl/util/std.hpp>
+#include <mbgl/util/string.hpp>
+#include <mbgl/util/tile_cover.hpp>
+#include <mbgl/util/token.hpp>
+#include <mbgl/util/url.hpp>
+
+#include <rapidjson/document.h>
+
+#include <cmath>
+#include <deque>
+#include <list>
+#include <set>
+#include <unordered_set>
+
+namespace mbgl {
+
+namespace {
+
+// Glyphs are requested in ranges of 256 code points, up to the end of the Basic Multilingual Plane.
+const uint32_t glyphRangeSize = 256;
+const uint32_t glyphRangeEnd = 65536;
+
+// Converts a coordinate to tile coordinates at zoom level z.
+vec2<double> project(const LatLng& latLng, int8_t z) {
+    const double scale = std::pow(2, z);
+    const double latitude = std::fmin(std::fmax(latLng.latitude, -util::LATITUDE_MAX), util::LATITUDE_MAX);
+    const double longitude = std::fmin(std::fmax(latLng.longitude, -180.0), 180.0);
+    const double y = util::RAD2DEG * std::log(std::tan(M_PI / 4 + latitude * util::DEG2RAD / 2));
+    return {
+        (180.0 + longitude) / 360.0 * scale,
+        (180.0 - y) / 360.0 * scale
+    };
+}
+
+std::forward_list<TileID> coveringTiles(const LatLngBounds& bounds, int8_t z) {
+    box points;
+    points.tl = project({ bounds.ne.latitude, bounds.sw.longitude }, z);
+    points.tr = project({ bounds.ne.latitude, bounds.ne.longitude }, z);
+    points.bl = project({ bounds.sw.latitude, bounds.sw.longitude }, z);
+    points.br = project({ bounds.sw.latitude, bounds.ne.longitude }, z);
+    points.center = { (points.tl.x + points.br.x) / 2, (points.tl.y + points.br.y) / 2 };
+
+    const int32_t tiles = 1 << z;
+    auto ids = tileCover(z, points);
+    ids.remove_if([tiles](const TileID& id) {
+        return id.x < 0 || id.x >= tiles || id.y < 0 || id.y >= tiles;
+    });
+    return ids;
+}
+
+}
+
+class OfflineRegion::Impl {
+public:
+    Impl(FileSource& fileSource, uv_loop_t* loop, const OfflineRegionDefinition& definition_,
+         const std::string& accessToken_)
+        : env(fileSource, loop), definition(definition_), accessToken(accessToken_) {
+    }
+
+    void download(Callback callback_) {
+        EnvironmentScope scope(env, ThreadType::Map, "OfflineRegion");
+        callback = std::move(callback_);
+        queue({ Resource::Kind::JSON, util::mapbox::normalizeStyleURL(definition.styleURL, accessToken) },
+              [this](const Response& res) { loadStyle(res); });
+        next();
+    }
+
+    void cancel() {
+        EnvironmentScope scope(env, ThreadType::Map, "OfflineRegion");
+        for (const auto& request : active) {
+            request.cancel();
+        }
+        active.clear();
+        queued.clear();
+    }
+
+    std::size_t maximumConcurrency = 8;
+    Progress progress;
+
+private:
+    struct Task {
+        Resource resource;
+        std::function<void(const Response&)> onLoad;
+    };
+
+    void queue(const Resource& resource, std::function<void(const Response&)> onLoad = nullptr) {
+        // Sources and fonts may share resources, which only need to be loaded once.
+        if (!seen.insert(resource.url).second) {
+            return;
+        }
+        // The map's own requests go first.
+        queued.push_back({ { resource.kind, resource.url, Resource::Priority::Prefetch }, std::move(onLoad) });
+        progress.total++;
+    }
+
+    // Starts the queued requests, up to the maximum number of concurrent ones.
+    void next() {
+        while (active.size() < maximumConcurrency && !queued.empty()) {
+            Task task = std::move(queued.front());
+            queued.pop_front();
+
+            auto it = active.insert(active.end(), env.request(task.resource));
+            auto onLoad = std::move(task.onLoad);
+            it->then([this, it, onLoad](const Response& res) {
+                EnvironmentScope scope(env, ThreadType::Map, "OfflineRegion");
+                active.erase(it);
+                finish(res, onLoad);
+            });
+        }
+    }
+
+    void finish(const Response& res, const std::function<void(const Response&)>& onLoad) {
+        progress.completed++;
+        if (res.status == Response::Successful) {
+            progress.bytes += res.data->size();
+            if (onLoad) {
+                onLoad(res);
+            }
+        } else if (res.status != Response::NotFound) {
+            // Missing resources are cached as such, and don't fail the download.
+            progress.failed++;
+        }
+
+        next();
+
+        progress.complete = active.empty() && queued.empty();
+        if (callback) {
+            callback(progress);
+        }
+    }
+
+    void loadStyle(const Response& res) {
+        Style style;
+        style.loadJSON(reinterpret_cast<const uint8_t*>(res.data->c_str()));
+
+        for (const auto& source : style.sources) {
+            if (source->info.type != SourceType::Vector && source->info.type != SourceType::Raster) {
+                continue;
+            }
+
+            if (source->info.url.empty()) {
+                loadTiles(source->info);
+                continue;
+            }
+
+            const std::string url = util::mapbox::normalizeSourceURL(source->info.url, accessToken);
+            queue({ Resource::Kind::JSON, url }, [this, source](const Response& tileJSON) {
+                rapidjson::Document d;
+                d.Parse<0>(tileJSON.data->c_str());
+
+                if (d.HasParseError()) {
+                    Log::Warning(Event::General, "Invalid source TileJSON; Parse Error at %d: %s", d.GetErrorOffset(), d.GetParseError());
+                    return;
+                }
+
+                source->info.parseTileJSONProperties(d);
+                loadTiles(source->info);
+            });
+        }
+
+        const std::string& spriteURL = style.getSpriteURL();
+        if (!spriteURL.empty()) {
+            const std::string base = spriteURL + (definition.pixelRatio > 1 ? "@2x" : "");
+            queue({ Resource::Kind::JSON, base + ".json" });
+            queue({ Resource::Kind::Image, base + ".png" });
+        }
+
+        if (!style.glyph_url.empty()) {
+            loadGlyphs(style);
+        }
+    }
+
+    void loadTiles(const SourceInfo& info) {
+        if (info.tiles.empty()) {
+            return;
+        }
+
+        // Sources with smaller tiles are shown at a higher zoom level, like Source::getZoom does.
+        const int32_t offset = std::round(std::log2(util::tileSize / info.tile_size));
+
+        for (int32_t zoom = definition.minZoom; zoom <= definition.maxZoom; zoom++) {
+            int32_t z = zoom + offset;
+            if (z < info.min_zoom) continue;
+            if (z > info.max_zoom) z = info.max_zoom;
+
+            for (const auto& id : coveringTiles(definition.bounds, z)) {
+                queue({ Resource::Kind::Tile, info.tileURL(id, definition.pixelRatio) });
+            }
+        }
+    }
+
+    // Symbol layers with labels load glyphs for all ranges of their fonts, since the labels in
+    // the region aren't known until its tiles are parsed.
+    void loadGlyphs(const Style& style) {
+        std::set<std::string> fontStacks;
+        for (const auto& layer : style.layers) {
+            const auto& bucket = layer->bucket;
+            if (!bucket || bucket->type != StyleLayerType::Symbol) {
+                continue;
+            }
+
+            const auto& properties = bucket->layout.properties;
+            if (properties.find(PropertyKey::TextField) == properties.end()) {
+                continue;
+            }
+
+            const auto font = properties.find(PropertyKey::TextFont);
+            if (font == properties.end()) {
+                fontStacks.insert(defaultStyleLayout<StyleLayoutSymbol>().text.font);
+            } else if (font->second.is<Function<std::string>>()) {
+                const auto& function = font->second.get<Function<std::string>>();
+                for (int32_t z = definition.minZoom; z <= definition.maxZoom; z++) {
+                    fontStacks.insert(mapbox::util::apply_visitor(FunctionEvaluator<std::string>(z), function));
+                }
+            }
+        }
+
+        const std::string glyphURL = util::mapbox::normalizeGlyphsURL(style.glyph_url, accessToken);
+        for (const auto& fontStack : fontStacks) {
+            if (fontStack.empty()) {
+                continue;
+            }
+            for (uint32_t start = 0; start < glyphRangeEnd; start += glyphRangeSize) {
+                const std::string url = util::replaceTokens(glyphURL, [&](const std::string &name) -> std::string {
+                    if (name == "fontstack") return util::percentEncode(fontStack);
+                    if (name == "range") return util::toString(start) + "-" + util::toString(start + glyphRangeSize - 1);
+                    return "";
+                });
+                queue({ Resource::Kind::Glyphs, url });
+            }
+        }
+    }
+
+    // Requests are made in a scope of this environment, which answers them in the caller's loop.
+    Environment env;
+    const OfflineRegionDefinition definition;
+    const std::string accessToken;
+    Callback callback;
+
+    std::deque<Task> queued;
+    std::list<util::Async<Response>> active;
+    std::unordered_set<std::string> seen;
+};
+
+OfflineRegion::OfflineRegion(FileSource& fileSource, uv_loop_t* loop,
+                             const OfflineRegionDefinition& definition, const std::string& accessToken)
+    : impl(util::make_unique<Impl>(fileSource, loop, definition, accessToken)) {
+}
+
+OfflineRegion::~OfflineRegion() {
+    impl->cancel();
+}
+
+void OfflineRegion::setMaximumConcurrency(std::size_t count) {
+    impl->maximumConcurrency = count ? count : 1;
+}
+
+void OfflineRegion::download(Callback callback) {
+    impl->download(std::move(callback));
+}
+
+void OfflineRegion::cancel() {
+    impl->cancel();
+}
+
+const OfflineRegion::Progress& OfflineRegion::getProgress() const {
+    return impl->progress;
+}
+
+}
@@ -17,7 +17,7 @@ void RasterTileData::parse() {
         return;
     }
 
-    if (bucket.setImage(data)) {
+    if (bucket.setImage(*data)) {
         state = State::parsed;
     } else {
         state = State::invalid;
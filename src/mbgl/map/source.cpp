@@ -15,6 +15,7 @@
 #include <mbgl/util/std.hpp>
 #include <mbgl/util/box.hpp>
 #include <mbgl/util/mapbox.hpp>
+#include <mbgl/util/async.hpp>
 #include <mbgl/geometry/glyph_atlas.hpp>
 #include <mbgl/style/style_layer.hpp>
 #include <mbgl/platform/log.hpp>
@@ -137,14 +138,14 @@ void Source::load(const std::string& accessToken,
     util::ptr<Source> source = shared_from_this();
 
     const std::string url = util::mapbox::normalizeSourceURL(info.url, accessToken);
-    env.request({ Resource::Kind::JSON, url }, [source, callback](const Response &res) {
+    env.request({ Resource::Kind::JSON, url }).then([source, callback](const Response &res) {
         if (res.status != Response::Successful) {
             Log::Warning(Event::General, "Failed to load source TileJSON: %s", res.message.c_str());
             return;
         }
 
         rapidjson::Document d;
-        d.Parse<0>(res.data.c_str());
+        d.Parse<0>(res.data->c_str());
 
         if (d.HasParseError()) {
             Log::Warning(Event::General, "Invalid source TileJSON; Parse Error at %d: %s", d.GetErrorOffset(), d.GetParseError());
@@ -178,7 +179,7 @@ void Source::render(Painter &painter, const StyleLayer &layer_desc) {
     gl::group group(std::string { "layer: " } + layer_desc.id);
     for (const auto& pair : tiles) {
         Tile &tile = *pair.second;
-        if (tile.data && tile.data->state == TileData::State::parsed) {
+        if (tile.data && tile.data->renderable()) {
             painter.renderTileLayer(tile, layer_desc, tile.matrix);
         }
     }
@@ -195,7 +196,7 @@ std::forward_list<Tile *> Source::getLoadedTiles() const {
     std::forward_list<Tile *> ptrs;
     auto it = ptrs.before_begin();
     for (const auto &pair : tiles) {
-        if (pair.second->data->ready()) {
+        if (pair.second->data->renderable()) {
             it = ptrs.insert_after(it, pair.second.get());
         }
     }
@@ -220,6 +221,12 @@ TileData::State Source::addTile(Map &map, Worker &worker,
                                 GlyphStore &glyphStore, SpriteAtlas &spriteAtlas,
                                 util::ptr<Sprite> sprite, TexturePool &texturePool,
                                 const TileID &id, std::function<void()> callback) {
+    auto existing = tiles.find(id);
+    if (existing != tiles.end() && existing->second->data && existing->second->data->isOutdated()) {
+        // The response changed since the tile was loaded. Load it again.
+        tiles.erase(existing);
+    }
+
     const TileData::State state = hasTile(id);
 
     if (state != TileData::State::invalid) {
@@ -239,13 +246,17 @@ TileData::State Source::addTile(Map &map, Worker &worker,
         new_tile.data = it->second.lock();
     }
 
-    if (new_tile.data && new_tile.data->state == TileData::State::obsolete) {
+    if (new_tile.data && (new_tile.data->state == TileData::State::obsolete ||
+                          new_tile.data->isOutdated())) {
         // Do not consider the tile if it's already obsolete.
         new_tile.data.reset();
     }
 
     if (!new_tile.data) {
         new_tile.data = cache.get(normalized_id.to_uint64());
+        if (new_tile.data && new_tile.data->isOutdated()) {
+            new_tile.data.reset();
+        }
     }
 
     if (!new_tile.data) {
@@ -267,7 +278,7 @@ TileData::State Source::addTile(Map &map, Worker &worker,
         } else {
             throw std::runtime_error("source type not implemented");
         }
-        tile_data.emplace(new_tile.data->id, new_tile.data);
+        tile_data[new_tile.data->id] = new_tile.data;
     }
 
     return new_tile.data->state;
@@ -377,12 +388,32 @@ void Source::update(Map &map,
     // parent or child tiles that are *already* loaded.
     std::forward_list<TileID> retain(required);
 
+    // Parse the tiles closest to the center of the viewport and to the ideal zoom level first.
+    // Tiles that are only retained are already parsed, and tiles that went out of view are
+    // canceled below, so only the required tiles need a priority.
+    const double idealZoom = getZoom(map.getState());
+    const int32_t coveringZoom = required.empty() ? 0 : required.front().z;
+    const vec2<double> center = map.getState().cornersToBox(coveringZoom).center;
+
     // Add existing child/parent tiles if the actual tile is not yet loaded
     for (const auto& id : required) {
         const TileData::State state = addTile(map, worker, style, glyphAtlas, glyphStore,
                                               spriteAtlas, sprite, texturePool, id, callback);
 
-        if (state != TileData::State::parsed) {
+        auto it = tiles.find(id);
+        if (it != tiles.end() && it->second->data) {
+            it->second->data->setPriority(std::fabs(id.x + 0.5 - center.x) +
+                                          std::fabs(id.y + 0.5 - center.y) +
+                                          std::fabs(idealZoom - id.z));
+
+            // Parse the symbols that waited for glyphs or sprites, once these are loaded.
+            if (state == TileData::State::partial) {
+                it->second->data->resume(worker, callback);
+            }
+        }
+
+        // Partially parsed tiles are rendered while their symbols wait.
+        if (state != TileData::State::parsed && state != TileData::State::partial) {
             // The tile we require is not yet loaded. Try to find a parent or
             // child tile that we already have.
 
@@ -417,7 +448,7 @@ void Source::update(Map &map,
         bool obsolete = std::find(retain.begin(), retain.end(), tile.id) == retain.end();
         if (!obsolete) {
             retain_data.insert(tile.data->id);
-        } else if (type != SourceType::Raster && tile.data->ready()) {
+        } else if (type != SourceType::Raster && tile.data->ready() && !tile.data->isOutdated()) {
             tileCache.add(tile.id.normalized().to_uint64(), tile.data);
         }
         return obsolete;
@@ -444,6 +475,15 @@ void Source::update(Map &map,
     updated = map.getTime();
 }
 
+bool Source::hasPartialTiles() const {
+    for (const auto& pair : tiles) {
+        if (pair.second->data && pair.second->data->state == TileData::State::partial) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Source::invalidateTiles(const std::vector<TileID>& ids) {
     cache.clear();
     for (auto& id : ids) {
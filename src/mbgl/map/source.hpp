@@ -66,6 +66,9 @@ public:
 
     void invalidateTiles(const std::vector<TileID>&);
 
+    // Whether some tiles are rendered without the symbols that wait for glyphs or sprites.
+    bool hasPartialTiles() const;
+
     void updateMatrices(const mat4 &projMatrix, const TransformState &transform);
     void drawClippingMasks(Painter &painter);
     void render(Painter &painter, const StyleLayer &layer_desc);
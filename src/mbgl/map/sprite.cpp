@@ -8,6 +8,7 @@
 #include <mbgl/map/environment.hpp>
 #include <mbgl/storage/resource.hpp>
 #include <mbgl/storage/response.hpp>
+#include <mbgl/util/async.hpp>
 #include <mbgl/util/uv_detail.hpp>
 #include <mbgl/util/std.hpp>
 
@@ -37,19 +38,13 @@ Sprite::Sprite(const Key &, const std::string& base_url, float pixelRatio_)
       jsonURL(base_url + (pixelRatio_ > 1 ? "@2x" : "") + ".json"),
       raster(),
       loadedImage(false),
-      loadedJSON(false),
-      future(promise.get_future()) {
+      loadedJSON(false) {
 }
 
 bool Sprite::hasPixelRatio(float ratio) const {
     return pixelRatio == (ratio > 1 ? 2 : 1);
 }
 
-
-void Sprite::waitUntilLoaded() const {
-    future.wait();
-}
-
 Sprite::operator bool() const {
     return valid && isLoaded() && !pos.empty();
 }
@@ -63,15 +58,14 @@ void Sprite::load(Environment &env) {
         // Treat a non-existent sprite as a successfully loaded empty sprite.
         loadedImage = true;
         loadedJSON = true;
-        promise.set_value();
         return;
     }
 
     util::ptr<Sprite> sprite = shared_from_this();
 
-    env.request({ Resource::Kind::JSON, jsonURL }, [sprite](const Response &res) {
+    env.request({ Resource::Kind::JSON, jsonURL }).then([sprite](const Response &res) {
         if (res.status == Response::Successful) {
-            sprite->body = res.data;
+            sprite->body = *res.data;
             sprite->parseJSON();
         } else {
             Log::Warning(Event::Sprite, "Failed to load sprite info: %s", res.message.c_str());
@@ -80,9 +74,9 @@ void Sprite::load(Environment &env) {
         sprite->complete();
     });
 
-    env.request({ Resource::Kind::Image, spriteURL }, [sprite](const Response &res) {
+    env.request({ Resource::Kind::Image, spriteURL }).then([sprite](const Response &res) {
         if (res.status == Response::Successful) {
-            sprite->image = res.data;
+            sprite->image = *res.data;
             sprite->parseImage();
         } else {
             Log::Warning(Event::Sprite, "Failed to load sprite image: %s", res.message.c_str());
@@ -94,10 +88,16 @@ void Sprite::load(Environment &env) {
 
 void Sprite::complete() {
     if (loadedImage && loadedJSON) {
-        promise.set_value();
+        if (observer) {
+            observer();
+        }
     }
 }
 
+void Sprite::setObserver(std::function<void ()> observer_) {
+    observer = std::move(observer_);
+}
+
 bool Sprite::isLoaded() const {
     return loadedImage && loadedJSON;
 }
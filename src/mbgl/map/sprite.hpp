@@ -7,10 +7,10 @@
 
 #include <cstdint>
 #include <atomic>
+#include <functional>
 #include <iosfwd>
 #include <string>
 #include <unordered_map>
-#include <future>
 
 namespace mbgl {
 
@@ -45,9 +45,11 @@ public:
 
     bool hasPixelRatio(float ratio) const;
 
-    void waitUntilLoaded() const;
     bool isLoaded() const;
 
+    // Called in the map thread once the sprite finished loading.
+    void setObserver(std::function<void ()> observer);
+
     operator bool() const;
 
 private:
@@ -72,8 +74,7 @@ private:
     std::unordered_map<std::string, SpritePosition> pos;
     const SpritePosition empty;
 
-    std::promise<void> promise;
-    std::future<void> future;
+    std::function<void ()> observer;
 
 };
 
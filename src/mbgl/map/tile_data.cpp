@@ -31,35 +31,71 @@ void TileData::request(Worker& worker, float pixelRatio, std::function<void()> c
     std::string url = source.tileURL(id, pixelRatio);
     state = State::loading;
 
-    req = env.request({ Resource::Kind::Tile, url }, [url, callback, &worker, this](const Response &res) {
-        req = nullptr;
-
-        if (res.status != Response::Successful) {
+    // A tile loaded from a stale response is only parsed again if the revalidated one differs.
+    std::weak_ptr<TileData> weak = shared_from_this();
+    req = env.requestWithUpdates({ Resource::Kind::Tile, url }, [weak, callback](const Response &res) {
+        auto tile = weak.lock();
+        if (tile && tile->data && res.status == Response::Successful && tile->changed(res)) {
+            tile->outdated = true;
+            callback();
+        }
+    });
+    req.then([url, callback, &worker, this](const Response &res) {
+        if (res.status != Response::Successful && res.status != Response::NotFound) {
             Log::Error(Event::HttpRequest, "[%s] tile loading failed: %s", url.c_str(), res.message.c_str());
             return;
         }
 
-        state = State::loaded;
         data = res.data;
+        etag = res.etag;
+
+        if (res.status == Response::NotFound || data->empty()) {
+            // There is no tile here. It is empty, so there is nothing to parse.
+            state = State::parsed;
+            callback();
+            return;
+        }
+
+        state = State::loaded;
 
         // Schedule tile parsing in another thread
         reparse(worker, callback);
     });
 }
 
+bool TileData::changed(const Response &res) const {
+    if (res.data == data || (!etag.empty() && res.etag == etag)) {
+        return false;
+    }
+    return *res.data != *data;
+}
+
 void TileData::cancel() {
     if (state != State::obsolete) {
         state = State::obsolete;
     }
-    if (req) {
-        env.cancelRequest(req);
-        req = nullptr;
+    req.cancel();
+    if (auto request = workRequest.lock()) {
+        request->cancel();
+    }
+}
+
+void TileData::setPriority(double priority_) {
+    priority = priority_;
+    if (auto request = workRequest.lock()) {
+        request->setPriority(priority);
+    }
+}
+
+void TileData::resume(Worker& worker, std::function<void()> callback) {
+    if (state == State::partial && workRequest.expired() && dependenciesLoaded()) {
+        reparse(worker, callback);
     }
 }
 
 void TileData::reparse(Worker& worker, std::function<void()> callback) {
     util::ptr<TileData> tile = shared_from_this();
-    worker.send(
+    workRequest = worker.send(
         [tile]() {
             EnvironmentScope scope(tile->env, ThreadType::TileWorker, "TileWorker_" + tile->name);
             tile->parse();
@@ -68,5 +104,6 @@ void TileData::reparse(Worker& worker, std::function<void()> callback) {
              // `tile` is bound in this lambda to ensure that if it's the last owning pointer,
              // destruction happens on the map thread, not the worker thread.
             callback();
-        });
+        },
+        priority);
 }
@@ -4,13 +4,16 @@
 #include <mbgl/map/tile_id.hpp>
 #include <mbgl/renderer/debug_bucket.hpp>
 #include <mbgl/geometry/debug_font_buffer.hpp>
+#include <mbgl/storage/response.hpp>
 
+#include <mbgl/util/async.hpp>
 #include <mbgl/util/noncopyable.hpp>
 #include <mbgl/util/ptr.hpp>
 
 #include <atomic>
 #include <string>
 #include <functional>
+#include <memory>
 
 namespace mbgl {
 
@@ -18,8 +21,8 @@ class Environment;
 class Painter;
 class SourceInfo;
 class StyleLayer;
-class Request;
 class Worker;
+class WorkRequest;
 
 class TileData : public std::enable_shared_from_this<TileData>,
              private util::noncopyable {
@@ -29,6 +32,7 @@ public:
         initial,
         loading,
         loaded,
+        partial,
         parsed,
         obsolete
     };
@@ -39,27 +43,57 @@ public:
     void request(Worker&, float pixelRatio, std::function<void ()> callback);
     void reparse(Worker&, std::function<void ()> callback);
     void cancel();
+
+    // Parses a partially parsed tile again, once the resources it waits for are loaded.
+    void resume(Worker&, std::function<void ()> callback);
+
+    // Lower priorities are parsed first. Changes the priority of a parse that is still queued.
+    void setPriority(double);
     const std::string toString() const;
 
     inline bool ready() const {
         return state == State::parsed;
     }
 
+    // Partially parsed tiles are rendered without the buckets that wait for glyphs or sprites.
+    inline bool renderable() const {
+        return state == State::parsed || state == State::partial;
+    }
+
+    // The tile was loaded from a stale response that changed when it was revalidated. Source
+    // replaces outdated tiles with ones that load the new response.
+    inline bool isOutdated() const {
+        return outdated;
+    }
+
     // Override this in the child class.
     virtual void parse() = 0;
     virtual void render(Painter &painter, const StyleLayer &layer_desc, const mat4 &matrix) = 0;
     virtual bool hasData(StyleLayer const &layer_desc) const = 0;
 
+    // Whether the resources that a partially parsed tile waits for are loaded.
+    virtual bool dependenciesLoaded() const { return true; }
+
     const TileID id;
     const std::string name;
     std::atomic<State> state;
 
 protected:
+    // Whether the response differs from the one the tile was loaded from, by ETag or content.
+    bool changed(const Response&) const;
+
     const SourceInfo& source;
     Environment& env;
 
-    Request *req = nullptr;
-    std::string data;
+    util::Async<Response> req;
+
+    // Shared with the response, and with the caches that hold on to it.
+    std::shared_ptr<const std::string> data;
+    std::string etag;
+    bool outdated = false;
+
+    double priority = 0;
+    std::weak_ptr<WorkRequest> workRequest;
 
     // Contains the tile ID string for painting debug information.
     DebugFontBuffer debugFontBuffer;
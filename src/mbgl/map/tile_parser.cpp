@@ -8,6 +8,9 @@
 #include <mbgl/renderer/line_bucket.hpp>
 #include <mbgl/renderer/symbol_bucket.hpp>
 #include <mbgl/renderer/raster_bucket.hpp>
+#include <mbgl/geometry/elements_buffer.hpp>
+#include <mbgl/geometry/fill_buffer.hpp>
+#include <mbgl/geometry/line_buffer.hpp>
 #include <mbgl/util/raster.hpp>
 #include <mbgl/util/constants.hpp>
 #include <mbgl/util/token.hpp>
@@ -18,8 +21,10 @@
 #include <mbgl/map/map.hpp>
 #include <mbgl/util/std.hpp>
 #include <mbgl/util/utf.hpp>
+#include <mbgl/util/worker.hpp>
 
 #include <locale>
+#include <set>
 
 namespace mbgl {
 
@@ -42,45 +47,222 @@ TileParser::TileParser(const GeometryTile& geometryTile_,
       glyphStore(glyphStore_),
       spriteAtlas(spriteAtlas_),
       sprite(sprite_),
-      collision(util::make_unique<Collision>(tile.id.z, 4096, tile.source.tile_size, tile.depth)) {
+      collision(tile.collision ? std::move(tile.collision)
+                               : util::make_unique<Collision>(tile.id.z, 4096, tile.source.tile_size, tile.depth)) {
     assert(style);
     assert(sprite);
     assert(collision);
 }
 
+TileParser::SourceLayer::SourceLayer(util::ptr<GeometryTileLayer> layer_)
+    : layer(std::move(layer_)) {
+    const std::size_t count = layer->featureCount();
+    features.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        features.push_back(layer->getFeature(i));
+    }
+    ranges.resize(count);
+    decoded.resize(count, false);
+}
+
+GeometryLines TileParser::SourceLayer::getGeometries(std::size_t i) {
+    if (!decoded[i]) {
+        const uint32_t first = geometries.size();
+        features[i]->getGeometries(geometries);
+        ranges[i] = { first, geometries.size() };
+        decoded[i] = true;
+    }
+    return GeometryLines(geometries, ranges[i].first, ranges[i].second);
+}
+
+class TileParser::Slice : private util::noncopyable {
+public:
+    Slice(util::ptr<GeometryTileLayer> layer_) : layer(std::move(layer_)) {}
+
+    const util::ptr<GeometryTileLayer> layer;
+    std::vector<const StyleBucket*> descriptions;
+
+    FillVertexBuffer fillVertexBuffer;
+    LineVertexBuffer lineVertexBuffer;
+    TriangleElementsBuffer triangleElementsBuffer;
+    LineElementsBuffer lineElementsBuffer;
+    PointElementsBuffer pointElementsBuffer;
+
+    std::vector<std::pair<std::string, std::unique_ptr<FillBucket>>> fillBuckets;
+    std::vector<std::pair<std::string, std::unique_ptr<LineBucket>>> lineBuckets;
+};
+
 bool TileParser::obsolete() const { return tile.state == TileData::State::obsolete; }
 
+bool TileParser::isVisible(const StyleBucket& bucketDesc) const {
+    if (tile.id.z < std::floor(bucketDesc.min_zoom) && std::floor(bucketDesc.min_zoom) < tile.source.max_zoom) return false;
+    if (tile.id.z >= std::ceil(bucketDesc.max_zoom)) return false;
+    if (bucketDesc.visibility == mbgl::VisibilityType::None) return false;
+    return true;
+}
+
 void TileParser::parse() {
-    for (const auto& layer_desc : style->layers) {
-        // Cancel early when parsing.
-        if (obsolete()) {
-            return;
-        }
+    // Fill and line buckets are built in one task per source layer, so that the geometries of a
+    // layer are still decoded once. Symbol buckets share the collision and are built in a single
+    // task, in style order.
+    std::vector<std::unique_ptr<Slice>> slices;
+    std::unordered_map<std::string, Slice*> slicesByLayer;
+    std::vector<std::pair<const StyleBucket*, util::ptr<GeometryTileLayer>>> symbols;
+    std::set<std::string> bucketNames;
 
+    for (const auto& layer_desc : style->layers) {
         if (layer_desc->isBackground()) {
             // background is a special, fake bucket
             continue;
         }
 
-        if (layer_desc->bucket) {
-            // This is a singular layer. Check if this bucket already exists. If not,
-            // parse this bucket.
-            auto bucket_it = tile.buckets.find(layer_desc->bucket->name);
-            if (bucket_it == tile.buckets.end()) {
-                // We need to create this bucket since it doesn't exist yet.
-                std::unique_ptr<Bucket> bucket = createBucket(*layer_desc->bucket);
+        if (!layer_desc->bucket) {
+            Log::Warning(Event::ParseTile, "layer '%s' does not have buckets", layer_desc->id.c_str());
+            continue;
+        }
+
+        // This is a singular layer. Check if this bucket already exists or is going to be built.
+        const StyleBucket& bucketDesc = *layer_desc->bucket;
+        if (tile.buckets.count(bucketDesc.name) || tile.symbolBuckets.count(bucketDesc.name) ||
+            !bucketNames.insert(bucketDesc.name).second) {
+            continue;
+        }
+
+        // Skip this bucket if we are to not render this
+        if (!isVisible(bucketDesc)) {
+            continue;
+        }
+
+        // Layers are decoded here, as decoding isn't thread-safe. Reading decoded layers is.
+        auto layer = geometryTile.getLayer(bucketDesc.source_layer);
+        if (!layer) {
+            // The layer specified in the bucket does not exist. Do nothing.
+            if (debug::tileParseWarnings) {
+                Log::Warning(Event::ParseTile, "layer '%s' does not exist in tile %d/%d/%d",
+                        bucketDesc.source_layer.c_str(), tile.id.z, tile.id.x, tile.id.y);
+            }
+            continue;
+        }
+
+        if (bucketDesc.type == StyleLayerType::Fill || bucketDesc.type == StyleLayerType::Line) {
+            Slice*& slice = slicesByLayer[bucketDesc.source_layer];
+            if (!slice) {
+                slices.push_back(util::make_unique<Slice>(std::move(layer)));
+                slice = slices.back().get();
+            }
+            slice->descriptions.push_back(&bucketDesc);
+        } else if (bucketDesc.type == StyleLayerType::Symbol) {
+            symbols.emplace_back(&bucketDesc, std::move(layer));
+        } else if (bucketDesc.type != StyleLayerType::Raster) {
+            Log::Warning(Event::ParseTile, "unknown bucket render type for layer '%s' (source layer '%s')",
+                    bucketDesc.name.c_str(), bucketDesc.source_layer.c_str());
+        }
+    }
+
+    // Symbol buckets are only added once all of them could be built, so that a partially parsed
+    // tile shows all its symbols in one go. They are placed in style order, as in a tile parsed
+    // at once: the ones before the first that waits are kept for the next pass, and the ones
+    // after it only add what they wait for.
+    SymbolDependencies missing;
+    std::unordered_map<std::string, std::unique_ptr<Bucket>> symbolBuckets;
+
+    std::vector<WorkerPool::Fn> tasks;
+    if (!symbols.empty()) {
+        tasks.emplace_back([&] {
+            for (const auto& symbol : symbols) {
+                // Cancel early when parsing.
+                if (obsolete()) {
+                    return;
+                }
+
+                auto bucket = createSymbolBucket(*symbol.second, *symbol.first, missing);
                 if (bucket) {
-                    // Bucket creation might fail because the data tile may not
-                    // contain any data that falls into this bucket.
-                    tile.buckets[layer_desc->bucket->name] = std::move(bucket);
+                    symbolBuckets.emplace(symbol.first->name, std::move(bucket));
                 }
             }
+        });
+    }
+    for (const auto& slice : slices) {
+        Slice* target = slice.get();
+        tasks.emplace_back([this, target] { buildSlice(*target); });
+    }
+
+    WorkerPool::parallel(std::move(tasks));
+
+    if (obsolete()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(tile.bucketsMutex);
+
+        for (const auto& slice : slices) {
+            joinSlice(*slice);
+        }
+
+        for (auto& pair : symbolBuckets) {
+            tile.symbolBuckets.emplace(pair.first, std::move(pair.second));
+        }
+
+        if (missing.empty()) {
+            for (auto& pair : tile.symbolBuckets) {
+                tile.buckets.emplace(pair.first, std::move(pair.second));
+            }
+            tile.symbolBuckets.clear();
+        }
+    }
+
+    if (!missing.empty()) {
+        tile.collision = std::move(collision);
+    }
+    tile.dependencies = std::move(missing);
+}
+
+void TileParser::buildSlice(Slice& slice) {
+    SourceLayer sourceLayer(slice.layer);
+
+    for (const StyleBucket* bucketDesc : slice.descriptions) {
+        // Cancel early when parsing.
+        if (obsolete()) {
+            return;
+        }
+
+        if (bucketDesc->type == StyleLayerType::Fill) {
+            slice.fillBuckets.emplace_back(bucketDesc->name,
+                                           createFillBucket(sourceLayer, *bucketDesc, slice));
         } else {
-            Log::Warning(Event::ParseTile, "layer '%s' does not have buckets", layer_desc->id.c_str());
+            slice.lineBuckets.emplace_back(bucketDesc->name,
+                                           createLineBucket(sourceLayer, *bucketDesc, slice));
         }
     }
 }
 
+void TileParser::joinSlice(Slice& slice) {
+    const std::size_t fillVertexOffset = tile.fillVertexBuffer.index();
+    const std::size_t lineVertexOffset = tile.lineVertexBuffer.index();
+    const std::size_t triangleOffset = tile.triangleElementsBuffer.index();
+    const std::size_t lineOffset = tile.lineElementsBuffer.index();
+    const std::size_t pointOffset = tile.pointElementsBuffer.index();
+
+    tile.fillVertexBuffer.append(slice.fillVertexBuffer);
+    tile.lineVertexBuffer.append(slice.lineVertexBuffer);
+    tile.triangleElementsBuffer.append(slice.triangleElementsBuffer);
+    tile.lineElementsBuffer.append(slice.lineElementsBuffer);
+    tile.pointElementsBuffer.append(slice.pointElementsBuffer);
+
+    for (auto& pair : slice.fillBuckets) {
+        pair.second->rebase(tile.fillVertexBuffer, tile.triangleElementsBuffer, tile.lineElementsBuffer,
+                            fillVertexOffset, triangleOffset, lineOffset);
+        tile.buckets.emplace(pair.first, std::move(pair.second));
+    }
+
+    for (auto& pair : slice.lineBuckets) {
+        pair.second->rebase(tile.lineVertexBuffer, tile.triangleElementsBuffer, tile.pointElementsBuffer,
+                            lineVertexOffset, triangleOffset, pointOffset);
+        tile.buckets.emplace(pair.first, std::move(pair.second));
+    }
+}
+
 template <typename T>
 struct PropertyEvaluator {
     typedef T result_type;
@@ -113,67 +295,37 @@ void applyLayoutProperty(PropertyKey key, const ClassProperties &classProperties
     }
 }
 
-std::unique_ptr<Bucket> TileParser::createBucket(const StyleBucket &bucketDesc) {
-    // Skip this bucket if we are to not render this
-    if (tile.id.z < std::floor(bucketDesc.min_zoom) && std::floor(bucketDesc.min_zoom) < tile.source.max_zoom) return nullptr;
-    if (tile.id.z >= std::ceil(bucketDesc.max_zoom)) return nullptr;
-    if (bucketDesc.visibility == mbgl::VisibilityType::None) return nullptr;
-
-    auto layer = geometryTile.getLayer(bucketDesc.source_layer);
-    if (layer) {
-        if (bucketDesc.type == StyleLayerType::Fill) {
-            return createFillBucket(*layer, bucketDesc);
-        } else if (bucketDesc.type == StyleLayerType::Line) {
-            return createLineBucket(*layer, bucketDesc);
-        } else if (bucketDesc.type == StyleLayerType::Symbol) {
-            return createSymbolBucket(*layer, bucketDesc);
-        } else if (bucketDesc.type == StyleLayerType::Raster) {
-            return nullptr;
-        } else {
-            Log::Warning(Event::ParseTile, "unknown bucket render type for layer '%s' (source layer '%s')",
-                    bucketDesc.name.c_str(), bucketDesc.source_layer.c_str());
-        }
-    } else {
-        // The layer specified in the bucket does not exist. Do nothing.
-        if (debug::tileParseWarnings) {
-            Log::Warning(Event::ParseTile, "layer '%s' does not exist in tile %d/%d/%d",
-                    bucketDesc.source_layer.c_str(), tile.id.z, tile.id.x, tile.id.y);
-        }
-    }
-
-    return nullptr;
-}
-
 template <class Bucket>
-void TileParser::addBucketGeometries(Bucket& bucket, const GeometryTileLayer& layer, const FilterExpression &filter) {
-    for (std::size_t i = 0; i < layer.featureCount(); i++) {
-        auto feature = layer.getFeature(i);
+void TileParser::addBucketGeometries(Bucket& bucket, SourceLayer& layer, const FilterExpression &filter) {
+    const auto compiledFilter = layer.getLayer().compileFilter(filter);
 
+    for (std::size_t i = 0; i < layer.featureCount(); i++) {
         if (obsolete())
             return;
 
-        GeometryTileFeatureExtractor extractor(*feature);
-        if (!evaluate(filter, extractor))
+        if (!compiledFilter->evaluate(layer.getFeature(i)))
             continue;
 
-        bucket->addGeometry(feature->getGeometries());
+        bucket->addGeometry(layer.getGeometries(i));
     }
 }
 
-std::unique_ptr<Bucket> TileParser::createFillBucket(const GeometryTileLayer& layer,
-                                                     const StyleBucket& bucket_desc) {
-    auto bucket = util::make_unique<FillBucket>(tile.fillVertexBuffer,
-                                                tile.triangleElementsBuffer,
-                                                tile.lineElementsBuffer);
+std::unique_ptr<FillBucket> TileParser::createFillBucket(SourceLayer& layer,
+                                                         const StyleBucket& bucket_desc,
+                                                         Slice& slice) {
+    auto bucket = util::make_unique<FillBucket>(slice.fillVertexBuffer,
+                                                slice.triangleElementsBuffer,
+                                                slice.lineElementsBuffer);
     addBucketGeometries(bucket, layer, bucket_desc.filter);
-    return std::move(bucket);
+    return bucket;
 }
 
-std::unique_ptr<Bucket> TileParser::createLineBucket(const GeometryTileLayer& layer,
-                                                     const StyleBucket& bucket_desc) {
-    auto bucket = util::make_unique<LineBucket>(tile.lineVertexBuffer,
-                                                tile.triangleElementsBuffer,
-                                                tile.pointElementsBuffer);
+std::unique_ptr<LineBucket> TileParser::createLineBucket(SourceLayer& layer,
+                                                         const StyleBucket& bucket_desc,
+                                                         Slice& slice) {
+    auto bucket = util::make_unique<LineBucket>(slice.lineVertexBuffer,
+                                                slice.triangleElementsBuffer,
+                                                slice.pointElementsBuffer);
 
     const float z = tile.id.z;
     auto& layout = bucket->layout;
@@ -184,11 +336,12 @@ std::unique_ptr<Bucket> TileParser::createLineBucket(const GeometryTileLayer& la
     applyLayoutProperty(PropertyKey::LineRoundLimit, bucket_desc.layout, layout.round_limit, z);
 
     addBucketGeometries(bucket, layer, bucket_desc.filter);
-    return std::move(bucket);
+    return bucket;
 }
 
 std::unique_ptr<Bucket> TileParser::createSymbolBucket(const GeometryTileLayer& layer,
-                                                       const StyleBucket& bucket_desc) {
+                                                       const StyleBucket& bucket_desc,
+                                                       SymbolDependencies& missing) {
     auto bucket = util::make_unique<SymbolBucket>(*collision);
 
     const float z = tile.id.z;
@@ -232,8 +385,16 @@ std::unique_ptr<Bucket> TileParser::createSymbolBucket(const GeometryTileLayer&
     applyLayoutProperty(PropertyKey::TextOffset, bucket_desc.layout, layout.text.offset, z);
     applyLayoutProperty(PropertyKey::TextAllowOverlap, bucket_desc.layout, layout.text.allow_overlap, z);
 
-    bucket->addFeatures(
-        layer, bucket_desc.filter, reinterpret_cast<uintptr_t>(&tile), spriteAtlas, *sprite, glyphAtlas, glyphStore);
+    // Once a symbol bucket is missing something, the later ones aren't placed, so that they are
+    // placed after it. They still add what they need, so that it starts loading now.
+    if (!missing.empty()) {
+        bucket->addDependencies(layer, bucket_desc.filter, glyphStore, *sprite, missing);
+        return nullptr;
+    }
+    if (!bucket->addFeatures(layer, bucket_desc.filter, reinterpret_cast<uintptr_t>(&tile),
+                             spriteAtlas, *sprite, glyphAtlas, glyphStore, missing)) {
+        return nullptr;
+    }
     return std::move(bucket);
 }
 }
@@ -13,13 +13,16 @@
 #include <cstdint>
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 namespace mbgl {
 
 class Bucket;
+class FillBucket;
 class FontStack;
 class GlyphAtlas;
 class GlyphStore;
+class LineBucket;
 class SpriteAtlas;
 class Sprite;
 class Style;
@@ -30,6 +33,7 @@ class StyleLayoutLine;
 class StyleLayoutSymbol;
 class VectorTileData;
 class Collision;
+class SymbolDependencies;
 
 class TileParser : private util::noncopyable {
 public:
@@ -46,15 +50,47 @@ public:
     void parse();
 
 private:
+    // The features of a source layer and their geometries. Each geometry is decoded the first time
+    // a bucket's filter matches the feature, and then handed to every other matching bucket. All
+    // geometries of the layer are decoded into one collection.
+    class SourceLayer {
+    public:
+        SourceLayer(util::ptr<GeometryTileLayer>);
+
+        const GeometryTileLayer& getLayer() const { return *layer; }
+        std::size_t featureCount() const { return features.size(); }
+        const GeometryTileFeature& getFeature(std::size_t i) const { return *features[i]; }
+
+        // The returned lines are valid until the next call.
+        GeometryLines getGeometries(std::size_t i);
+
+    private:
+        const util::ptr<GeometryTileLayer> layer;
+        std::vector<util::ptr<const GeometryTileFeature>> features;
+        GeometryCollection geometries;
+
+        // First and last line of each decoded feature in the geometry collection.
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::vector<bool> decoded;
+    };
+
+    // The fill and line buckets of one source layer. They are built in a task of their own, into
+    // buffers of their own, which are appended to the tile's buffers once all tasks are done.
+    class Slice;
+
     bool obsolete() const;
+    bool isVisible(const StyleBucket&) const;
+
+    void buildSlice(Slice&);
+    void joinSlice(Slice&);
 
-    std::unique_ptr<Bucket> createBucket(const StyleBucket&);
-    std::unique_ptr<Bucket> createFillBucket(const GeometryTileLayer&, const StyleBucket&);
-    std::unique_ptr<Bucket> createLineBucket(const GeometryTileLayer&, const StyleBucket&);
-    std::unique_ptr<Bucket> createSymbolBucket(const GeometryTileLayer&, const StyleBucket&);
+    std::unique_ptr<FillBucket> createFillBucket(SourceLayer&, const StyleBucket&, Slice&);
+    std::unique_ptr<LineBucket> createLineBucket(SourceLayer&, const StyleBucket&, Slice&);
+    std::unique_ptr<Bucket> createSymbolBucket(const GeometryTileLayer&, const StyleBucket&,
+                                               SymbolDependencies&);
 
     template <class Bucket>
-    void addBucketGeometries(Bucket&, const GeometryTileLayer&, const FilterExpression&);
+    void addBucketGeometries(Bucket&, SourceLayer&, const FilterExpression&);
 
     const GeometryTile& geometryTile;
     VectorTileData& tile;
@@ -66,6 +102,8 @@ private:
     SpriteAtlas& spriteAtlas;
     util::ptr<Sprite> sprite;
 
+    // Only used by the task that builds the symbol buckets, so that symbols are placed in the
+    // same order as the style lists them. Handed back to the tile while symbol buckets wait.
     std::unique_ptr<Collision> collision;
 };
 
@@ -1,7 +1,62 @@
 #include <mbgl/map/vector_tile.hpp>
+#include <mbgl/style/filter_expression_private.hpp>
+#include <mbgl/util/std.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 
 namespace mbgl {
 
+namespace {
+
+inline std::size_t size(const pbf& data) {
+    return data.end - data.data;
+}
+
+inline int compare(const pbf& a, const char* b, std::size_t length) {
+    const std::size_t length_a = size(a);
+    const int result = std::memcmp(a.data, b, std::min(length_a, length));
+    if (result != 0) {
+        return result;
+    }
+    return length_a < length ? -1 : length_a > length ? 1 : 0;
+}
+
+inline bool equals(const pbf& a, const std::string& b) {
+    return size(a) == b.size() && std::memcmp(a.data, b.data(), b.size()) == 0;
+}
+
+const uint32_t noValue = std::numeric_limits<uint32_t>::max();
+
+// Supplies a single value to a comparison expression, regardless of the key it asks for.
+class SingleValueExtractor {
+public:
+    SingleValueExtractor(mapbox::util::optional<Value> value_)
+        : value(std::move(value_)) {}
+
+    mapbox::util::optional<Value> getValue(const std::string&) const {
+        return value;
+    }
+
+private:
+    const mapbox::util::optional<Value> value;
+};
+
+struct ComparisonKey : public mapbox::util::static_visitor<const std::string*> {
+    template <class E>
+    const std::string* operator()(const E& e) const { return &e.key; }
+
+    const std::string* operator()(const NullExpression&) const { return nullptr; }
+    const std::string* operator()(const AnyExpression&) const { return nullptr; }
+    const std::string* operator()(const AllExpression&) const { return nullptr; }
+    const std::string* operator()(const NoneExpression&) const { return nullptr; }
+};
+
+}
+
 Value parseValue(pbf data) {
     while (data.next())
     {
@@ -47,8 +102,8 @@ VectorTileFeature::VectorTileFeature(pbf feature_pbf, const VectorTileLayer& lay
 }
 
 mapbox::util::optional<Value> VectorTileFeature::getValue(const std::string& key) const {
-    auto keyIter = layer.keys.find(key);
-    if (keyIter == layer.keys.end()) {
+    uint32_t key_index;
+    if (!layer.getKeyIndex(key, key_index)) {
         return mapbox::util::optional<Value>();
     }
 
@@ -69,25 +124,22 @@ mapbox::util::optional<Value> VectorTileFeature::getValue(const std::string& key
             throw std::runtime_error("feature referenced out of range value");
         }
 
-        if (tag_key == keyIter->second) {
-            return layer.values[tag_val];
+        if (tag_key == key_index) {
+            return parseValue(layer.values[tag_val]);
         }
     }
 
     return mapbox::util::optional<Value>();
 }
 
-GeometryCollection VectorTileFeature::getGeometries() const {
+void VectorTileFeature::getGeometries(GeometryCollection& lines) const {
     pbf data(geometry_pbf);
     uint8_t cmd = 1;
     uint32_t length = 0;
     int32_t x = 0;
     int32_t y = 0;
 
-    GeometryCollection lines;
-
-    lines.emplace_back();
-    std::vector<Coordinate>* line = &lines.back();
+    lines.addLine();
 
     while (data.data < data.end) {
         if (length == 0) {
@@ -102,31 +154,37 @@ GeometryCollection VectorTileFeature::getGeometries() const {
             x += data.svarint();
             y += data.svarint();
 
-            if (cmd == 1 && !line->empty()) { // moveTo
-                lines.emplace_back();
-                line = &lines.back();
+            if (cmd == 1 && !lines.back().empty()) { // moveTo
+                lines.addLine();
             }
 
-            line->emplace_back(x, y);
+            lines.addCoordinate(Coordinate(x, y));
 
         } else if (cmd == 7) { // closePolygon
-            if (!line->empty()) {
-                line->push_back((*line)[0]);
+            const GeometryLine line = lines.back();
+            if (!line.empty()) {
+                const Coordinate first = line.front();
+                lines.addCoordinate(first);
             }
 
         } else {
             throw std::runtime_error("unknown command");
         }
     }
-
-    return lines;
 }
 
 VectorTile::VectorTile(pbf tile_pbf) {
     while (tile_pbf.next()) {
         if (tile_pbf.tag == 3) { // layer
-            util::ptr<VectorTileLayer> layer = std::make_shared<VectorTileLayer>(tile_pbf.message());
-            layers.emplace(layer->name, layer);
+            Layer layer;
+            layer.data = tile_pbf.message();
+
+            pbf layer_pbf = layer.data;
+            if (layer_pbf.next(1)) { // name
+                layer.name = layer_pbf.message();
+            }
+
+            layers.push_back(layer);
         } else {
             tile_pbf.skip();
         }
@@ -134,33 +192,241 @@ VectorTile::VectorTile(pbf tile_pbf) {
 }
 
 util::ptr<GeometryTileLayer> VectorTile::getLayer(const std::string& name) const {
-    auto layer_it = layers.find(name);
-    if (layer_it != layers.end()) {
-        return layer_it->second;
+    for (auto& layer : layers) {
+        if (equals(layer.name, name)) {
+            if (!layer.decoded) {
+                layer.decoded = std::make_shared<VectorTileLayer>(layer.data);
+            }
+            return layer.decoded;
+        }
     }
     return nullptr;
 }
 
 VectorTileLayer::VectorTileLayer(pbf layer_pbf) {
+    std::vector<pbf> feature_pbfs;
+
     while (layer_pbf.next()) {
-        if (layer_pbf.tag == 1) { // name
-            name = layer_pbf.string();
-        } else if (layer_pbf.tag == 2) { // feature
-            features.push_back(layer_pbf.message());
+        if (layer_pbf.tag == 2) { // feature
+            feature_pbfs.push_back(layer_pbf.message());
         } else if (layer_pbf.tag == 3) { // keys
-            keys.emplace(layer_pbf.string(), keys.size());
+            keys.emplace_back(layer_pbf.message(), keys.size());
         } else if (layer_pbf.tag == 4) { // values
-            values.emplace_back(std::move(parseValue(layer_pbf.message())));
+            values.emplace_back(layer_pbf.message());
         } else if (layer_pbf.tag == 5) { // extent
             extent = layer_pbf.varint();
         } else {
             layer_pbf.skip();
         }
     }
+
+    if (!feature_pbfs.empty()) {
+        features = allocator.allocate(feature_pbfs.size());
+        try {
+            for (const auto& feature_pbf : feature_pbfs) {
+                allocator.construct(features + feature_count, feature_pbf, *this);
+                feature_count++;
+            }
+        } catch (...) {
+            // The destructor doesn't run when the constructor throws.
+            for (std::size_t i = 0; i < feature_count; i++) {
+                allocator.destroy(features + i);
+            }
+            allocator.deallocate(features, feature_pbfs.size());
+            throw;
+        }
+    }
+
+    // Keep the first occurrence of a duplicate key at the front so that lookups resolve to it.
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<pbf, uint32_t>& a, const std::pair<pbf, uint32_t>& b) {
+        return compare(a.first, reinterpret_cast<const char*>(b.first.data), size(b.first)) < 0;
+    });
+}
+
+bool VectorTileLayer::getKeyIndex(const std::string& key, uint32_t& index) const {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key, [](const std::pair<pbf, uint32_t>& a, const std::string& b) {
+        return compare(a.first, b.data(), b.size()) < 0;
+    });
+    if (it == keys.end() || !equals(it->first, key)) {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+VectorTileLayer::~VectorTileLayer() {
+    for (std::size_t i = 0; i < feature_count; i++) {
+        allocator.destroy(features + i);
+    }
+    if (features) {
+        allocator.deallocate(features, feature_count);
+    }
 }
 
 util::ptr<const GeometryTileFeature> VectorTileLayer::getFeature(std::size_t i) const {
-    return std::make_shared<VectorTileFeature>(features.at(i), *this);
+    if (i >= feature_count) {
+        throw std::out_of_range("feature index out of range");
+    }
+    return util::ptr<const GeometryTileFeature>(shared_from_this(), features + i);
+}
+
+std::unique_ptr<GeometryTileFilter> VectorTileLayer::compileFilter(const FilterExpression& expression) const {
+    return util::make_unique<VectorTileFilter>(expression, *this);
+}
+
+VectorTileFilter::VectorTileFilter(const FilterExpression& expression, const VectorTileLayer& layer_)
+    : layer(layer_),
+      keySlots(layer.keys.size(), -1) {
+    compile(expression);
+}
+
+void VectorTileFilter::compile(const FilterExpression& expression) {
+    const std::size_t index = program.size();
+    program.emplace_back();
+
+    const std::vector<FilterExpression>* children = nullptr;
+    if (expression.is<AnyExpression>()) {
+        program[index].op = Instruction::Op::Any;
+        children = &expression.get<AnyExpression>().expressions;
+    } else if (expression.is<AllExpression>()) {
+        program[index].op = Instruction::Op::All;
+        children = &expression.get<AllExpression>().expressions;
+    } else if (expression.is<NoneExpression>()) {
+        program[index].op = Instruction::Op::None;
+        children = &expression.get<NoneExpression>().expressions;
+    }
+
+    if (children) {
+        for (const auto& child : *children) {
+            compile(child);
+        }
+        program[index].size = program.size() - index;
+        return;
+    }
+
+    Instruction& instruction = program[index];
+    const std::string* key = mapbox::util::apply_visitor(ComparisonKey(), expression);
+    if (!key) {
+        instruction.op = Instruction::Op::Constant;
+        instruction.result = true;
+        return;
+    }
+
+    instruction.result = mbgl::evaluate(expression, SingleValueExtractor({}));
+
+    uint32_t key_index = 0;
+    if (*key == "$type") {
+        instruction.op = Instruction::Op::Compare;
+        instruction.type = true;
+        instruction.expression = &expression;
+        instruction.results.resize(uint32_t(FeatureType::Polygon) + 1);
+    } else if (layer.getKeyIndex(*key, key_index)) {
+        if (keySlots[key_index] < 0) {
+            keySlots[key_index] = slotValues.size();
+            slotValues.push_back(noValue);
+        }
+        instruction.op = Instruction::Op::Compare;
+        instruction.slot = keySlots[key_index];
+        instruction.expression = &expression;
+        instruction.results.resize(layer.values.size());
+    } else {
+        // No feature of this layer can have the key.
+        instruction.op = Instruction::Op::Constant;
+    }
+}
+
+bool VectorTileFilter::evaluate(const GeometryTileFeature& geometryTileFeature) const {
+    // Filters are only compiled by VectorTileLayer, and only evaluated with its features.
+    const auto& feature = static_cast<const VectorTileFeature&>(geometryTileFeature);
+    assert(&feature.layer == &layer);
+
+    featureType = feature.type;
+    std::fill(slotValues.begin(), slotValues.end(), noValue);
+
+    std::size_t remaining = slotValues.size();
+    pbf tags = feature.tags_pbf;
+    while (remaining && tags) {
+        uint32_t tag_key = tags.varint();
+
+        if (layer.keys.size() <= tag_key) {
+            throw std::runtime_error("feature referenced out of range key");
+        }
+
+        if (!tags) {
+            throw std::runtime_error("uneven number of feature tag ids");
+        }
+
+        uint32_t tag_val = tags.varint();
+        if (layer.values.size() <= tag_val) {
+            throw std::runtime_error("feature referenced out of range value");
+        }
+
+        const int32_t slot = keySlots[tag_key];
+        if (slot >= 0 && slotValues[slot] == noValue) {
+            slotValues[slot] = tag_val;
+            remaining--;
+        }
+    }
+
+    return evaluate(0);
+}
+
+bool VectorTileFilter::evaluate(std::size_t index) const {
+    const Instruction& instruction = program[index];
+    const std::size_t end = index + instruction.size;
+
+    switch (instruction.op) {
+    case Instruction::Op::Constant:
+        return instruction.result;
+
+    case Instruction::Op::Compare: {
+        const uint32_t value = instruction.type ? uint32_t(featureType) : slotValues[instruction.slot];
+        return value == noValue ? instruction.result : compare(instruction, value);
+    }
+
+    case Instruction::Op::Any:
+        for (std::size_t child = index + 1; child < end; child += program[child].size) {
+            if (evaluate(child)) {
+                return true;
+            }
+        }
+        return false;
+
+    case Instruction::Op::All:
+        for (std::size_t child = index + 1; child < end; child += program[child].size) {
+            if (!evaluate(child)) {
+                return false;
+            }
+        }
+        return true;
+
+    case Instruction::Op::None:
+        for (std::size_t child = index + 1; child < end; child += program[child].size) {
+            if (evaluate(child)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool VectorTileFilter::compare(const Instruction& instruction, uint32_t value) const {
+    const auto evaluateValue = [&]() {
+        return mbgl::evaluate(*instruction.expression, SingleValueExtractor(
+            instruction.type ? Value(uint64_t(value)) : parseValue(layer.values[value])));
+    };
+
+    if (value >= instruction.results.size()) {
+        return evaluateValue();
+    }
+
+    uint8_t& result = instruction.results[value];
+    if (result == 0) {
+        result = evaluateValue() ? 2 : 1;
+    }
+    return result == 2;
 }
 
 }
@@ -4,7 +4,8 @@
 #include <mbgl/map/geometry_tile.hpp>
 #include <mbgl/util/pbf.hpp>
 
-#include <map>
+#include <memory>
+#include <vector>
 
 namespace mbgl {
 
@@ -16,9 +17,11 @@ public:
 
     FeatureType getType() const override { return type; }
     mapbox::util::optional<Value> getValue(const std::string&) const override;
-    GeometryCollection getGeometries() const override;
+    void getGeometries(GeometryCollection&) const override;
 
 private:
+    friend class VectorTileFilter;
+
     const VectorTileLayer& layer;
     uint64_t id = 0;
     FeatureType type = FeatureType::Unknown;
@@ -26,24 +29,79 @@ private:
     pbf geometry_pbf;
 };
 
-class VectorTileLayer : public GeometryTileLayer {
+// A decoded view onto a layer of a vector tile. Layer names, keys and values are not copied out of
+// the tile; they are stored as pbf ranges that point into the tile buffer, which therefore must
+// outlive the VectorTile and every feature handed out by it.
+class VectorTileLayer : public GeometryTileLayer,
+                        public std::enable_shared_from_this<VectorTileLayer> {
 public:
     VectorTileLayer(pbf);
+    ~VectorTileLayer();
 
-    std::size_t featureCount() const override { return features.size(); }
+    std::size_t featureCount() const override { return feature_count; }
     util::ptr<const GeometryTileFeature> getFeature(std::size_t) const override;
+    std::unique_ptr<GeometryTileFilter> compileFilter(const FilterExpression&) const override;
 
 private:
-    friend class VectorTile;
     friend class VectorTileFeature;
+    friend class VectorTileFilter;
+
+    bool getKeyIndex(const std::string&, uint32_t& index) const;
 
-    std::string name;
     uint32_t extent = 4096;
-    std::map<std::string, uint32_t> keys;
-    std::vector<Value> values;
-    std::vector<pbf> features;
+
+    // Key ranges sorted by their contents, along with the index of the key in the layer.
+    std::vector<std::pair<pbf, uint32_t>> keys;
+    std::vector<pbf> values;
+
+    // All features of the layer are constructed in a single block owned by the layer. The shared
+    // pointers returned by getFeature() share ownership of the layer instead of allocating.
+    std::allocator<VectorTileFeature> allocator;
+    VectorTileFeature* features = nullptr;
+    std::size_t feature_count = 0;
+};
+
+// A filter expression flattened into a program for one layer. Keys are resolved to the layer's key
+// indices when the filter is compiled, and the outcome of each comparison is memoized per value
+// index, so that evaluating a feature is a single pass over its tags followed by table lookups.
+class VectorTileFilter : public GeometryTileFilter {
+public:
+    VectorTileFilter(const FilterExpression&, const VectorTileLayer&);
+
+    bool evaluate(const GeometryTileFeature&) const override;
+
+private:
+    struct Instruction {
+        enum class Op : uint8_t { Constant, Compare, Any, All, None };
+
+        Op op = Op::Constant;
+        bool type = false;      // Compare: compares the feature type instead of a value.
+        bool result = false;    // Constant: the result; Compare: the result if the key is absent.
+        uint32_t size = 1;      // Number of instructions in this subtree, including this one.
+        uint32_t slot = 0;      // Compare: index into slotValues.
+        const FilterExpression* expression = nullptr;
+
+        // Compare: memoized result per value index. 0 = unknown, 1 = false, 2 = true.
+        mutable std::vector<uint8_t> results;
+    };
+
+    void compile(const FilterExpression&);
+    bool evaluate(std::size_t index) const;
+    bool compare(const Instruction&, uint32_t value) const;
+
+    const VectorTileLayer& layer;
+    std::vector<Instruction> program;
+
+    // Maps each layer key index to a slot, or -1 if the filter doesn't reference the key.
+    std::vector<int32_t> keySlots;
+
+    // Value index for each referenced key of the feature currently being evaluated.
+    mutable std::vector<uint32_t> slotValues;
+    mutable FeatureType featureType = FeatureType::Unknown;
 };
 
+// Only the names and byte ranges of the layers are read when the tile is constructed. A layer's
+// keys, values and features are decoded the first time it is requested with getLayer().
 class VectorTile : public GeometryTile {
 public:
     VectorTile(pbf);
@@ -51,7 +109,13 @@ public:
     util::ptr<GeometryTileLayer> getLayer(const std::string&) const override;
 
 private:
-    std::map<std::string, util::ptr<GeometryTileLayer>> layers;
+    struct Layer {
+        pbf name;
+        pbf data;
+        util::ptr<VectorTileLayer> decoded;
+    };
+
+    mutable std::vector<Layer> layers;
 };
 
 }
@@ -1,5 +1,8 @@
 #include <mbgl/map/vector_tile_data.hpp>
 #include <mbgl/map/tile_parser.hpp>
+#include <mbgl/map/sprite.hpp>
+#include <mbgl/text/glyph_store.hpp>
+#include <mbgl/text/collision.hpp>
 #include <mbgl/util/std.hpp>
 #include <mbgl/style/style_layer.hpp>
 #include <mbgl/style/style_bucket.hpp>
@@ -32,26 +35,33 @@ VectorTileData::~VectorTileData() {
 }
 
 void VectorTileData::parse() {
-    if (state != State::loaded) {
+    if (state != State::loaded && state != State::partial) {
         return;
     }
 
     try {
-        if (!style) {
+        const util::ptr<Style> parseStyle = style ? style : partialStyle.lock();
+        if (!parseStyle) {
             throw std::runtime_error("style isn't present in VectorTileData object anymore");
         }
 
         // Parsing creates state that is encapsulated in TileParser. While parsing,
         // the TileParser object writes results into this objects. All other state
         // is going to be discarded afterwards.
-        VectorTile vectorTile(pbf((const uint8_t *)data.data(), data.size()));
+        VectorTile vectorTile(pbf((const uint8_t *)data->data(), data->size()));
         const VectorTile* vt = &vectorTile;
-        TileParser parser(*vt, *this, style, glyphAtlas, glyphStore, spriteAtlas, sprite);
+        TileParser parser(*vt, *this, parseStyle, glyphAtlas, glyphStore, spriteAtlas, sprite);
 
         // Clear the style so that we don't have a cycle in the shared_ptr references.
         style.reset();
 
         parser.parse();
+
+        if (dependencies.empty()) {
+            partialStyle.reset();
+        } else {
+            partialStyle = parseStyle;
+        }
     } catch (const std::exception& ex) {
         Log::Error(Event::ParseTile, "Parsing [%d/%d/%d] failed: %s", id.z, id.x, id.y, ex.what());
         state = State::obsolete;
@@ -59,12 +69,13 @@ void VectorTileData::parse() {
     }
 
     if (state != State::obsolete) {
-        state = State::parsed;
+        state = dependencies.empty() ? State::parsed : State::partial;
     }
 }
 
 void VectorTileData::render(Painter &painter, const StyleLayer &layer_desc, const mat4 &matrix) {
-    if (state == State::parsed && layer_desc.bucket) {
+    if (renderable() && layer_desc.bucket) {
+        std::lock_guard<std::mutex> lock(bucketsMutex);
         auto databucket_it = buckets.find(layer_desc.bucket->name);
         if (databucket_it != buckets.end()) {
             assert(databucket_it->second);
@@ -74,7 +85,8 @@ void VectorTileData::render(Painter &painter, const StyleLayer &layer_desc, cons
 }
 
 bool VectorTileData::hasData(const StyleLayer &layer_desc) const {
-    if (state == State::parsed && layer_desc.bucket) {
+    if (renderable() && layer_desc.bucket) {
+        std::lock_guard<std::mutex> lock(bucketsMutex);
         auto databucket_it = buckets.find(layer_desc.bucket->name);
         if (databucket_it != buckets.end()) {
             assert(databucket_it->second);
@@ -83,3 +95,17 @@ bool VectorTileData::hasData(const StyleLayer &layer_desc) const {
     }
     return false;
 }
+
+bool VectorTileData::dependenciesLoaded() const {
+    if (dependencies.sprite && !sprite->isLoaded()) {
+        return false;
+    }
+
+    for (const auto& pair : dependencies.glyphRanges) {
+        if (!glyphStore.hasGlyphRanges(pair.first, pair.second)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -7,14 +7,17 @@
 #include <mbgl/geometry/icon_buffer.hpp>
 #include <mbgl/geometry/line_buffer.hpp>
 #include <mbgl/geometry/text_buffer.hpp>
+#include <mbgl/renderer/symbol_bucket.hpp>
 
 #include <iosfwd>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 namespace mbgl {
 
 class Bucket;
+class Collision;
 class Painter;
 class SourceInfo;
 class StyleLayer;
@@ -42,6 +45,7 @@ public:
     void parse() override;
     void render(Painter &painter, const StyleLayer &layer_desc, const mat4 &matrix) override;
     bool hasData(StyleLayer const& layer_desc) const override;
+    bool dependenciesLoaded() const override;
 
 protected:
     // Holds the actual geometries in this tile.
@@ -56,12 +60,28 @@ protected:
     // They contain the location offsets in the buffers stored above
     std::unordered_map<std::string, std::unique_ptr<Bucket>> buckets;
 
+    // Guards the buckets while a partially parsed tile is rendered and its symbol buckets are
+    // added at the same time. Only the parser modifies them.
+    mutable std::mutex bucketsMutex;
+
+    // What the symbol buckets of a partially parsed tile wait for.
+    SymbolDependencies dependencies;
+
+    // The symbol buckets of a partially parsed tile that come before the first one that waits,
+    // and the collision they were placed in. Parsing continues after them once the dependencies
+    // are loaded, and adds all symbol buckets at once.
+    std::unordered_map<std::string, std::unique_ptr<Bucket>> symbolBuckets;
+    std::unique_ptr<Collision> collision;
+
     GlyphAtlas& glyphAtlas;
     GlyphStore& glyphStore;
     SpriteAtlas& spriteAtlas;
     util::ptr<Sprite> sprite;
     util::ptr<Style> style;
 
+    // Partially parsed tiles need the style again, but must not keep it alive.
+    std::weak_ptr<Style> partialStyle;
+
 public:
     const float depth;
 };
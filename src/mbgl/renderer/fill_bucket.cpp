@@ -44,12 +44,12 @@ FillBucket::FillBucket(FillVertexBuffer &vertexBuffer_,
           128,     // extraVertices allocated for the priority queue.
       }),
       tesselator(tessNewTess(allocator)),
-      vertexBuffer(vertexBuffer_),
-      triangleElementsBuffer(triangleElementsBuffer_),
-      lineElementsBuffer(lineElementsBuffer_),
+      vertexBuffer(&vertexBuffer_),
+      triangleElementsBuffer(&triangleElementsBuffer_),
+      lineElementsBuffer(&lineElementsBuffer_),
       vertex_start(vertexBuffer_.index()),
       triangle_elements_start(triangleElementsBuffer_.index()),
-      line_elements_start(lineElementsBuffer.index()) {
+      line_elements_start(lineElementsBuffer->index()) {
     assert(tesselator);
 }
 
@@ -62,9 +62,9 @@ FillBucket::~FillBucket() {
     }
 }
 
-void FillBucket::addGeometry(const GeometryCollection& geometryCollection) {
-    for (auto& line_ : geometryCollection) {
-        for (auto& v : line_) {
+void FillBucket::addGeometry(const GeometryLines& lines) {
+    for (const auto line_ : lines) {
+        for (const auto& v : line_) {
             line.emplace_back(v.x, v.y);
         }
         if (line.size()) {
@@ -117,12 +117,12 @@ void FillBucket::tessellate() {
         for (const auto& pt : polygon) {
             clipped_line.push_back(pt.X);
             clipped_line.push_back(pt.Y);
-            vertexBuffer.add(pt.X, pt.Y);
+            vertexBuffer->add(pt.X, pt.Y);
         }
 
         for (size_t i = 0; i < group_count; i++) {
             const size_t prev_i = (i == 0 ? group_count : i) - 1;
-            lineElementsBuffer.add(lineIndex + prev_i, lineIndex + i);
+            lineElementsBuffer->add(lineIndex + prev_i, lineIndex + i);
         }
 
         lineIndex += group_count;
@@ -141,7 +141,7 @@ void FillBucket::tessellate() {
 
         for (size_t i = 0; i < vertex_count; ++i) {
             if (vertex_indices[i] == TESS_UNDEF) {
-                vertexBuffer.add(std::round(vertices[i * 2]), std::round(vertices[i * 2 + 1]));
+                vertexBuffer->add(std::round(vertices[i * 2]), std::round(vertices[i * 2 + 1]));
                 vertex_indices[i] = (TESSindex)total_vertex_count;
                 total_vertex_count++;
             }
@@ -167,7 +167,7 @@ void FillBucket::tessellate() {
                 const TESSindex c = vertex_indices[element_group[2]];
 
                 if (a != TESS_UNDEF && b != TESS_UNDEF && c != TESS_UNDEF) {
-                    triangleElementsBuffer.add(triangleIndex + a, triangleIndex + b, triangleIndex + c);
+                    triangleElementsBuffer->add(triangleIndex + a, triangleIndex + b, triangleIndex + c);
                 } else {
 #if defined(DEBUG)
                     // TODO: We're missing a vertex that was not part of the line.
@@ -195,6 +195,18 @@ void FillBucket::tessellate() {
     lineGroup.vertex_length += total_vertex_count;
 }
 
+void FillBucket::rebase(FillVertexBuffer& vertexBuffer_,
+                        TriangleElementsBuffer& triangleElementsBuffer_,
+                        LineElementsBuffer& lineElementsBuffer_,
+                        size_t vertexOffset, size_t triangleOffset, size_t lineOffset) {
+    vertexBuffer = &vertexBuffer_;
+    triangleElementsBuffer = &triangleElementsBuffer_;
+    lineElementsBuffer = &lineElementsBuffer_;
+    vertex_start += vertexOffset;
+    triangle_elements_start += triangleOffset;
+    line_elements_start += lineOffset;
+}
+
 void FillBucket::render(Painter &painter, const StyleLayer &layer_desc, const TileID &id,
                         const mat4 &matrix) {
     painter.renderFill(*this, layer_desc, id, matrix);
@@ -205,37 +217,37 @@ bool FillBucket::hasData() const {
 }
 
 void FillBucket::drawElements(PlainShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer->itemSize);
     for (auto& group : triangleGroups) {
         assert(group);
-        group->array[0].bind(shader, vertexBuffer, triangleElementsBuffer, vertex_index);
+        group->array[0].bind(shader, *vertexBuffer, *triangleElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_TRIANGLES, group->elements_length * 3, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * triangleElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * triangleElementsBuffer->itemSize;
     }
 }
 
 void FillBucket::drawElements(PatternShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer->itemSize);
     for (auto& group : triangleGroups) {
         assert(group);
-        group->array[1].bind(shader, vertexBuffer, triangleElementsBuffer, vertex_index);
+        group->array[1].bind(shader, *vertexBuffer, *triangleElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_TRIANGLES, group->elements_length * 3, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * triangleElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * triangleElementsBuffer->itemSize;
     }
 }
 
 void FillBucket::drawVertices(OutlineShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(line_elements_start * lineElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(line_elements_start * lineElementsBuffer->itemSize);
     for (auto& group : lineGroups) {
         assert(group);
-        group->array[0].bind(shader, vertexBuffer, lineElementsBuffer, vertex_index);
+        group->array[0].bind(shader, *vertexBuffer, *lineElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_LINES, group->elements_length * 2, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * lineElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * lineElementsBuffer->itemSize;
     }
 }
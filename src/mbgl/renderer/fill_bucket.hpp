@@ -41,9 +41,14 @@ public:
                 const mat4 &matrix) override;
     bool hasData() const override;
 
-    void addGeometry(const GeometryCollection&);
+    void addGeometry(const GeometryLines&);
     void tessellate();
 
+    // Moves the bucket to other buffers, after the buffers it was built in were appended to them
+    // at the given element offsets.
+    void rebase(FillVertexBuffer&, TriangleElementsBuffer&, LineElementsBuffer&,
+                size_t vertexOffset, size_t triangleOffset, size_t lineOffset);
+
     void drawElements(PlainShader& shader);
     void drawElements(PatternShader& shader);
     void drawVertices(OutlineShader& shader);
@@ -53,14 +58,14 @@ private:
     TESStesselator *tesselator;
     ClipperLib::Clipper clipper;
 
-    FillVertexBuffer& vertexBuffer;
-    TriangleElementsBuffer& triangleElementsBuffer;
-    LineElementsBuffer& lineElementsBuffer;
+    FillVertexBuffer* vertexBuffer;
+    TriangleElementsBuffer* triangleElementsBuffer;
+    LineElementsBuffer* lineElementsBuffer;
 
     // hold information on where the vertices are located in the FillBuffer
-    const size_t vertex_start;
-    const size_t triangle_elements_start;
-    const size_t line_elements_start;
+    size_t vertex_start;
+    size_t triangle_elements_start;
+    size_t line_elements_start;
 
     std::vector<std::unique_ptr<TriangleGroup>> triangleGroups;
     std::vector<std::unique_ptr<LineGroup>> lineGroups;
@@ -17,9 +17,9 @@ using namespace mbgl;
 LineBucket::LineBucket(LineVertexBuffer &vertexBuffer_,
                        TriangleElementsBuffer &triangleElementsBuffer_,
                        PointElementsBuffer &pointElementsBuffer_)
-    : vertexBuffer(vertexBuffer_),
-      triangleElementsBuffer(triangleElementsBuffer_),
-      pointElementsBuffer(pointElementsBuffer_),
+    : vertexBuffer(&vertexBuffer_),
+      triangleElementsBuffer(&triangleElementsBuffer_),
+      pointElementsBuffer(&pointElementsBuffer_),
       vertex_start(vertexBuffer_.index()),
       triangle_elements_start(triangleElementsBuffer_.index()),
       point_elements_start(pointElementsBuffer_.index()) {
@@ -36,13 +36,13 @@ struct TriangleElement {
 
 typedef uint16_t PointElement;
 
-void LineBucket::addGeometry(const GeometryCollection& geometryCollection) {
-    for (auto& line : geometryCollection) {
+void LineBucket::addGeometry(const GeometryLines& lines) {
+    for (const auto line : lines) {
         addGeometry(line);
     }
 }
 
-void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
+void LineBucket::addGeometry(const GeometryLine& vertices) {
     // TODO: use roundLimit
     // const float roundLimit = geometry.round_limit;
 
@@ -81,7 +81,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         nextNormal = util::normal<double>(currentVertex, lastVertex);
     }
 
-    int32_t start_vertex = (int32_t)vertexBuffer.index();
+    int32_t start_vertex = (int32_t)vertexBuffer->index();
 
     std::vector<TriangleElement> triangle_store;
     std::vector<PointElement> point_store;
@@ -152,7 +152,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         // Add offset square begin cap.
         if (!prevVertex && beginCap == CapType::Square) {
             // Add first vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    flip * (prevNormal.x + prevNormal.y), flip * (-prevNormal.x + prevNormal.y), // extrude normal
                                    0, 0, distance) - start_vertex; // texture normal
 
@@ -160,7 +160,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
             e1 = e2; e2 = e3;
 
             // Add second vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    flip * (prevNormal.x - prevNormal.y), flip * (prevNormal.x + prevNormal.y), // extrude normal
                                    0, 1, distance) - start_vertex; // texture normal
 
@@ -171,7 +171,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         // Add offset square end cap.
         else if (!nextVertex && endCap == CapType::Square) {
             // Add first vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    nextNormal.x - flip * nextNormal.y, flip * nextNormal.x + nextNormal.y, // extrude normal
                                    0, 0, distance) - start_vertex; // texture normal
 
@@ -179,7 +179,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
             e1 = e2; e2 = e3;
 
             // Add second vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    nextNormal.x + flip * nextNormal.y, -flip * nextNormal.x + nextNormal.y, // extrude normal
                                    0, 1, distance) - start_vertex; // texture normal
 
@@ -205,7 +205,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
             }
 
             // Add first vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    flip * joinNormal.x, flip * joinNormal.y, // extrude normal
                                    0, 0, distance) - start_vertex; // texture normal
 
@@ -213,7 +213,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
             e1 = e2; e2 = e3;
 
             // Add second vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    -flip * joinNormal.x, -flip * joinNormal.y, // extrude normal
                                    0, 1, distance) - start_vertex; // texture normal
 
@@ -229,7 +229,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         else {
             // Close up the previous line
             // Add first vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    flip * prevNormal.y, -flip * prevNormal.x, // extrude normal
                                    0, 0, distance) - start_vertex; // texture normal
 
@@ -237,7 +237,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
             e1 = e2; e2 = e3;
 
             // Add second vertex.
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    -flip * prevNormal.y, flip * prevNormal.x, // extrude normal
                                    0, 1, distance) - start_vertex; // texture normal
 
@@ -267,7 +267,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
 
             // Start the new quad.
             // Add first vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    -flip * nextNormal.y, flip * nextNormal.x, // extrude normal
                                    0, 0, distance) - start_vertex; // texture normal
 
@@ -275,7 +275,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
             e1 = e2; e2 = e3;
 
             // Add second vertex
-            e3 = (int32_t)vertexBuffer.add(currentVertex.x, currentVertex.y, // vertex pos
+            e3 = (int32_t)vertexBuffer->add(currentVertex.x, currentVertex.y, // vertex pos
                                    flip * nextNormal.y, -flip * nextNormal.x, // extrude normal
                                    0, 1, distance) - start_vertex; // texture normal
 
@@ -284,7 +284,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         }
     }
 
-    size_t end_vertex = vertexBuffer.index();
+    size_t end_vertex = vertexBuffer->index();
     size_t vertex_count = end_vertex - start_vertex;
 
     // Store the triangle/line groups.
@@ -297,7 +297,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         assert(triangleGroups.back());
         triangle_group_type& group = *triangleGroups.back();
         for (const auto& triangle : triangle_store) {
-            triangleElementsBuffer.add(
+            triangleElementsBuffer->add(
                 group.vertex_length + triangle.a,
                 group.vertex_length + triangle.b,
                 group.vertex_length + triangle.c
@@ -318,7 +318,7 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
         assert(pointGroups.back());
         point_group_type& group = *pointGroups.back();
         for (const auto point : point_store) {
-            pointElementsBuffer.add(group.vertex_length + point);
+            pointElementsBuffer->add(group.vertex_length + point);
         }
 
         group.vertex_length += vertex_count;
@@ -326,6 +326,18 @@ void LineBucket::addGeometry(const std::vector<Coordinate>& vertices) {
     }
 }
 
+void LineBucket::rebase(LineVertexBuffer& vertexBuffer_,
+                        TriangleElementsBuffer& triangleElementsBuffer_,
+                        PointElementsBuffer& pointElementsBuffer_,
+                        size_t vertexOffset, size_t triangleOffset, size_t pointOffset) {
+    vertexBuffer = &vertexBuffer_;
+    triangleElementsBuffer = &triangleElementsBuffer_;
+    pointElementsBuffer = &pointElementsBuffer_;
+    vertex_start += vertexOffset;
+    triangle_elements_start += triangleOffset;
+    point_elements_start += pointOffset;
+}
+
 void LineBucket::render(Painter &painter, const StyleLayer &layer_desc, const TileID &id,
                         const mat4 &matrix) {
     painter.renderLine(*this, layer_desc, id, matrix);
@@ -348,61 +360,61 @@ bool LineBucket::hasPoints() const {
 }
 
 void LineBucket::drawLines(LineShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer->itemSize);
     for (auto& group : triangleGroups) {
         assert(group);
         if (!group->elements_length) {
             continue;
         }
-        group->array[0].bind(shader, vertexBuffer, triangleElementsBuffer, vertex_index);
+        group->array[0].bind(shader, *vertexBuffer, *triangleElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_TRIANGLES, group->elements_length * 3, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * triangleElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * triangleElementsBuffer->itemSize;
     }
 }
 
 void LineBucket::drawLineSDF(LineSDFShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer->itemSize);
     for (auto& group : triangleGroups) {
         assert(group);
         if (!group->elements_length) {
             continue;
         }
-        group->array[2].bind(shader, vertexBuffer, triangleElementsBuffer, vertex_index);
+        group->array[2].bind(shader, *vertexBuffer, *triangleElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_TRIANGLES, group->elements_length * 3, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * triangleElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * triangleElementsBuffer->itemSize;
     }
 }
 
 void LineBucket::drawLinePatterns(LinepatternShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(triangle_elements_start * triangleElementsBuffer->itemSize);
     for (auto& group : triangleGroups) {
         assert(group);
         if (!group->elements_length) {
             continue;
         }
-        group->array[1].bind(shader, vertexBuffer, triangleElementsBuffer, vertex_index);
+        group->array[1].bind(shader, *vertexBuffer, *triangleElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_TRIANGLES, group->elements_length * 3, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * triangleElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * triangleElementsBuffer->itemSize;
     }
 }
 
 void LineBucket::drawPoints(LinejoinShader& shader) {
-    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer.itemSize);
-    char *elements_index = BUFFER_OFFSET(point_elements_start * pointElementsBuffer.itemSize);
+    char *vertex_index = BUFFER_OFFSET(vertex_start * vertexBuffer->itemSize);
+    char *elements_index = BUFFER_OFFSET(point_elements_start * pointElementsBuffer->itemSize);
     for (auto& group : pointGroups) {
         assert(group);
         if (!group->elements_length) {
             continue;
         }
-        group->array[0].bind(shader, vertexBuffer, pointElementsBuffer, vertex_index);
+        group->array[0].bind(shader, *vertexBuffer, *pointElementsBuffer, vertex_index);
         MBGL_CHECK_ERROR(glDrawElements(GL_POINTS, group->elements_length, GL_UNSIGNED_SHORT, elements_index));
-        vertex_index += group->vertex_length * vertexBuffer.itemSize;
-        elements_index += group->elements_length * pointElementsBuffer.itemSize;
+        vertex_index += group->vertex_length * vertexBuffer->itemSize;
+        elements_index += group->elements_length * pointElementsBuffer->itemSize;
     }
 }
@@ -36,11 +36,16 @@ public:
                 const mat4 &matrix) override;
     bool hasData() const override;
 
-    void addGeometry(const GeometryCollection&);
-    void addGeometry(const std::vector<Coordinate>& line);
+    void addGeometry(const GeometryLines&);
+    void addGeometry(const GeometryLine&);
 
     bool hasPoints() const;
 
+    // Moves the bucket to other buffers, after the buffers it was built in were appended to them
+    // at the given element offsets.
+    void rebase(LineVertexBuffer&, TriangleElementsBuffer&, PointElementsBuffer&,
+                size_t vertexOffset, size_t triangleOffset, size_t pointOffset);
+
     void drawLines(LineShader& shader);
     void drawLineSDF(LineSDFShader& shader);
     void drawLinePatterns(LinepatternShader& shader);
@@ -50,13 +55,13 @@ public:
     StyleLayoutLine layout;
 
 private:
-    LineVertexBuffer& vertexBuffer;
-    TriangleElementsBuffer& triangleElementsBuffer;
-    PointElementsBuffer& pointElementsBuffer;
+    LineVertexBuffer* vertexBuffer;
+    TriangleElementsBuffer* triangleElementsBuffer;
+    PointElementsBuffer* pointElementsBuffer;
 
-    const size_t vertex_start;
-    const size_t triangle_elements_start;
-    const size_t point_elements_start;
+    size_t vertex_start;
+    size_t triangle_elements_start;
+    size_t point_elements_start;
 
     std::vector<std::unique_ptr<triangle_group_type>> triangleGroups;
     std::vector<std::unique_ptr<point_group_type>> pointGroups;
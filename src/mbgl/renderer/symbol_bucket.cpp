@@ -41,27 +41,40 @@ bool SymbolBucket::hasTextData() const { return !text.groups.empty(); }
 
 bool SymbolBucket::hasIconData() const { return !icon.groups.empty(); }
 
-std::vector<SymbolFeature> SymbolBucket::processFeatures(const GeometryTileLayer& layer,
-                                                         const FilterExpression& filter,
-                                                         GlyphStore &glyphStore,
-                                                         const Sprite &sprite) {
+bool SymbolBucket::addDependencies(const GeometryTileLayer& layer,
+                                   const FilterExpression& filter,
+                                   GlyphStore& glyphStore,
+                                   const Sprite& sprite,
+                                   SymbolDependencies& dependencies) {
+    std::vector<SymbolFeature> features;
+    return processFeatures(layer, filter, glyphStore, sprite, features, dependencies);
+}
+
+bool SymbolBucket::processFeatures(const GeometryTileLayer& layer,
+                                   const FilterExpression& filter,
+                                   GlyphStore &glyphStore,
+                                   const Sprite &sprite,
+                                   std::vector<SymbolFeature>& features,
+                                   SymbolDependencies& dependencies) {
     const bool has_text = !layout.text.field.empty() && !layout.text.font.empty();
     const bool has_icon = !layout.icon.image.empty();
 
-    std::vector<SymbolFeature> features;
-
     if (!has_text && !has_icon) {
-        return features;
+        return true;
     }
 
     // Determine and load glyph ranges
     std::set<GlyphRange> ranges;
 
+    const auto compiledFilter = layer.compileFilter(filter);
+
+    // Reused for decoding the geometries of all features.
+    GeometryCollection geometryCollection;
+
     for (std::size_t i = 0; i < layer.featureCount(); i++) {
         auto feature = layer.getFeature(i);
 
-        GeometryTileFeatureExtractor extractor(*feature);
-        if (!evaluate(filter, extractor))
+        if (!compiledFilter->evaluate(*feature))
             continue;
 
         SymbolFeature ft;
@@ -98,12 +111,11 @@ std::vector<SymbolFeature> SymbolBucket::processFeatures(const GeometryTileLayer
 
             auto &multiline = ft.geometry;
 
-            GeometryCollection geometryCollection = feature->getGeometries();
-            for (auto& line : geometryCollection) {
-                multiline.emplace_back();
-                for (auto& point : line) {
-                    multiline.back().emplace_back(point.x, point.y);
-                }
+            geometryCollection.clear();
+            feature->getGeometries(geometryCollection);
+            multiline.reserve(geometryCollection.size());
+            for (const auto line : geometryCollection) {
+                multiline.emplace_back(line.begin(), line.end());
             }
 
             features.push_back(std::move(ft));
@@ -114,20 +126,33 @@ std::vector<SymbolFeature> SymbolBucket::processFeatures(const GeometryTileLayer
         util::mergeLines(features);
     }
 
-    glyphStore.waitForGlyphRanges(layout.text.font, ranges);
-    sprite.waitUntilLoaded();
+    bool loaded = true;
 
-    return features;
+    if (!glyphStore.loadGlyphRanges(layout.text.font, ranges)) {
+        dependencies.glyphRanges[layout.text.font].insert(ranges.begin(), ranges.end());
+        loaded = false;
+    }
+
+    if (has_icon && !sprite.isLoaded()) {
+        dependencies.sprite = true;
+        loaded = false;
+    }
+
+    return loaded;
 }
 
-void SymbolBucket::addFeatures(const GeometryTileLayer& layer,
+bool SymbolBucket::addFeatures(const GeometryTileLayer& layer,
                                const FilterExpression& filter,
                                uintptr_t tileUID,
                                SpriteAtlas& spriteAtlas,
                                Sprite& sprite,
                                GlyphAtlas& glyphAtlas,
-                               GlyphStore& glyphStore) {
-    const std::vector<SymbolFeature> features = processFeatures(layer, filter, glyphStore, sprite);
+                               GlyphStore& glyphStore,
+                               SymbolDependencies& dependencies) {
+    std::vector<SymbolFeature> features;
+    if (!processFeatures(layer, filter, glyphStore, sprite, features, dependencies)) {
+        return false;
+    }
 
     float horizontalAlign = 0.5;
     float verticalAlign = 0.5;
@@ -199,7 +224,6 @@ void SymbolBucket::addFeatures(const GeometryTileLayer& layer,
 
         // if feature has icon, get sprite atlas position
         if (feature.sprite.length()) {
-            sprite.waitUntilLoaded();
             image = spriteAtlas.getImage(feature.sprite, false);
 
             if (sprite.getSpritePosition(feature.sprite).sdf) {
@@ -216,6 +240,8 @@ void SymbolBucket::addFeatures(const GeometryTileLayer& layer,
             }
         }
     }
+
+    return true;
 }
 
 bool byScale(const Anchor &a, const Anchor &b) { return a.scale < b.scale; }
@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <map>
+#include <set>
 #include <vector>
 
 namespace mbgl {
@@ -34,6 +35,16 @@ public:
 };
 
 
+// Glyph ranges by font stack, and whether the sprite is needed, for symbols that can't be added
+// until these are loaded.
+class SymbolDependencies {
+public:
+    std::map<std::string, std::set<GlyphRange>> glyphRanges;
+    bool sprite = false;
+
+    bool empty() const { return glyphRanges.empty() && !sprite; }
+};
+
 class Symbol {
 public:
     vec2<float> tl, tr, bl, br;
@@ -61,23 +72,40 @@ public:
     bool hasTextData() const;
     bool hasIconData() const;
 
-    void addFeatures(const GeometryTileLayer&,
+    // Doesn't wait for glyphs or the sprite that the features need. When they are still loading,
+    // nothing is added, they are added to the dependencies, and false is returned.
+    bool addFeatures(const GeometryTileLayer&,
                      const FilterExpression&,
                      uintptr_t tileUID,
                      SpriteAtlas&,
                      Sprite&,
                      GlyphAtlas&,
-                     GlyphStore&);
+                     GlyphStore&,
+                     SymbolDependencies&);
+
+    // Only adds what the features need and what is still loading to the dependencies, without
+    // placing anything. Returns false when something is still loading.
+    bool addDependencies(const GeometryTileLayer&,
+                         const FilterExpression&,
+                         GlyphStore&,
+                         const Sprite&,
+                         SymbolDependencies&);
+
+    // The vertices of the placed glyphs and icons.
+    std::size_t textVertexCount() const { return text.vertices.index(); }
+    std::size_t iconVertexCount() const { return icon.vertices.index(); }
 
     void drawGlyphs(SDFShader& shader);
     void drawIcons(SDFShader& shader);
     void drawIcons(IconShader& shader);
 
 private:
-    std::vector<SymbolFeature> processFeatures(const GeometryTileLayer&,
-                                               const FilterExpression&,
-                                               GlyphStore&,
-                                               const Sprite&);
+    bool processFeatures(const GeometryTileLayer&,
+                         const FilterExpression&,
+                         GlyphStore&,
+                         const Sprite&,
+                         std::vector<SymbolFeature>&,
+                         SymbolDependencies&);
 
     void addFeature(const std::vector<Coordinate> &line, const Shaping &shaping, const GlyphPositions &face, const Rect<uint16_t> &image);
 
@@ -2,6 +2,8 @@
 #include <mbgl/storage/request.hpp>
 #include <mbgl/storage/asset_request.hpp>
 #include <mbgl/storage/http_request.hpp>
+#include <mbgl/storage/mbtiles_request.hpp>
+#include <mbgl/storage/response_cache.hpp>
 
 #include <mbgl/storage/response.hpp>
 #include <mbgl/platform/platform.hpp>
@@ -28,12 +30,35 @@ namespace algo = boost::algorithm;
 
 namespace mbgl {
 
-DefaultFileSource::Impl::Impl(FileCache* cache_, const std::string& root)
-    : assetRoot(root.empty() ? platform::assetRoot() : root), cache(cache_) {
+namespace {
+
+const std::size_t defaultMemoryCacheSize = 8 * 1024 * 1024;
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(SystemClock::now().time_since_epoch()).count();
+}
+
+// Responses that say there is nothing at the URL: missing resources, and tiles without data.
+bool isNegative(const Resource& resource, const Response& response) {
+    return resource.kind == Resource::Tile &&
+           (response.status == Response::NotFound ||
+            (response.status == Response::Successful && response.data->empty()));
+}
+
 }
 
+DefaultFileSource::Impl::Impl(FileCache* cache_, ResponseCache* memoryCache_, const std::string& root)
+    : assetRoot(root.empty() ? platform::assetRoot() : root),
+      cache(cache_),
+      memoryCache(memoryCache_),
+      mbtiles(util::make_unique<MBTilesPool>()) {
+}
+
+DefaultFileSource::Impl::~Impl() = default;
+
 DefaultFileSource::DefaultFileSource(FileCache* cache, const std::string& root)
-    : thread(util::make_unique<util::Thread<Impl>>("FileSource", cache, root)) {
+    : memoryCache(util::make_unique<ResponseCache>(defaultMemoryCacheSize)),
+      thread(util::make_unique<util::Thread<Impl>>("FileSource", cache, memoryCache.get(), root)) {
 }
 
 DefaultFileSource::~DefaultFileSource() {
@@ -81,15 +106,74 @@ void DefaultFileSource::abort(const Environment &env) {
     thread->invoke(&Impl::abort, std::ref(env));
 }
 
+void DefaultFileSource::setMemoryCacheSize(std::size_t size) {
+    thread->invoke(&Impl::setMemoryCacheSize, size);
+}
+
+void DefaultFileSource::setStaleWhileRevalidate(bool enabled) {
+    thread->invoke(&Impl::setStaleWhileRevalidate, enabled);
+}
+
+void DefaultFileSource::setNegativeCacheTTL(std::chrono::seconds ttl) {
+    thread->invoke(&Impl::setNegativeCacheTTL, ttl);
+}
+
+void DefaultFileSource::setMaximumConnections(std::size_t perHost, std::size_t total) {
+    thread->invoke(&Impl::setMaximumConnections, perHost, total);
+}
+
+uint64_t DefaultFileSource::getMemoryCacheHits() const {
+    return memoryCache->hits;
+}
+
+uint64_t DefaultFileSource::getMemoryCacheMisses() const {
+    return memoryCache->misses;
+}
+
+void DefaultFileSource::Impl::setMemoryCacheSize(std::size_t size) {
+    memoryCache->setMaximumSize(size);
+}
+
+void DefaultFileSource::Impl::setMaximumConnections(std::size_t perHost, std::size_t total) {
+    assert(perHost > 0 && total > 0);
+    maxConnectionsPerHost = perHost;
+    maxConnections = total;
+}
+
+void DefaultFileSource::Impl::setStaleWhileRevalidate(bool enabled) {
+    staleWhileRevalidate = enabled;
+}
+
+void DefaultFileSource::Impl::setNegativeCacheTTL(std::chrono::seconds ttl) {
+    negativeCacheTTL = ttl;
+}
+
 void DefaultFileSource::Impl::add(Request* req, uv_loop_t* loop) {
     const Resource &resource = req->resource;
 
     // We're adding a new Request.
     SharedRequestBase *sharedRequest = find(resource);
     if (!sharedRequest) {
+        // Tiles in MBTiles files are read from local files directly, without the caches.
+        const bool local = algo::starts_with(resource.url, "mbtiles://");
+
+        // Recent responses are kept in memory, in front of the file cache.
+        std::shared_ptr<const Response> recent;
+        if (cache && !local) {
+            recent = memoryCache->get(resource);
+            if (recent && recent->expires > now()) {
+                memoryCache->hits++;
+                req->notify(recent);
+                return;
+            }
+            memoryCache->misses++;
+        }
+
         // There is no request for this URL yet. Create a new one and start it.
         if (algo::starts_with(resource.url, "asset://")) {
             sharedRequest = new AssetRequest(this, resource);
+        } else if (local) {
+            sharedRequest = new MBTilesRequest(this, resource, *mbtiles);
         } else {
             sharedRequest = new HTTPRequest(this, resource);
         }
@@ -99,8 +183,11 @@ void DefaultFileSource::Impl::add(Request* req, uv_loop_t* loop) {
         (void (inserted)); // silence unused variable warning on Release builds.
 
         // But first, we're going to start querying the database if it exists.
-        if (!cache) {
+        if (!cache || local) {
             sharedRequest->start(loop);
+        } else if (recent) {
+            // The response in memory is stale, and so is the one in the file cache. Revalidate it.
+            revalidate(sharedRequest, recent, loop);
         } else {
             // Otherwise, first check the cache for existing data so that we can potentially
             // revalidate the information without having to redownload everything.
@@ -108,8 +195,16 @@ void DefaultFileSource::Impl::add(Request* req, uv_loop_t* loop) {
                 processResult(resource, std::move(response), loop);
             });
         }
+    } else if (resource.priority == Resource::Priority::Regular) {
+        // The map needs a resource that was only prefetched so far.
+        sharedRequest->prioritize();
     }
     sharedRequest->subscribe(req);
+
+    if (sharedRequest->stale) {
+        // The response is revalidated in the background. Answer with the stale one meanwhile.
+        req->notify(sharedRequest->stale, true);
+    }
 }
 
 void DefaultFileSource::Impl::cancel(Request* req) {
@@ -134,16 +229,15 @@ void DefaultFileSource::Impl::processResult(const Resource& resource, std::share
     if (sharedRequest) {
         if (response) {
             // This entry was stored in the cache. Now determine if we need to revalidate.
-            const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
-                                    SystemClock::now().time_since_epoch()).count();
-            if (response->expires > now) {
+            memoryCache->put(resource, response);
+            if (response->expires > now()) {
                 // The response is fresh. We're good to notify the caller.
                 sharedRequest->notify(response, FileCache::Hint::No);
                 sharedRequest->cancel();
                 return;
             } else {
                 // The cached response is stale. Now run the real request.
-                sharedRequest->start(loop, response);
+                revalidate(sharedRequest, response, loop);
             }
         } else {
             // There is no response. Now run the real request.
@@ -155,6 +249,13 @@ void DefaultFileSource::Impl::processResult(const Resource& resource, std::share
     }
 }
 
+void DefaultFileSource::Impl::revalidate(SharedRequestBase *sharedRequest, std::shared_ptr<const Response> response, uv_loop_t* loop) {
+    if (staleWhileRevalidate && response->status == Response::Successful) {
+        sharedRequest->notifyStale(response);
+    }
+    sharedRequest->start(loop, response);
+}
+
 // Aborts all requests that are part of the current environment.
 void DefaultFileSource::Impl::abort(const Environment& env) {
     // Construct a cancellation response.
@@ -192,13 +293,32 @@ void DefaultFileSource::Impl::notify(SharedRequestBase *sharedRequest,
 
     if (response) {
         if (cache) {
+            if (hint != FileCache::Hint::No && response->expires == 0 &&
+                isNegative(sharedRequest->resource, *response)) {
+                // The server didn't say how long this resource is missing. Assume it stays missing
+                // for a while, instead of asking again every time.
+                auto negative = std::make_shared<Response>(*response);
+                negative->expires = now() + negativeCacheTTL.count();
+                response = std::move(negative);
+            }
+
             // Store response in database
             cache->put(sharedRequest->resource, response, hint);
+            if (hint != FileCache::Hint::No) {
+                memoryCache->put(sharedRequest->resource, response);
+            }
         }
 
+        // Observers that were answered with a stale response only hear again if it changed. If
+        // revalidating failed, they keep the stale one.
+        const auto& stale = sharedRequest->stale;
+        const bool changed = !stale || (response->status == Response::Successful &&
+                                        response->data != stale->data &&
+                                        *response->data != *stale->data);
+
         // Notify all observers.
         for (auto req : observers) {
-            req->notify(response);
+            req->notify(changed ? response : nullptr);
         }
     }
 }
@@ -9,10 +9,12 @@
 namespace mbgl {
 
 class SharedRequestBase;
+class MBTilesPool;
 
 class DefaultFileSource::Impl {
 public:
-    Impl(FileCache *cache, const std::string &root = "");
+    Impl(FileCache *cache, ResponseCache *memoryCache, const std::string &root = "");
+    ~Impl();
 
     void notify(SharedRequestBase *sharedRequest, const std::set<Request *> &observers,
                 std::shared_ptr<const Response> response, FileCache::Hint hint);
@@ -21,14 +23,27 @@ public:
     void add(Request* request, uv_loop_t* loop);
     void cancel(Request* request);
     void abort(const Environment& env);
+    void setMemoryCacheSize(std::size_t size);
+    void setMaximumConnections(std::size_t perHost, std::size_t total);
+    void setStaleWhileRevalidate(bool enabled);
+    void setNegativeCacheTTL(std::chrono::seconds ttl);
 
     const std::string assetRoot;
 
+    // Read by HTTP requests as they start.
+    std::size_t maxConnectionsPerHost = 8;
+    std::size_t maxConnections = 16;
+
 private:
     void processResult(const Resource& resource, std::shared_ptr<const Response> response, uv_loop_t* loop);
+    void revalidate(SharedRequestBase *sharedRequest, std::shared_ptr<const Response> response, uv_loop_t* loop);
 
     std::unordered_map<Resource, SharedRequestBase *, Resource::Hash> pending;
     FileCache *cache = nullptr;
+    ResponseCache *memoryCache = nullptr;
+    const std::unique_ptr<MBTilesPool> mbtiles;
+    bool staleWhileRevalidate = false;
+    std::chrono::seconds negativeCacheTTL = std::chrono::hours(1);
 };
 
 }
@@ -11,12 +11,14 @@ public:
 
     void start(uv_loop_t *loop, std::shared_ptr<const Response> response = nullptr);
     void cancel();
+    void prioritize();
 
     void retryImmediately();
 
 private:
     ~HTTPRequest();
     void *ptr = nullptr;
+    bool prefetch = false;
 
     friend class HTTPRequestImpl;
 };
@@ -0,0 +1,55 @@
+#include <mbgl/storage/mbtiles_request.hpp>
+#include <mbgl/storage/response.hpp>
+
+#pragma GCC diagnostic push
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wunused-local-typedefs"
+#pragma GCC diagnostic ignored "-Wshadow"
+#endif
+#include <boost/algorithm/string.hpp>
+#pragma GCC diagnostic pop
+
+#include <cassert>
+
+namespace algo = boost::algorithm;
+
+namespace mbgl {
+
+MBTilesRequest::MBTilesRequest(DefaultFileSource::Impl *source_, const Resource &resource_, MBTilesPool &pool_)
+    : SharedRequestBase(source_, resource_), pool(pool_) {
+    assert(algo::starts_with(resource.url, "mbtiles://"));
+}
+
+MBTilesRequest::~MBTilesRequest() {
+    MBGL_VERIFY_THREAD(tid);
+}
+
+void MBTilesRequest::start(uv_loop_t *, std::shared_ptr<const Response> response) {
+    MBGL_VERIFY_THREAD(tid);
+
+    // Tiles in MBTiles files don't expire, so we're ignoring the existing response if any.
+    (void(response));
+
+    assert(!canceled);
+    canceled = std::make_shared<bool>(false);
+    auto flag = canceled;
+    pool.get(resource.url, source->assetRoot, [this, flag](std::unique_ptr<Response> result) {
+        if (*flag) {
+            // The request was deleted in the meantime.
+            return;
+        }
+        notify(std::move(result), FileCache::Hint::No);
+        delete this;
+    });
+}
+
+void MBTilesRequest::cancel() {
+    MBGL_VERIFY_THREAD(tid);
+
+    if (canceled) {
+        *canceled = true;
+    }
+    delete this;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef MBGL_STORAGE_DEFAULT_MBTILES_REQUEST
+#define MBGL_STORAGE_DEFAULT_MBTILES_REQUEST
+
+#include "shared_request_base.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mbgl {
+
+namespace util {
+template <typename T> class Thread;
+}
+
+// Reads tiles from MBTiles files. Reads are spread over a few read-only connections, each on a
+// thread of its own, which open the files as they are first requested and keep them open.
+class MBTilesPool {
+public:
+    using Callback = std::function<void (std::unique_ptr<Response>)>;
+
+    MBTilesPool();
+    ~MBTilesPool();
+
+    // Reads the tile of an mbtiles://path/{z}/{x}/{y} URL, with relative paths relative to root,
+    // and calls back in the calling thread. Tiles that aren't in the file are NotFound, invalid
+    // URLs and files that can't be read are errors.
+    void get(const std::string& url, const std::string& root, Callback callback);
+
+private:
+    class Reader;
+
+    std::vector<std::unique_ptr<util::Thread<Reader>>> readers;
+    std::size_t nextReader = 0;
+};
+
+// Answers mbtiles:// URLs. Relative paths are relative to the asset root.
+class MBTilesRequest : public SharedRequestBase {
+public:
+    MBTilesRequest(DefaultFileSource::Impl *source, const Resource &resource, MBTilesPool &pool);
+
+    void start(uv_loop_t *loop, std::shared_ptr<const Response> response = nullptr);
+    void cancel();
+
+private:
+    ~MBTilesRequest();
+
+    MBTilesPool &pool;
+
+    // Reads can't be canceled, so the request tells the pending read that it is gone.
+    std::shared_ptr<bool> canceled;
+};
+
+}
+
+#endif
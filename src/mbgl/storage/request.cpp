@@ -50,13 +50,33 @@ void Request::notifyCallback() {
 }
 
 void Request::invoke() {
-    assert(response);
+    std::shared_ptr<const Response> current;
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (canceled) {
+            // A request without a loop was canceled in another thread. destruct() deletes it.
+            return;
+        }
+        current.swap(response);
+        last = done;
+    }
+
     // The user could supply a null pointer or empty std::function as a callback. In this case, we
     // still do the file request, but we don't need to deliver a result.
-    if (callback) {
-        callback(*response);
+    if (current && callback) {
+        callback(*current);
+    }
+    if (last) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (canceled) {
+                // Canceled while the callback ran. destruct() deletes it.
+                return;
+            }
+        }
+        delete this;
     }
-    delete this;
 }
 
 Request::~Request() {
@@ -68,24 +88,33 @@ Request::~Request() {
 }
 
 // Called in the FileSource thread.
-void Request::notify(const std::shared_ptr<const Response> &response_) {
-    assert(!response);
-    response = response_;
-    assert(response);
+void Request::notify(const std::shared_ptr<const Response> &response_, bool stale) {
+    assert(response_ || !stale);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        assert(!done);
+        if (response_) {
+            // Replaces a stale response that wasn't passed to the callback yet.
+            response = response_;
+        }
+        done = !stale;
+    }
 
     if (async) {
         uv_async_send(async);
     } else {
-        // This request is not cancelable. This means that the callback will be executed in an
-        // arbitrary thread (== FileSource thread).
+        // There is no loop. This means that the callback will be executed in an arbitrary thread
+        // (== FileSource thread).
         invoke();
     }
 }
 
-// Called in the originating thread.
+// Called in the originating thread, or in any thread if there is no loop.
 void Request::cancel() {
-    MBGL_VERIFY_THREAD(tid)
-    assert(async);
+    if (async) {
+        MBGL_VERIFY_THREAD(tid)
+    }
+    std::lock_guard<std::mutex> lock(mutex);
     assert(!canceled);
     canceled = util::make_unique<Canceled>();
 }
@@ -94,8 +123,12 @@ void Request::cancel() {
 // Called in the FileSource thread.
 // Will only ever be invoked after cancel() was called in the original requesting thread.
 void Request::destruct() {
-    assert(async);
     assert(canceled);
+    if (!async) {
+        // The callback runs in this thread, so nothing else refers to the request anymore.
+        delete this;
+        return;
+    }
     std::unique_lock<std::mutex> lock(canceled->mutex);
     canceled->confirmed = true;
     uv_async_send(async);
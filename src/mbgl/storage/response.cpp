@@ -0,0 +1,18 @@
+#include <mbgl/storage/response.hpp>
+
+namespace mbgl {
+
+namespace {
+
+// Responses without a body share the same empty one.
+const std::shared_ptr<const std::string>& emptyData() {
+    static const auto empty = std::make_shared<const std::string>();
+    return empty;
+}
+
+}
+
+Response::Response() : data(emptyData()) {
+}
+
+}
@@ -0,0 +1,64 @@
+#include <mbgl/storage/response_cache.hpp>
+#include <mbgl/storage/response.hpp>
+
+#include <iterator>
+
+namespace mbgl {
+
+namespace {
+
+// The memory a response takes up, roughly.
+std::size_t responseSize(const Resource& resource, const Response& response) {
+    return sizeof(Response) + resource.url.size() + response.message.size() +
+           response.etag.size() + response.data->size();
+}
+
+}
+
+ResponseCache::ResponseCache(std::size_t maximumSize_) : maximumSize(maximumSize_) {
+}
+
+std::shared_ptr<const Response> ResponseCache::get(const Resource& resource) {
+    const auto it = index.find(resource);
+    if (it == index.end()) {
+        return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+void ResponseCache::put(const Resource& resource, std::shared_ptr<const Response> response) {
+    const auto it = index.find(resource);
+    if (it != index.end()) {
+        erase(it->second);
+    }
+
+    if (!response || responseSize(resource, *response) > maximumSize) {
+        return;
+    }
+
+    currentSize += responseSize(resource, *response);
+    entries.emplace_front(resource, std::move(response));
+    index.emplace(resource, entries.begin());
+    evict();
+}
+
+void ResponseCache::setMaximumSize(std::size_t size) {
+    maximumSize = size;
+    evict();
+}
+
+void ResponseCache::erase(std::list<Entry>::iterator it) {
+    currentSize -= responseSize(it->first, *it->second);
+    index.erase(it->first);
+    entries.erase(it);
+}
+
+void ResponseCache::evict() {
+    while (currentSize > maximumSize) {
+        erase(std::prev(entries.end()));
+    }
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef MBGL_STORAGE_RESPONSE_CACHE
+#define MBGL_STORAGE_RESPONSE_CACHE
+
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/util/noncopyable.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace mbgl {
+
+class Response;
+
+// Keeps the most recently used responses in memory, up to a number of bytes. Responses are
+// shared rather than copied. Must only be used by one thread, except for the counters.
+class ResponseCache : private util::noncopyable {
+public:
+    explicit ResponseCache(std::size_t maximumSize);
+
+    // Returns the stored response, fresh or not, and makes it the most recently used one.
+    std::shared_ptr<const Response> get(const Resource&);
+
+    // Replaces the stored response, then evicts the least recently used responses until the cache
+    // fits its maximum size again. Responses larger than that aren't stored.
+    void put(const Resource&, std::shared_ptr<const Response>);
+
+    void setMaximumSize(std::size_t);
+
+    std::size_t size() const { return currentSize; }
+
+    // Requests answered by a fresh response, and requests that needed the file cache or the
+    // network. Can be read from any thread.
+    std::atomic<uint64_t> hits { 0 };
+    std::atomic<uint64_t> misses { 0 };
+
+private:
+    using Entry = std::pair<Resource, std::shared_ptr<const Response>>;
+
+    void erase(std::list<Entry>::iterator);
+    void evict();
+
+    // Most recently used first.
+    std::list<Entry> entries;
+    std::unordered_map<Resource, std::list<Entry>::iterator, Resource::Hash> index;
+
+    std::size_t maximumSize;
+    std::size_t currentSize = 0;
+};
+
+}
+
+#endif
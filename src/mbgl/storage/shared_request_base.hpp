@@ -32,6 +32,9 @@ public:
     virtual void start(uv_loop_t *loop, std::shared_ptr<const Response> response = nullptr) = 0;
     virtual void cancel() = 0;
 
+    // Called when a regular request joins one that was started as a prefetch.
+    virtual void prioritize() {}
+
     void notify(std::shared_ptr<const Response> response, FileCache::Hint hint) {
         MBGL_VERIFY_THREAD(tid);
 
@@ -46,6 +49,16 @@ public:
         observers.insert(request);
     }
 
+    // Answers the observers with a stale response while it is revalidated.
+    void notifyStale(std::shared_ptr<const Response> response) {
+        MBGL_VERIFY_THREAD(tid);
+
+        stale = response;
+        for (auto req : observers) {
+            req->notify(stale, true);
+        }
+    }
+
     void unsubscribe(Request *request) {
         MBGL_VERIFY_THREAD(tid);
 
@@ -94,6 +107,9 @@ protected:
 public:
     const Resource resource;
 
+    // The response that the observers were answered with while it is revalidated, if any.
+    std::shared_ptr<const Response> stale;
+
 protected:
     DefaultFileSource::Impl *source = nullptr;
 
@@ -141,8 +141,9 @@ void FontStack::lineWrap(Shaping &shaping, const float lineHeight, const float m
 GlyphPBF::GlyphPBF(const std::string &glyphURL,
                    const std::string &fontStack,
                    GlyphRange glyphRange,
-                   Environment &env)
-    : future(promise.get_future().share()) {
+                   Environment &env,
+                   std::function<void ()> callback)
+    : result(std::make_shared<Result>()) {
     // Load the glyph set URL
     std::string url = util::replaceTokens(glyphURL, [&](const std::string &name) -> std::string {
         if (name == "fontstack") return util::percentEncode(fontStack);
@@ -150,39 +151,61 @@ GlyphPBF::GlyphPBF(const std::string &glyphURL,
         return "";
     });
 
-    // The prepare call jumps back to the main thread.
-    env.requestAsync({ Resource::Kind::Glyphs, url }, [&, url](const Response &res) {
+    req = env.requestAsync({ Resource::Kind::Glyphs, url });
+    std::weak_ptr<Result> weak = result;
+    req.then([weak, callback](const Response &res) {
+        auto loaded = weak.lock();
+        if (!loaded) {
+            return;
+        }
+
         if (res.status != Response::Successful) {
-            // Something went wrong with loading the glyph pbf. Pass on the error to the future listeners.
-            const std::string msg = std::string { "[ERROR] failed to load glyphs: " } + res.message;
-            promise.set_exception(std::make_exception_ptr(std::runtime_error(msg)));
+            // Something went wrong with loading the glyph pbf. Pass on the error to parse().
+            loaded->error = std::string { "[ERROR] failed to load glyphs: " } + res.message;
         } else {
             // Transfer the data to the GlyphSet and signal its availability.
             // Once it is available, the caller will need to call parse() to actually
             // parse the data we received. We are not doing this here since this callback is being
             // called from another (unknown) thread.
-            data = res.data;
-            promise.set_value(*this);
+            loaded->data = res.data;
+        }
+        loaded->loaded = true;
+
+        if (callback) {
+            callback();
         }
     });
 }
 
+GlyphPBF::~GlyphPBF() {
+    req.cancel();
+}
 
-std::shared_future<GlyphPBF &> GlyphPBF::getFuture() {
-    return future;
+bool GlyphPBF::isLoaded() const {
+    return result->loaded;
 }
 
 void GlyphPBF::parse(FontStack &stack) {
     std::lock_guard<std::mutex> lock(mtx);
 
-    if (!data.size()) {
+    if (!result->loaded) {
+        return;
+    }
+
+    if (!result->error.empty()) {
+        throw std::runtime_error(result->error);
+    }
+
+    auto& data = result->data;
+
+    if (!data || data->empty()) {
         // If there is no data, this means we either haven't received any data, or
         // we have already parsed the data.
         return;
     }
 
     // Parse the glyph PBF
-    pbf glyphs_pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    pbf glyphs_pbf(reinterpret_cast<const uint8_t *>(data->data()), data->size());
 
     while (glyphs_pbf.next()) {
         if (glyphs_pbf.tag == 1) { // stacks
@@ -223,7 +246,7 @@ void GlyphPBF::parse(FontStack &stack) {
         }
     }
 
-    data.clear();
+    data.reset();
 }
 
 GlyphStore::GlyphStore(Environment& env_) : env(env_), mtx(util::make_unique<uv::mutex>()) {}
@@ -233,45 +256,79 @@ void GlyphStore::setURL(const std::string &url) {
 }
 
 
-void GlyphStore::waitForGlyphRanges(const std::string &fontStack, const std::set<GlyphRange> &glyphRanges) {
-    // We are implementing a blocking wait with futures: Every GlyphSet has a future that we are
-    // waiting for until it is loaded.
+void GlyphStore::setObserver(std::function<void ()> observer_) {
+    std::lock_guard<std::mutex> lock(observerMutex);
+    observer = std::move(observer_);
+}
+
+void GlyphStore::notify() {
+    std::lock_guard<std::mutex> lock(observerMutex);
+    if (observer) {
+        observer();
+    }
+}
+
+bool GlyphStore::loadGlyphRanges(const std::string &fontStack, const std::set<GlyphRange> &glyphRanges) {
     if (glyphRanges.empty()) {
-        return;
+        return true;
     }
 
     uv::exclusive<FontStack> stack(mtx);
 
-    std::vector<std::shared_future<GlyphPBF &>> futures;
-    futures.reserve(glyphRanges.size());
+    std::vector<GlyphPBF *> glyphSets;
+    glyphSets.reserve(glyphRanges.size());
     {
         auto &rangeSets = ranges[fontStack];
 
         stack << createFontStack(fontStack);
 
         // Attempt to load the glyph range. If the GlyphSet already exists, we are getting back
-        // the same shared_future.
+        // the same one.
         for (const auto range : glyphRanges) {
-            futures.emplace_back(loadGlyphRange(fontStack, rangeSets, range));
+            glyphSets.emplace_back(&loadGlyphRange(fontStack, rangeSets, range));
+        }
+    }
+
+    // Parse the GlyphSets that are loaded already. Those that are still loading are parsed by a
+    // later call, once they arrived.
+    bool loaded = true;
+    for (const auto glyphSet : glyphSets) {
+        if (glyphSet->isLoaded()) {
+            glyphSet->parse(stack);
+        } else {
+            loaded = false;
         }
     }
 
-    // Now that we potentially created all GlyphSets, we are waiting for the results, one by one.
-    // When we get a result (or the GlyphSet is aready loaded), we are attempting to parse the
-    // GlyphSet.
-    for (const auto& future : futures) {
-        future.get().parse(stack);
+    return loaded;
+}
+
+bool GlyphStore::hasGlyphRanges(const std::string &fontStack, const std::set<GlyphRange> &glyphRanges) {
+    uv::lock lock(mtx);
+
+    auto rangeSets = ranges.find(fontStack);
+    if (rangeSets == ranges.end()) {
+        return glyphRanges.empty();
     }
+
+    for (const auto& range : glyphRanges) {
+        auto it = rangeSets->second.find(range);
+        if (it == rangeSets->second.end() || !it->second->isLoaded()) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-std::shared_future<GlyphPBF &> GlyphStore::loadGlyphRange(const std::string &fontStack, std::map<GlyphRange, std::unique_ptr<GlyphPBF>> &rangeSets, const GlyphRange range) {
+GlyphPBF &GlyphStore::loadGlyphRange(const std::string &fontStack, std::map<GlyphRange, std::unique_ptr<GlyphPBF>> &rangeSets, const GlyphRange range) {
     auto range_it = rangeSets.find(range);
     if (range_it == rangeSets.end()) {
         // We don't have this glyph set yet for this font stack.
-        range_it = rangeSets.emplace(range, util::make_unique<GlyphPBF>(glyphURL, fontStack, range, env)).first;
+        range_it = rangeSets.emplace(range, util::make_unique<GlyphPBF>(glyphURL, fontStack, range, env, [this] { notify(); })).first;
     }
 
-    return range_it->second->getFuture();
+    return *range_it->second;
 }
 
 FontStack &GlyphStore::createFontStack(const std::string &fontStack) {
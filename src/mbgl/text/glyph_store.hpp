@@ -2,14 +2,18 @@
 #define MBGL_TEXT_GLYPH_STORE
 
 #include <mbgl/text/glyph.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/util/async.hpp>
 #include <mbgl/util/vec.hpp>
 #include <mbgl/util/ptr.hpp>
 #include <mbgl/util/uv.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <vector>
-#include <future>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 
@@ -49,10 +53,13 @@ private:
 
 class GlyphPBF {
 public:
+    // The callback is called from an unknown thread once the glyphs were loaded or failed to load.
     GlyphPBF(const std::string &glyphURL,
              const std::string &fontStack,
              GlyphRange glyphRange,
-             Environment &env);
+             Environment &env,
+             std::function<void ()> callback);
+    ~GlyphPBF();
 
 private:
     GlyphPBF(const GlyphPBF &) = delete;
@@ -61,14 +68,23 @@ private:
     GlyphPBF &operator=(GlyphPBF &&) = delete;
 
 public:
+    // Adds the glyphs to the font stack once they arrived. Throws if they failed to load.
     void parse(FontStack &stack);
 
-    std::shared_future<GlyphPBF &> getFuture();
+    // Whether the glyphs arrived or failed to load.
+    bool isLoaded() const;
 
 private:
-    std::string data;
-    std::promise<GlyphPBF &> promise;
-    std::shared_future<GlyphPBF &> future;
+    // What the request delivered. The request only holds on to it weakly, so that a response
+    // that arrives while the glyph set is destroyed goes nowhere.
+    struct Result {
+        std::shared_ptr<const std::string> data;
+        std::string error;
+        std::atomic<bool> loaded { false };
+    };
+
+    std::shared_ptr<Result> result;
+    util::Async<Response> req;
     std::mutex mtx;
 };
 
@@ -77,20 +93,34 @@ class GlyphStore {
 public:
     GlyphStore(Environment &);
 
-    // Block until all specified GlyphRanges of the specified font stack are loaded.
-    void waitForGlyphRanges(const std::string &fontStack, const std::set<GlyphRange> &glyphRanges);
+    // Starts loading the specified GlyphRanges of the specified font stack, and adds the ones that
+    // are loaded to the font stack. Returns whether all of them were loaded, without waiting for
+    // the others. Throws if one of them failed to load.
+    bool loadGlyphRanges(const std::string &fontStack, const std::set<GlyphRange> &glyphRanges);
+
+    // Returns whether all specified GlyphRanges that were requested with loadGlyphRanges() have
+    // arrived, so that the next call to loadGlyphRanges() succeeds.
+    bool hasGlyphRanges(const std::string &fontStack, const std::set<GlyphRange> &glyphRanges);
 
     uv::exclusive<FontStack> getFontStack(const std::string &fontStack);
 
     void setURL(const std::string &url);
 
+    // Called from an unknown thread whenever a glyph range finished loading. Once this returns,
+    // the previous observer doesn't run anymore.
+    void setObserver(std::function<void ()> observer);
+
 private:
+    void notify();
+
     // Loads an individual glyph range from the font stack and adds it to rangeSets
-    std::shared_future<GlyphPBF &> loadGlyphRange(const std::string &fontStack, std::map<GlyphRange, std::unique_ptr<GlyphPBF>> &rangeSets, GlyphRange range);
+    GlyphPBF &loadGlyphRange(const std::string &fontStack, std::map<GlyphRange, std::unique_ptr<GlyphPBF>> &rangeSets, GlyphRange range);
 
     FontStack &createFontStack(const std::string &fontStack);
 
     std::string glyphURL;
+    std::function<void ()> observer;
+    std::mutex observerMutex;
     Environment &env;
     std::unordered_map<std::string, std::map<GlyphRange, std::unique_ptr<GlyphPBF>>> ranges;
     std::unordered_map<std::string, std::unique_ptr<FontStack>> stacks;
@@ -0,0 +1,250 @@
+#ifndef MBGL_UTIL_ASYNC
+#define MBGL_UTIL_ASYNC
+
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mbgl {
+namespace util {
+
+template <class T> class Async;
+
+template <class T> struct IsAsync : std::false_type {};
+template <class T> struct IsAsync<Async<T>> : std::true_type {};
+
+// The result of a step that completes later, such as a request. Further steps are chained with
+// then() and run in the thread that completes the step they wait for, so that no thread has to
+// wait for a result. Canceling a step also cancels the steps it waits for, up to the first step
+// of the chain, and none of the steps chained to a canceled step run. Copies refer to the same
+// step.
+template <class T>
+class Async {
+    template <class Fn>
+    using Result = typename std::result_of<Fn(const T&)>::type;
+
+public:
+    using value_type = T;
+
+    // An empty handle. Canceling it does nothing.
+    Async() = default;
+
+    // A step that completes once resolve() is called.
+    static Async pending() {
+        return Async(std::make_shared<State>());
+    }
+
+    static Async resolved(T value) {
+        Async async = pending();
+        async.resolve(std::move(value));
+        return async;
+    }
+
+    explicit operator bool() const {
+        return bool(state);
+    }
+
+    // Completes the step and runs the steps chained to it in the calling thread. Does nothing if
+    // the step was completed or canceled before.
+    void resolve(T value) const {
+        complete(std::move(value), false);
+    }
+
+    // Like resolve(), for steps whose work goes on after they completed, such as a request that
+    // answered with a stale response and is revalidated. Canceling the step still runs its
+    // canceler until release() is called.
+    void resolveAndKeepCanceler(T value) const {
+        complete(std::move(value), true);
+    }
+
+    // Drops the canceler that resolveAndKeepCanceler() kept, once the work is done.
+    void release() const {
+        assert(state);
+        std::function<void ()> canceler;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->status == Status::Resolved) {
+                canceler.swap(state->canceler);
+            }
+        }
+    }
+
+    // Sets what canceling the pending step does, typically canceling the work that completes it.
+    // Runs right away if the step was canceled already, and never if it completed.
+    void onCancel(std::function<void ()> canceler) const {
+        assert(state);
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->status == Status::Pending) {
+                state->canceler.swap(canceler);
+                return;
+            }
+            if (state->status == Status::Resolved) {
+                return;
+            }
+        }
+        if (canceler) {
+            canceler();
+        }
+    }
+
+    void cancel() const {
+        if (!state) {
+            return;
+        }
+        std::vector<Continuation> continuations;
+        std::function<void ()> canceler;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->status == Status::Canceled) {
+                return;
+            }
+            if (state->status == Status::Pending) {
+                state->status = Status::Canceled;
+                continuations.swap(state->continuations);
+            }
+            // Completed steps only have a canceler if resolveAndKeepCanceler() kept it.
+            canceler.swap(state->canceler);
+        }
+        if (canceler) {
+            canceler();
+        }
+    }
+
+    bool isResolved() const {
+        return is(Status::Resolved);
+    }
+
+    bool isCanceled() const {
+        return is(Status::Canceled);
+    }
+
+    // Chains a step that ends the chain.
+    template <class Fn, class R = Result<Fn>>
+    typename std::enable_if<std::is_void<R>::value>::type then(Fn fn) const {
+        add(std::move(fn));
+    }
+
+    // Chains a step that continues with another asynchronous step. The returned step completes
+    // once that one does, and canceling it cancels whichever of the two is pending.
+    template <class Fn, class R = Result<Fn>>
+    typename std::enable_if<IsAsync<R>::value, R>::type then(Fn fn) const {
+        R next = chain<typename R::value_type>();
+        add([next, fn](const T& value) {
+            if (next.isCanceled()) {
+                return;
+            }
+            R step = fn(value);
+            if (!step) {
+                next.cancel();
+                return;
+            }
+            std::weak_ptr<typename R::State> weak = step.state;
+            next.onCancel([weak] {
+                R(weak.lock()).cancel();
+            });
+            step.then([next](const typename R::value_type& result) {
+                next.resolve(result);
+            });
+        });
+        return next;
+    }
+
+    // Chains a step that transforms the result. The returned step completes with its return value.
+    template <class Fn, class R = Result<Fn>>
+    typename std::enable_if<!std::is_void<R>::value && !IsAsync<R>::value, Async<R>>::type
+    then(Fn fn) const {
+        Async<R> next = chain<R>();
+        add([next, fn](const T& value) {
+            if (!next.isCanceled()) {
+                next.resolve(fn(value));
+            }
+        });
+        return next;
+    }
+
+private:
+    template <class> friend class Async;
+
+    using Continuation = std::function<void (const T&)>;
+
+    enum class Status { Pending, Resolved, Canceled };
+
+    struct State {
+        std::mutex mutex;
+        Status status = Status::Pending;
+        std::unique_ptr<T> value;
+        std::vector<Continuation> continuations;
+        std::function<void ()> canceler;
+    };
+
+    explicit Async(std::shared_ptr<State> state_) : state(std::move(state_)) {}
+
+    void complete(T value, bool keepCanceler) const {
+        assert(state);
+        std::vector<Continuation> continuations;
+        std::function<void ()> canceler;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->status != Status::Pending) {
+                return;
+            }
+            state->value.reset(new T(std::move(value)));
+            state->status = Status::Resolved;
+            continuations.swap(state->continuations);
+            if (!keepCanceler) {
+                canceler.swap(state->canceler);
+            }
+        }
+        for (const auto& continuation : continuations) {
+            continuation(*state->value);
+        }
+    }
+
+    bool is(Status status) const {
+        if (!state) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->status == status;
+    }
+
+    // A pending step that cancels this one when it is canceled. It only holds on to this step
+    // weakly: steps are kept alive by the steps they wait for, and by whoever completes them.
+    template <class U>
+    Async<U> chain() const {
+        assert(state);
+        Async<U> next = Async<U>::pending();
+        std::weak_ptr<State> weak = state;
+        next.onCancel([weak] {
+            Async(weak.lock()).cancel();
+        });
+        return next;
+    }
+
+    void add(Continuation continuation) const {
+        assert(state);
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->status == Status::Pending) {
+                state->continuations.push_back(std::move(continuation));
+                return;
+            }
+            if (state->status == Status::Canceled) {
+                return;
+            }
+        }
+        continuation(*state->value);
+    }
+
+    std::shared_ptr<State> state;
+};
+
+}
+}
+
+#endif
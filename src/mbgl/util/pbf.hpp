@@ -9,6 +9,7 @@
  */
 
 #include <string>
+#include <vector>
 #include <cstring>
 
 namespace mbgl {
@@ -28,8 +29,13 @@ struct pbf {
     inline bool next();
     inline bool next(uint32_t tag);
     template <typename T = uint32_t> inline T varint();
+    template <typename T = uint32_t> inline T varintChecked();
     template <typename T = uint32_t> inline T svarint();
 
+    // Reads a packed repeated field and replaces the contents of the buffer with its values.
+    template <typename T = uint32_t> inline void packedVarint(std::vector<T>& buffer);
+    template <typename T = uint32_t> inline void packedSvarint(std::vector<T>& buffer);
+
     template <typename T = uint32_t, int bytes = 4> inline T fixed();
     inline float float32();
     inline double float64();
@@ -90,6 +96,40 @@ bool pbf::next(uint32_t requested_tag) {
 
 template <typename T>
 T pbf::varint() {
+    // Most varints in a tile are a single byte.
+    if (data < end && *data < 0x80) {
+        return static_cast<T>(*data++);
+    }
+
+    // A varint is at most 10 bytes long. When that many bytes remain, decode without checking for
+    // the end of the buffer on every byte.
+    if (end - data < 10) {
+        return varintChecked<T>();
+    }
+
+    const uint8_t *pos = data;
+    uint64_t byte = *pos++;
+    uint64_t result = byte & 0x7F;
+    byte = *pos++;
+    result |= (byte & 0x7F) << 7;
+    if (byte & 0x80) {
+        int bitpos = 14;
+        do {
+            if (bitpos == 70) {
+                throw varint_too_long_exception();
+            }
+            byte = *pos++;
+            result |= (byte & 0x7F) << bitpos;
+            bitpos += 7;
+        } while (byte & 0x80);
+    }
+
+    data = pos;
+    return static_cast<T>(result);
+}
+
+template <typename T>
+T pbf::varintChecked() {
     uint8_t byte = 0x80;
     T result = 0;
     int bitpos;
@@ -114,6 +154,30 @@ T pbf::svarint() {
     return (n >> 1) ^ -(T)(n & 1);
 }
 
+template <typename T>
+void pbf::packedVarint(std::vector<T>& buffer) {
+    pbf packed = message();
+    // Every value takes at least one byte, so the byte length is an upper bound for the count.
+    buffer.resize(packed.end - packed.data);
+    T *out = buffer.data();
+    while (packed.data < packed.end) {
+        *out++ = packed.varint<T>();
+    }
+    buffer.resize(out - buffer.data());
+}
+
+template <typename T>
+void pbf::packedSvarint(std::vector<T>& buffer) {
+    pbf packed = message();
+    // Every value takes at least one byte, so the byte length is an upper bound for the count.
+    buffer.resize(packed.end - packed.data);
+    T *out = buffer.data();
+    while (packed.data < packed.end) {
+        *out++ = packed.svarint<T>();
+    }
+    buffer.resize(out - buffer.data());
+}
+
 template <typename T, int bytes>
 T pbf::fixed() {
     skipBytes(bytes);
@@ -9,18 +9,23 @@ RunLoop::RunLoop()
     : async(*loop, std::bind(&RunLoop::process, this)) {
 }
 
-void RunLoop::withMutex(std::function<void()>&& fn) {
-    std::lock_guard<std::mutex> lock(mutex);
-    fn();
+RunLoop::~RunLoop() {
+    // Messages that arrived after the loop stopped are dropped.
+    Message* message = queue.drain();
+    while (message) {
+        std::unique_ptr<Message> dropped(message);
+        message = message->next;
+    }
 }
 
 void RunLoop::process() {
-    Queue queue_;
-    withMutex([&] { queue_.swap(queue); });
-
-    while (!queue_.empty()) {
-        (*(queue_.front()))();
-        queue_.pop();
+    // Runs everything that was invoked until now. Messages that are invoked meanwhile wake up the
+    // loop again.
+    Message* message = queue.drain();
+    while (message) {
+        std::unique_ptr<Message> invoked(message);
+        message = message->next;
+        (*invoked)();
     }
 }
 
@@ -1,13 +1,13 @@
 #ifndef MBGL_UTIL_RUN_LOOP
 #define MBGL_UTIL_RUN_LOOP
 
+#include <mbgl/util/mpsc_queue.hpp>
 #include <mbgl/util/noncopyable.hpp>
 #include <mbgl/util/std.hpp>
 #include <mbgl/util/uv_detail.hpp>
 
 #include <functional>
-#include <queue>
-#include <mutex>
+#include <memory>
 
 namespace mbgl {
 namespace util {
@@ -15,16 +15,21 @@ namespace util {
 class RunLoop : private util::noncopyable {
 public:
     RunLoop();
+    ~RunLoop();
 
     void run();
     void stop();
 
+    // The loop that runs in the calling thread, if any.
+    static RunLoop* Get() { return current.get(); }
+
     // Invoke fn() in the runloop thread.
     template <class Fn>
     void invoke(Fn&& fn) {
-        auto invokable = util::make_unique<Invoker<Fn>>(std::move(fn));
-        withMutex([&] { queue.push(std::move(invokable)); });
-        async.send();
+        // Only the first message after the queue was drained needs to wake up the loop.
+        if (queue.push(new Invoker<Fn>(std::move(fn)))) {
+            async.send();
+        }
     }
 
     // Invoke fn() in the runloop thread, then invoke callback(result) in the current thread.
@@ -56,10 +61,14 @@ public:
 private:
     // A movable type-erasing invokable entity wrapper. This allows to store arbitrary invokable
     // things (like std::function<>, or the result of a movable-only std::bind()) in the queue.
+    // The invokable is stored inline, so a message is a single allocation that is also the
+    // queue node.
     // Source: http://stackoverflow.com/a/29642072/331379
     struct Message {
         virtual void operator()() = 0;
         virtual ~Message() = default;
+
+        Message* next = nullptr;
     };
 
     template <class F>
@@ -69,15 +78,11 @@ private:
         F func;
     };
 
-    using Queue = std::queue<std::unique_ptr<Message>>;
-
     static uv::tls<RunLoop> current;
 
-    void withMutex(std::function<void()>&&);
     void process();
 
-    Queue queue;
-    std::mutex mutex;
+    MPSCQueue<Message> queue;
 
     uv::loop loop;
     uv::async async;
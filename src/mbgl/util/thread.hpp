@@ -4,6 +4,7 @@
 #include <future>
 #include <thread>
 #include <functional>
+#include <memory>
 
 #include <mbgl/util/run_loop.hpp>
 
@@ -29,7 +30,8 @@ namespace util {
 
 // Upon creation of this object, it launches a thread, creates an object of type Object in that
 // thread, and then calls .start(); on that object. When the Thread<> object is destructed, the
-// Object's .stop() function is called, and the destructor waits for thread termination. The
+// Object is destroyed in its thread while the loop still runs, so that the handles it closes are
+// closed before the loop is, and the destructor waits for thread termination. The
 // Thread<> constructor blocks until the thread and the Object are fully created, so after the
 // object creation, it's safe to obtain the Object stored in this thread.
 
@@ -43,13 +45,13 @@ public:
     // Invoke object->fn(args...) in the runloop thread.
     template <typename Fn, class... Args>
     void invoke(Fn fn, Args&&... args) {
-        loop->invoke(std::bind(fn, object, args...));
+        loop->invoke(std::bind(fn, object.get(), args...));
     }
 
     // Invoke object->fn(args...) in the runloop thread, then invoke callback(result) in the current thread.
     template <typename Fn, class R, class... Args>
     void invokeWithResult(Fn fn, std::function<void (R)> callback, Args&&... args) {
-        loop->invokeWithResult(std::bind(fn, object, args...), callback);
+        loop->invokeWithResult(std::bind(fn, object.get(), args...), callback);
     }
 
     uv_loop_t* get() { return loop->get(); }
@@ -68,7 +70,7 @@ private:
 
     std::thread thread;
 
-    Object* object;
+    std::unique_ptr<Object> object;
     RunLoop* loop;
 };
 
@@ -96,12 +98,12 @@ Thread<Object>::Thread(const std::string& name, Args&&... args) {
 template <class Object>
 template <typename P, std::size_t... I>
 void Thread<Object>::run(P&& params, index_sequence<I...>) {
-    Object object_(std::get<I>(std::forward<P>(params))...);
-    object = &object_;
-
+    // The loop outlives the object, so that the object can close the handles it started on it.
     RunLoop loop_;
     loop = &loop_;
 
+    object = util::make_unique<Object>(std::get<I>(std::forward<P>(params))...);
+
     running.set_value();
     loop_.run();
 
@@ -110,6 +112,8 @@ void Thread<Object>::run(P&& params, index_sequence<I...>) {
 
 template <class Object>
 Thread<Object>::~Thread() {
+    // The loop runs the close callbacks of the handles the object closed before it stops.
+    loop->invoke([this] { object.reset(); });
     loop->stop();
     joinable.set_value();
     thread.join();
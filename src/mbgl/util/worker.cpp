@@ -1,71 +1,678 @@
 #include <mbgl/util/worker.hpp>
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/uv_detail.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace mbgl {
 
-Worker::Worker(uv_loop_t* loop, std::size_t count)
-    : queue(new Queue(loop, [this](Fn after) { afterWork(after); }))
+std::atomic<unsigned> WorkRequest::generation(0);
+
+WorkRequest::WorkRequest(Fn work_, Fn after_, double priority_)
+    : work(std::move(work_)), after(std::move(after_)), priority(priority_), canceled(false) {
+}
+
+void WorkRequest::setPriority(double priority_) {
+    if (priority.exchange(priority_) != priority_) {
+        generation++;
+    }
+}
+
+double WorkRequest::getPriority() const {
+    return priority;
+}
+
+void WorkRequest::cancel() {
+    if (!canceled.exchange(true)) {
+        generation++;
+    }
+}
+
+bool WorkRequest::isCanceled() const {
+    return canceled;
+}
+
+namespace {
+
+// Completions are sent to the loop in batches, once a thread ran out of work or has held on to
+// them for long enough.
+const std::size_t maxBatchSize = 32;
+const Duration maxBatchDelay = std::chrono::milliseconds(4);
+
+// Threads refill their queue with a few requests of one Worker at a time, so that Workers take
+// turns often.
+const std::size_t refillSize = 4;
+
+bool take(std::atomic<std::size_t>& counter) {
+    std::size_t value = counter;
+    while (value && !counter.compare_exchange_weak(value, value - 1)) {}
+    return value;
+}
+
+// The pool that the calling thread belongs to.
+uv::tls<WorkerPool> currentPool;
+
+#if defined(__linux__)
+// The CPUs that the calling thread may run on, as restricted with taskset or cgroups.
+std::vector<int> allowedCPUs() {
+    std::vector<int> result;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                result.push_back(cpu);
+            }
+        }
+    }
+    return result;
+}
+#endif
+
+// Canceled requests come first, so that what they captured is released early.
+double effectivePriority(const WorkRequest& request) {
+    return request.isCanceled() ? -std::numeric_limits<double>::infinity() : request.getPriority();
+}
+
+}
+
+bool WorkerPool::Heap::later(const Entry& a, const Entry& b) {
+    return a.priority > b.priority;
+}
+
+void WorkerPool::Heap::push(Entry entry) {
+    entry.priority = effectivePriority(*entry.request);
+    entries.push_back(std::move(entry));
+    std::push_heap(entries.begin(), entries.end(), later);
+}
+
+void WorkerPool::Heap::reorder() {
+    const unsigned current = WorkRequest::generation;
+    if (generation != current) {
+        generation = current;
+        for (auto& entry : entries) {
+            entry.priority = effectivePriority(*entry.request);
+        }
+        std::make_heap(entries.begin(), entries.end(), later);
+    }
+}
+
+const WorkerPool::Entry& WorkerPool::Heap::top() {
+    assert(!entries.empty());
+    reorder();
+    return entries.front();
+}
+
+WorkerPool::Entry WorkerPool::Heap::pop() {
+    assert(!entries.empty());
+    reorder();
+
+    std::pop_heap(entries.begin(), entries.end(), later);
+    Entry entry = std::move(entries.back());
+    entries.pop_back();
+    return entry;
+}
+
+WorkerPool::Client::Client(Queue* queue_) : queue(queue_) {
+}
+
+WorkerPool::WorkerPool(std::size_t count_, bool pinned)
+    : slots(std::make_shared<const Slots>()),
+      clients(std::make_shared<const Clients>())
 {
-    queue->unref();
+#if defined(__linux__)
+    if (pinned) {
+        cpus = allowedCPUs();
+    }
+#else
+    (void)pinned;
+#endif
 
-    for (std::size_t i = 0; i < count; i++) {
-        threads.emplace_back(&Worker::workLoop, this);
+    setThreadCount(count_);
+}
+
+WorkerPool::~WorkerPool() {
+    // Workers hold on to their pool, so all of them were detached already.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminating = true;
+        condition.notify_all();
+    }
+
+    for (auto& slot : owned) {
+        slot->thread.join();
     }
 }
 
-Worker::~Worker() {
-    MBGL_VERIFY_THREAD(tid);
+std::shared_ptr<WorkerPool> WorkerPool::shared() {
+    static std::mutex mutex;
+    static std::weak_ptr<WorkerPool> instance;
 
-    if (active++ == 0) {
-        queue->ref();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto pool = instance.lock();
+    if (!pool) {
+        pool = std::make_shared<WorkerPool>(0);
+        instance = pool;
+    }
+    return pool;
+}
+
+std::size_t WorkerPool::defaultThreadCount() {
+    const std::size_t hardware = std::thread::hardware_concurrency();
+    return hardware ? hardware : 4;
+}
+
+void WorkerPool::setThreadCount(std::size_t count_) {
+    std::lock_guard<std::mutex> resizeLock(resizeMutex);
+
+    if (!count_) {
+        count_ = defaultThreadCount();
     }
 
-    channel.send(Work());
+    // Threads that were asked to leave but didn't yet may stay.
+    for (; count < count_ && take(retiring); count++) {}
 
-    for (auto& thread : threads) {
-        thread.join();
+    if (count > count_) {
+        std::lock_guard<std::mutex> lock(mutex);
+        retiring += count - count_;
+        count = count_;
+        condition.notify_all();
     }
 
-    queue->stop();
+    if (count < count_) {
+        for (; count < count_; count++) {
+            auto slot = std::make_shared<Slot>();
+            slot->thread = std::thread(&WorkerPool::workLoop, this, slot, nextIndex++);
+            owned.push_back(std::move(slot));
+        }
+        std::atomic_store(&slots, std::make_shared<const Slots>(owned));
+    }
+
+    reap();
 }
 
-void Worker::send(Fn work, Fn after) {
-    MBGL_VERIFY_THREAD(tid);
-    assert(work);
+std::size_t WorkerPool::getThreadCount() const {
+    std::lock_guard<std::mutex> resizeLock(resizeMutex);
+    return count;
+}
 
-    if (active++ == 0) {
-        queue->ref();
+void WorkerPool::attach(std::shared_ptr<Client> client) {
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    auto next = std::make_shared<Clients>(*std::atomic_load(&clients));
+    next->push_back(std::move(client));
+    std::atomic_store(&clients, std::shared_ptr<const Clients>(std::move(next)));
+}
+
+void WorkerPool::send(Client& client, std::shared_ptr<WorkRequest> request) {
+    inject(client, std::move(request));
+    client.queued++;
+    queued++;
+
+    // Sleeping threads recheck `queued` with the mutex locked before they wait, so they either
+    // see the new request or are woken up here.
+    if (sleeping) {
+        std::lock_guard<std::mutex> lock(mutex);
+        condition.notify_one();
+    }
+}
+
+void WorkerPool::inject(Client& client, std::shared_ptr<WorkRequest> request) {
+    auto node = new Injected { std::move(request), client.injected.load() };
+    while (!client.injected.compare_exchange_weak(node->next, node)) {}
+}
+
+std::vector<std::shared_ptr<WorkRequest>> WorkerPool::detach(const std::shared_ptr<Client>& client) {
+    std::vector<std::shared_ptr<WorkRequest>> dropped;
+
+    // From now on, no thread moves the client's requests to its queue.
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->detached = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        auto next = std::make_shared<Clients>(*std::atomic_load(&clients));
+        next->erase(std::remove(next->begin(), next->end(), client), next->end());
+        std::atomic_store(&clients, std::shared_ptr<const Clients>(std::move(next)));
+    }
+
+    // Take back what threads already moved to their queues, and the completions they hold on
+    // to. Threads send the completions of requests that finish from now on right away.
+    std::vector<Fn> completions;
+    for (const auto& slot : *std::atomic_load(&slots)) {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        auto batch = slot->batches.find(client.get());
+        if (batch != slot->batches.end()) {
+            for (auto& completion : batch->second.completions) {
+                completions.push_back(std::move(completion));
+            }
+            slot->batches.erase(batch);
+        }
+
+        auto& entries = slot->heap.entries;
+        const auto end = std::partition(entries.begin(), entries.end(), [&](const Entry& entry) {
+            return entry.client != client.get();
+        });
+        if (end != entries.end()) {
+            for (auto it = end; it != entries.end(); ++it) {
+                dropped.push_back(std::move(it->request));
+            }
+            entries.erase(end, entries.end());
+            std::make_heap(entries.begin(), entries.end(), Heap::later);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(client->mutex);
+
+        Injected* node = client->injected.exchange(nullptr);
+        while (node) {
+            std::unique_ptr<Injected> current(node);
+            dropped.push_back(std::move(node->request));
+            node = node->next;
+        }
+        for (auto& entry : client->heap.entries) {
+            dropped.push_back(std::move(entry.request));
+        }
+        client->heap.entries.clear();
+
+        client->queued -= dropped.size();
+        queued -= dropped.size();
+        client->running -= completions.size();
+
+        client->condition.wait(lock, [&] { return client->running == 0; });
+    }
+
+    return dropped;
+}
+
+WorkerPool::Entry WorkerPool::pop(Slot& slot) {
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    if (slot.heap.entries.empty()) {
+        return { 0, nullptr, nullptr };
+    }
+
+    // Counted while the slot is locked, so that a detaching client either takes the request
+    // back or waits for it.
+    Entry entry = slot.heap.pop();
+    entry.client->running++;
+    return entry;
+}
+
+bool WorkerPool::refill(Slot& slot) {
+    const auto snapshot = std::atomic_load(&clients);
+    const std::size_t size = snapshot->size();
+    const std::size_t start = turn++;
+
+    for (std::size_t i = 0; i < size; i++) {
+        Client& client = *(*snapshot)[(start + i) % size];
+        if (!client.queued) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(client.mutex);
+        if (client.detached) {
+            continue;
+        }
+
+        Injected* node = client.injected.exchange(nullptr);
+        while (node) {
+            std::unique_ptr<Injected> current(node);
+            client.heap.push({ 0, std::move(node->request), &client });
+            node = node->next;
+        }
+
+        if (client.heap.entries.empty()) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> slotLock(slot.mutex);
+        if (!slot.heap.entries.empty() && !Heap::later(slot.heap.top(), client.heap.top())) {
+            continue;
+        }
+        for (std::size_t n = 0; n < refillSize && !client.heap.entries.empty(); n++) {
+            slot.heap.push(client.heap.pop());
+        }
+        return true;
     }
 
-    channel.send({work, after});
+    return false;
+}
+
+WorkerPool::Entry WorkerPool::next(Slot& slot) {
+    // Work that was sent after the slot was filled may go before what the slot holds.
+    refill(slot);
+    Entry entry = pop(slot);
+
+    if (!entry.request) {
+        const auto snapshot = std::atomic_load(&slots);
+        const std::size_t size = snapshot->size();
+        const std::size_t offset = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (std::size_t i = 0; i < size && !entry.request; i++) {
+            Slot& victim = *(*snapshot)[(offset + i) % size];
+            if (&victim != &slot) {
+                entry = pop(victim);
+            }
+        }
+    }
+
+    if (entry.request) {
+        entry.client->queued--;
+        queued--;
+    }
+    return entry;
+}
+
+void WorkerPool::Group::run() {
+    const std::size_t size = tasks.size();
+    for (std::size_t i; (i = next++) < size;) {
+        try {
+            tasks[i]();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        if (++done == size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_all();
+        }
+    }
+}
+
+void WorkerPool::parallel(std::vector<Fn> tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+
+    auto group = std::make_shared<Group>();
+    group->tasks = std::move(tasks);
+
+    WorkerPool* pool = currentPool.get();
+    if (pool && group->tasks.size() > 1) {
+        pool->offer(group);
+    }
+
+    // The calling thread doesn't wait for others to start: it runs tasks itself until none are
+    // left, and then waits for those that other threads are still running.
+    group->run();
+    {
+        std::unique_lock<std::mutex> lock(group->mutex);
+        group->condition.wait(lock, [&] { return group->done == group->tasks.size(); });
+    }
+
+    if (pool && group->tasks.size() > 1) {
+        pool->withdraw(group);
+    }
+
+    if (group->error) {
+        std::rethrow_exception(group->error);
+    }
 }
 
-void Worker::workLoop() {
+void WorkerPool::offer(const std::shared_ptr<Group>& group) {
+    {
+        std::lock_guard<std::mutex> lock(groupsMutex);
+        groups.push_back(group);
+        offered++;
+    }
+
+    offers++;
+    if (sleeping) {
+        std::lock_guard<std::mutex> lock(mutex);
+        condition.notify_all();
+    }
+}
+
+void WorkerPool::withdraw(const std::shared_ptr<Group>& group) {
+    std::lock_guard<std::mutex> lock(groupsMutex);
+    groups.erase(std::remove(groups.begin(), groups.end(), group), groups.end());
+    offered--;
+}
+
+bool WorkerPool::help() {
+    std::shared_ptr<Group> group;
+    {
+        std::lock_guard<std::mutex> lock(groupsMutex);
+        for (const auto& candidate : groups) {
+            if (candidate->next < candidate->tasks.size()) {
+                group = candidate;
+                break;
+            }
+        }
+    }
+
+    if (!group) {
+        return false;
+    }
+
+    group->run();
+    return true;
+}
+
+void WorkerPool::complete(Client& client, std::vector<Fn>&& batch) {
+    const std::size_t size = batch.size();
+    client.queue->send(std::move(batch));
+
+    // The client may be gone once the lock is released.
+    std::lock_guard<std::mutex> lock(client.mutex);
+    client.running -= size;
+    client.condition.notify_all();
+}
+
+void WorkerPool::workLoop(std::shared_ptr<Slot> slot, std::size_t index) {
 #ifdef __APPLE__
     pthread_setname_np("Worker");
 #endif
 
-    while (true) {
-        Work item = channel.receive();
+#if defined(__linux__)
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[index % cpus.size()], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#else
+    (void)index;
+#endif
+
+    currentPool.set(this);
+
+    // How long the last request took on this thread, as an estimate for the next one.
+    Duration lastDuration = Duration::zero();
 
-        if (!item.work)
+    // Sends the batches that are full, or that would be held for too long while running work
+    // that takes as long as the given duration.
+    const auto flush = [&](bool all, Duration ahead) {
+        std::vector<std::pair<Client*, std::vector<Fn>>> ready;
+        {
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            const TimePoint now = Clock::now() + ahead;
+            for (auto it = slot->batches.begin(); it != slot->batches.end();) {
+                Batch& batch = it->second;
+                if (all || batch.completions.size() >= maxBatchSize || now - batch.start >= maxBatchDelay) {
+                    ready.emplace_back(it->first, std::move(batch.completions));
+                    it = slot->batches.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& pair : ready) {
+            complete(*pair.first, std::move(pair.second));
+        }
+    };
+
+    while (true) {
+        if (terminating) {
             break;
+        }
+
+        if (take(retiring)) {
+            flush(true, Duration::zero());
 
-        item.work();
-        queue->send(std::move(item.after));
+            // Hand the queued work back to the clients, for the remaining threads.
+            std::lock_guard<std::mutex> lock(mutex);
+            std::lock_guard<std::mutex> slotLock(slot->mutex);
+            for (auto& entry : slot->heap.entries) {
+                inject(*entry.client, std::move(entry.request));
+            }
+            slot->heap.entries.clear();
+            retired.push_back(std::this_thread::get_id());
+            condition.notify_all();
+            return;
+        }
+
+        // Tasks of a request that is already running come before new requests.
+        const unsigned seen = offers;
+        if (offered) {
+            flush(false, lastDuration);
+            if (help()) {
+                continue;
+            }
+        }
+
+        Entry entry = next(*slot);
+
+        if (!entry.request) {
+            flush(true, Duration::zero());
+
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping++;
+            condition.wait(lock, [&] { return terminating || retiring || queued || offers != seen; });
+            sleeping--;
+            continue;
+        }
+
+        std::shared_ptr<WorkRequest> request = std::move(entry.request);
+        if (!request->isCanceled()) {
+            // Completions don't wait for the request to finish if it takes too long.
+            flush(false, lastDuration);
+
+            const TimePoint start = Clock::now();
+            request->work();
+            lastDuration = Clock::now() - start;
+        }
+
+        // Hand the last reference to the request over to the loop, so that the callbacks and
+        // everything they captured are destroyed there.
+        bool detached = false;
+        {
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            detached = entry.client->detached;
+            auto inserted = slot->batches.emplace(entry.client, Batch());
+            Batch& batch = inserted.first->second;
+            if (inserted.second) {
+                batch.start = Clock::now();
+            }
+            batch.completions.emplace_back([request] {
+                if (!request->isCanceled() && request->after) {
+                    request->after();
+                }
+            });
+        }
+        request.reset();
+
+        // A detaching client waits for the completion, so it isn't batched. Once the slot is
+        // unlocked, the client may take the completion back and be gone.
+        flush(detached, Duration::zero());
+    }
+}
+
+void WorkerPool::reap() {
+    std::vector<std::thread::id> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ids.swap(retired);
+    }
+
+    if (ids.empty()) {
+        return;
+    }
+
+    for (const auto& id : ids) {
+        auto it = std::find_if(owned.begin(), owned.end(), [&](const std::shared_ptr<Slot>& slot) {
+            return slot->thread.get_id() == id;
+        });
+        assert(it != owned.end());
+        (*it)->thread.join();
+        owned.erase(it);
+    }
+
+    std::atomic_store(&slots, std::make_shared<const Slots>(owned));
+}
+
+Worker::Worker(uv_loop_t* loop, std::size_t count, bool pinned)
+    : Worker(loop, std::make_shared<WorkerPool>(count, pinned)) {
+}
+
+Worker::Worker(uv_loop_t* loop, std::shared_ptr<WorkerPool> pool_)
+    : queue(new Queue(loop, [this](std::vector<Fn>& batch) { afterWork(batch); })),
+      pool(std::move(pool_)),
+      client(std::make_shared<WorkerPool::Client>(queue))
+{
+    queue->unref();
+    pool->attach(client);
+}
+
+Worker::~Worker() {
+    MBGL_VERIFY_THREAD(tid);
+
+    if (active++ == 0) {
+        queue->ref();
+    }
+
+    // Drop the work that didn't start yet.
+    pool->detach(client);
+
+    queue->stop();
+}
+
+std::size_t Worker::defaultThreadCount() {
+    return WorkerPool::defaultThreadCount();
+}
+
+void Worker::setThreadCount(std::size_t count) {
+    pool->setThreadCount(count);
+}
+
+std::size_t Worker::getThreadCount() const {
+    return pool->getThreadCount();
+}
+
+std::shared_ptr<WorkRequest> Worker::send(Fn work, Fn after, double priority) {
+    MBGL_VERIFY_THREAD(tid);
+    assert(work);
+
+    if (active++ == 0) {
+        queue->ref();
     }
 
-    // Make sure to close all other workers too.
-    channel.send(Work());
+    auto request = std::make_shared<WorkRequest>(std::move(work), std::move(after), priority);
+    pool->send(*client, request);
+    return request;
 }
 
-void Worker::afterWork(Fn after) {
-    if (after) {
+void Worker::afterWork(std::vector<Fn>& batch) {
+    for (auto& after : batch) {
         after();
     }
 
-    if (--active == 0) {
+    active -= batch.size();
+    batch.clear();
+
+    if (active == 0) {
         queue->unref();
     }
 }
@@ -3,38 +3,274 @@
 
 #include <mbgl/util/noncopyable.hpp>
 #include <mbgl/util/async_queue.hpp>
-#include <mbgl/util/channel.hpp>
 #include <mbgl/util/util.hpp>
+#include <mbgl/util/chrono.hpp>
 
-#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace mbgl {
 
-class Worker : public mbgl::util::noncopyable {
+// Work that was sent to a Worker. While it is still queued, its priority can be changed and it
+// can be canceled. Canceled work doesn't run, and neither does its after callback.
+class WorkRequest : private util::noncopyable {
 public:
     using Fn = std::function<void ()>;
 
-    Worker(uv_loop_t* loop, std::size_t count);
-    ~Worker();
+    WorkRequest(Fn work, Fn after, double priority);
+
+    // Lower priorities run first.
+    void setPriority(double);
+    double getPriority() const;
 
-    void send(Fn work, Fn after);
+    void cancel();
+    bool isCanceled() const;
 
 private:
-    void workLoop();
-    void afterWork(Fn after);
+    friend class Worker;
+    friend class WorkerPool;
+
+    // Bumped whenever a queued request changes, so that workers know when to reorder.
+    static std::atomic<unsigned> generation;
+
+    Fn work;
+    Fn after;
+    std::atomic<double> priority;
+    std::atomic<bool> canceled;
+};
+
+// The threads that run the work of one or more Workers. Threads take turns between the Workers
+// that have queued work, so that a busy Worker can't starve the others.
+class WorkerPool : public mbgl::util::noncopyable {
+public:
+    // A count of 0 starts one thread per hardware thread. When pinned, each thread only runs on
+    // one of the CPUs that the calling thread may run on, in turn, on platforms that support it.
+    WorkerPool(std::size_t count, bool pinned = false);
+    ~WorkerPool();
+
+    // The pool shared by all Workers of the process that ask for it. It is created with one
+    // thread per hardware thread, and destroyed once the last Worker using it is.
+    static std::shared_ptr<WorkerPool> shared();
+
+    // Grows or shrinks the pool. Threads leave the pool once they are done with the work they
+    // are currently running. Can be called from any thread.
+    void setThreadCount(std::size_t count);
+    std::size_t getThreadCount() const;
+
+    // The number of hardware threads, or 4 when it can't be determined.
+    static std::size_t defaultThreadCount();
+
+    using Fn = std::function<void ()>;
+
+    // Runs the tasks and returns once all of them ran. When called from work running on a pool,
+    // idle threads of that pool help with the tasks; otherwise they run one after the other.
+    // The first exception thrown by a task is rethrown once all tasks are done.
+    static void parallel(std::vector<Fn> tasks);
+
+private:
+    friend class Worker;
+    using Queue = util::AsyncQueue<std::vector<Fn>>;
+
+    struct Client;
 
-    struct Work {
-        Fn work;
-        Fn after;
+    // Queues are heaps ordered by the priority the requests had when they were queued, and are
+    // reordered once any request changed. Canceled requests come first.
+    struct Entry {
+        double priority;
+        std::shared_ptr<WorkRequest> request;
+        Client* client;
     };
 
-    using Queue = util::AsyncQueue<std::function<void ()>>;
+    struct Heap {
+        std::vector<Entry> entries;
+        unsigned generation = 0;
+
+        void push(Entry);
+        Entry pop();
+        const Entry& top();
+        static bool later(const Entry&, const Entry&);
+
+    private:
+        void reorder();
+    };
+
+    // A lock-free stack that a Worker pushes to and threads take as a whole.
+    struct Injected {
+        std::shared_ptr<WorkRequest> request;
+        Injected* next;
+    };
+
+    // The queue of a Worker. Threads refill their own queue from the Workers in turn.
+    struct Client {
+        Client(Queue* queue);
+
+        // Where completed work is sent to.
+        Queue* const queue;
+
+        std::atomic<Injected*> injected { nullptr };
+
+        // Requests that were sent but didn't start yet.
+        std::atomic<std::size_t> queued { 0 };
+
+        // Requests that were taken from the queues, but whose completions weren't sent yet.
+        std::atomic<std::size_t> running { 0 };
+
+        // Guards everything below, and waiting for running requests.
+        std::mutex mutex;
+        std::condition_variable condition;
+        Heap heap;
+        std::atomic<bool> detached { false };
+    };
+
+    // Completions of one Worker, which are sent to its loop together.
+    struct Batch {
+        std::vector<Fn> completions;
+        TimePoint start;
+    };
+
+    // Every thread owns a queue that it takes its work from. Threads refill their queue from the
+    // Workers, and steal from the other threads' queues when all of them are empty. Completions
+    // are batched per Worker, as they go to different loops.
+    struct Slot {
+        std::mutex mutex;
+        Heap heap;
+        std::unordered_map<Client*, Batch> batches;
+        std::thread thread;
+    };
+
+    // The tasks of a parallel() call. Whoever runs them claims them one at a time.
+    struct Group {
+        std::vector<Fn> tasks;
+        std::atomic<std::size_t> next { 0 };
+        std::atomic<std::size_t> done { 0 };
+
+        // Guards everything below, and waiting for the tasks to be done.
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::exception_ptr error;
+
+        void run();
+    };
+
+    using Slots = std::vector<std::shared_ptr<Slot>>;
+    using Clients = std::vector<std::shared_ptr<Client>>;
+
+    // Called by Workers.
+    void attach(std::shared_ptr<Client>);
+    void send(Client&, std::shared_ptr<WorkRequest>);
+
+    // Removes the client and waits until its running requests are done. Returns the requests
+    // that didn't run, so that they are destroyed in the caller's thread, and drops the
+    // completions that weren't sent yet.
+    std::vector<std::shared_ptr<WorkRequest>> detach(const std::shared_ptr<Client>&);
+
+    static void inject(Client&, std::shared_ptr<WorkRequest>);
+
+    void workLoop(std::shared_ptr<Slot> slot, std::size_t index);
+
+    // Returns the next request for the thread owning the slot: from its own queue, unless a
+    // Worker has more urgent work, then from the Workers in turn and finally from other threads.
+    // Returns an empty entry if there is no work.
+    Entry next(Slot&);
+    Entry pop(Slot&);
+
+    // Moves requests of the next Worker in turn to the slot, if its queue is empty or the Worker's
+    // most urgent request goes before the slot's.
+    bool refill(Slot&);
+
+    // Lets idle threads help with the group's tasks until it is withdrawn.
+    void offer(const std::shared_ptr<Group>&);
+    void withdraw(const std::shared_ptr<Group>&);
+
+    // Runs tasks of an offered group, if any are left.
+    bool help();
+
+    // Sends completions and lets detaching clients know.
+    static void complete(Client&, std::vector<Fn>&&);
+
+    // Joins the threads that left the pool. Must be called with resizeMutex locked.
+    void reap();
+
+    // The CPUs that threads are pinned to, in turn. Empty when they aren't pinned.
+    std::vector<int> cpus;
+
+    // Guards resizing.
+    mutable std::mutex resizeMutex;
+    std::size_t count = 0;
+    std::size_t nextIndex = 0;
+    Slots owned;
+
+    // Threads read these snapshots, which are replaced with std::atomic_store whenever a thread
+    // or client comes or goes.
+    std::shared_ptr<const Slots> slots;
+    std::shared_ptr<const Clients> clients;
+    std::mutex clientsMutex;
+
+    // The client that the next refill starts with.
+    std::atomic<std::size_t> turn { 0 };
+
+    // Requests of all clients that were sent but didn't start yet.
+    std::atomic<std::size_t> queued { 0 };
+
+    std::mutex groupsMutex;
+    std::vector<std::shared_ptr<Group>> groups;
+    std::atomic<std::size_t> offered { 0 };
+
+    // Bumped for every offered group, so that threads know when to look for tasks.
+    std::atomic<unsigned> offers { 0 };
+
+    // Threads that wait for work. Workers only take the mutex to wake them.
+    std::atomic<std::size_t> sleeping { 0 };
+    std::atomic<std::size_t> retiring { 0 };
+    std::atomic<bool> terminating { false };
+
+    // Guards everything below, and waiting on the condition.
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::thread::id> retired;
+};
+
+class Worker : public mbgl::util::noncopyable {
+public:
+    using Fn = std::function<void ()>;
+
+    // Runs the work on a pool of its own. A count of 0 starts one thread per hardware thread.
+    Worker(uv_loop_t* loop, std::size_t count, bool pinned = false);
+
+    // Runs the work on a pool that may be shared with other Workers.
+    Worker(uv_loop_t* loop, std::shared_ptr<WorkerPool> pool);
+
+    ~Worker();
+
+    // Queues the work, which runs on one of the pool's threads. Every thread runs the queued
+    // work it holds with the lowest priority first. The after callback runs in the loop once the
+    // work is done. The request owns both callbacks, so callers that keep it around should only
+    // hold a weak reference.
+    std::shared_ptr<WorkRequest> send(Fn work, Fn after, double priority = 0);
+
+    // Resizes the pool, which affects all Workers sharing it.
+    void setThreadCount(std::size_t count);
+    std::size_t getThreadCount() const;
+
+    static std::size_t defaultThreadCount();
+
+private:
+    void afterWork(std::vector<Fn>& batch);
+
+    using Queue = WorkerPool::Queue;
 
     std::size_t active = 0;
     Queue* queue = nullptr;
-    Channel<Work> channel;
-    std::vector<std::thread> threads;
+
+    const std::shared_ptr<WorkerPool> pool;
+    std::shared_ptr<WorkerPool::Client> client;
 
     MBGL_STORE_THREAD(tid)
 };
@@ -0,0 +1,39 @@
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> count(0);
+std::atomic<std::size_t> bytes(0);
+
+}
+
+void* operator new(std::size_t size) {
+    count++;
+    bytes += size;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+namespace mbgl {
+namespace bench {
+
+std::size_t allocations() {
+    return count;
+}
+
+std::size_t allocatedBytes() {
+    return bytes;
+}
+
+}
+}
@@ -0,0 +1,19 @@
+#ifndef MBGL_BENCH_ALLOCATIONS
+#define MBGL_BENCH_ALLOCATIONS
+
+#include <cstddef>
+
+namespace mbgl {
+namespace bench {
+
+// Returns the number of calls to the global operator new made so far. The bench executable
+// replaces operator new to count them; this is not available in the library or the tests.
+std::size_t allocations();
+
+// Returns the number of bytes requested from the global operator new so far.
+std::size_t allocatedBytes();
+
+}
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/platform/platform.hpp>
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/io.hpp>
+
+#include <sqlite3.h>
+#include <unistd.h>
+#include <uv.h>
+#include <zlib.h>
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace mbgl;
+
+namespace {
+
+const char* const mbtilesRoot = "test/fixtures/bench";
+const char* const mbtilesPath = "test/fixtures/bench/streets.mbtiles";
+
+// All tiles of zoom level 3 are loaded at once, and again for each round.
+const int32_t zoom = 3;
+const int rounds = 10;
+
+std::string gzip(const std::string& raw) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+
+    std::string result(deflateBound(&stream, uLong(raw.size())) + 32, '\0');
+    stream.next_in = (Bytef *)raw.data();
+    stream.avail_in = uInt(raw.size());
+    stream.next_out = (Bytef *)&result[0];
+    stream.avail_out = uInt(result.size());
+    deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result;
+}
+
+// Stores the tile at all coordinates of the zoom level.
+void createMBTiles(const std::string& tile) {
+    unlink(mbtilesPath);
+
+    sqlite3* db = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(mbtilesPath, &db));
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(db,
+        "CREATE TABLE tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB);"
+        "CREATE UNIQUE INDEX tile_index ON tiles (zoom_level, tile_column, tile_row);"
+        "BEGIN", nullptr, nullptr, nullptr));
+
+    sqlite3_stmt* stmt = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_prepare_v2(db, "INSERT INTO tiles VALUES (?, ?, ?, ?)", -1, &stmt, nullptr));
+    for (int32_t x = 0; x < (1 << zoom); x++) {
+        for (int32_t y = 0; y < (1 << zoom); y++) {
+            sqlite3_bind_int(stmt, 1, zoom);
+            sqlite3_bind_int(stmt, 2, x);
+            sqlite3_bind_int(stmt, 3, y);
+            sqlite3_bind_blob(stmt, 4, tile.data(), int(tile.size()), SQLITE_STATIC);
+            ASSERT_EQ(SQLITE_DONE, sqlite3_step(stmt));
+            sqlite3_reset(stmt);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr));
+    sqlite3_close(db);
+}
+
+void load(const std::string& name, const std::string& urlPrefix) {
+    DefaultFileSource fs(nullptr, mbtilesRoot);
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    std::size_t bytes = 0;
+    std::size_t failed = 0;
+    const auto start = Clock::now();
+
+    for (int round = 0; round < rounds; round++) {
+        for (int32_t x = 0; x < (1 << zoom); x++) {
+            for (int32_t y = 0; y < (1 << zoom); y++) {
+                std::ostringstream url;
+                url << urlPrefix << zoom << "/" << x << "/" << y;
+                fs.request({ Resource::Tile, url.str() }, uv_default_loop(), env, [&](const Response &res) {
+                    if (res.status == Response::Successful) {
+                        bytes += res.data->size();
+                    } else {
+                        failed++;
+                    }
+                });
+            }
+        }
+        uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    const double seconds = elapsed.count() / 1e9;
+    const std::size_t tiles = rounds << (2 * zoom);
+
+    EXPECT_EQ(0u, failed);
+    std::cout << name << ": " << std::fixed << std::setprecision(2)
+              << tiles / seconds << " tiles/s, "
+              << bytes / seconds / 1e6 << " MB/s, "
+              << seconds * 1e6 / tiles << " us per tile" << std::endl;
+}
+
+}
+
+TEST(FileSource, Throughput) {
+    const std::string tile = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+
+    const auto server = platform::applicationRoot() + "/TEST_DATA/storage/server.js";
+    const pid_t pid = test::startServer(server.c_str());
+
+    // The test server sends the same tile for all coordinates.
+    load("curl", "http://127.0.0.1:3000/bench/tiles/");
+
+    createMBTiles(tile);
+    load("mbtiles", "mbtiles://streets.mbtiles/");
+
+    createMBTiles(gzip(tile));
+    load("mbtiles (gzip)", "mbtiles://streets.mbtiles/");
+
+    unlink(mbtilesPath);
+    test::stopServer(pid);
+}
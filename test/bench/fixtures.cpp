@@ -0,0 +1,26 @@
+#include "fixtures.hpp"
+
+#include <algorithm>
+
+#include <dirent.h>
+
+namespace mbgl {
+namespace bench {
+
+std::vector<std::string> tileFixtures(const std::string& directory) {
+    std::vector<std::string> files;
+    if (DIR* dir = opendir(directory.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".pbf") == 0) {
+                files.push_back(directory + "/" + name);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+}
+}
@@ -0,0 +1,16 @@
+#ifndef MBGL_BENCH_FIXTURES
+#define MBGL_BENCH_FIXTURES
+
+#include <string>
+#include <vector>
+
+namespace mbgl {
+namespace bench {
+
+// Returns the paths of all .pbf tiles in the given fixture directory.
+std::vector<std::string> tileFixtures(const std::string& directory);
+
+}
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/io.hpp>
+#include <mbgl/util/pbf.hpp>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace mbgl;
+
+namespace {
+
+// Returns the packed geometry fields of all features in the tile.
+std::vector<pbf> geometries(const std::string& data) {
+    std::vector<pbf> result;
+    pbf tile_pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    while (tile_pbf.next(3)) {
+        pbf layer_pbf = tile_pbf.message();
+        while (layer_pbf.next(2)) {
+            pbf feature_pbf = layer_pbf.message();
+            while (feature_pbf.next(4)) {
+                // Keep the length prefix so that the packed decoder can read the field.
+                const uint8_t *start = feature_pbf.data;
+                feature_pbf.skip();
+                result.emplace_back(start, feature_pbf.data - start);
+            }
+        }
+    }
+    return result;
+}
+
+template <typename Fn>
+void measure(const char* name, std::size_t varints, int iterations, Fn fn) {
+    uint64_t sum = 0;
+    const auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sum += fn();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    std::cout << std::setw(10) << name << ": " << std::fixed << std::setprecision(2)
+              << double(elapsed.count()) / (double(varints) * iterations) << " ns per varint"
+              << " (checksum " << sum / iterations << ")" << std::endl;
+}
+
+}
+
+TEST(PBF, GeometryVarints) {
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    const std::vector<pbf> fields = geometries(data);
+    ASSERT_FALSE(fields.empty());
+
+    std::size_t varints = 0;
+    for (pbf field : fields) {
+        pbf values = field.message();
+        while (values) {
+            values.varintChecked();
+            varints++;
+        }
+    }
+
+    const int iterations = 200;
+    std::cout << fields.size() << " geometries, " << varints << " varints" << std::endl;
+
+    measure("checked", varints, iterations, [&] {
+        uint64_t sum = 0;
+        for (pbf field : fields) {
+            pbf values = field.message();
+            while (values) {
+                sum += values.varintChecked();
+            }
+        }
+        return sum;
+    });
+
+    measure("varint", varints, iterations, [&] {
+        uint64_t sum = 0;
+        for (pbf field : fields) {
+            pbf values = field.message();
+            while (values) {
+                sum += values.varint();
+            }
+        }
+        return sum;
+    });
+
+    std::vector<uint32_t> buffer;
+    measure("packed", varints, iterations, [&] {
+        uint64_t sum = 0;
+        for (pbf field : fields) {
+            field.packedVarint(buffer);
+            for (uint32_t value : buffer) {
+                sum += value;
+            }
+        }
+        return sum;
+    });
+}
@@ -0,0 +1,180 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/mpsc_queue.hpp>
+#include <mbgl/util/run_loop.hpp>
+#include <mbgl/util/std.hpp>
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace mbgl;
+
+namespace {
+
+struct Message {
+    virtual void operator()() = 0;
+    virtual ~Message() = default;
+
+    Message* next = nullptr;
+};
+
+template <class F>
+struct Invoker : Message {
+    Invoker(F&& f) : func(std::move(f)) {}
+    void operator()() override { func(); }
+    F func;
+};
+
+// The queue RunLoop used before: a mutex guarded std::queue of messages, locked through a
+// std::function.
+class LockedQueue {
+public:
+    template <class Fn>
+    void push(Fn&& fn) {
+        auto invokable = util::make_unique<Invoker<Fn>>(std::move(fn));
+        withMutex([&] { queue.push(std::move(invokable)); });
+    }
+
+    std::size_t process() {
+        Queue queue_;
+        withMutex([&] { queue_.swap(queue); });
+
+        const std::size_t count = queue_.size();
+        while (!queue_.empty()) {
+            (*(queue_.front()))();
+            queue_.pop();
+        }
+        return count;
+    }
+
+private:
+    using Queue = std::queue<std::unique_ptr<Message>>;
+
+    void withMutex(std::function<void()>&& fn) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fn();
+    }
+
+    Queue queue;
+    std::mutex mutex;
+};
+
+class LockFreeQueue {
+public:
+    template <class Fn>
+    void push(Fn&& fn) {
+        queue.push(new Invoker<Fn>(std::move(fn)));
+    }
+
+    std::size_t process() {
+        std::size_t count = 0;
+        Message* message = queue.drain();
+        while (message) {
+            std::unique_ptr<Message> invoked(message);
+            message = message->next;
+            (*invoked)();
+            count++;
+        }
+        return count;
+    }
+
+private:
+    util::MPSCQueue<Message> queue;
+};
+
+// Producers send the messages while a single consumer runs them.
+template <class Queue>
+void stress(const std::string& name, std::size_t messages) {
+    for (std::size_t producers = 1; producers <= 8; producers *= 2) {
+        Queue queue;
+        std::size_t received = 0;
+
+        const auto start = Clock::now();
+
+        std::thread consumer([&] {
+            std::size_t processed = 0;
+            while (processed < messages) {
+                const std::size_t count = queue.process();
+                if (!count) {
+                    std::this_thread::yield();
+                }
+                processed += count;
+            }
+        });
+
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; p++) {
+            threads.emplace_back([&, p] {
+                for (std::size_t i = p; i < messages; i += producers) {
+                    queue.push([&received] { received++; });
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        consumer.join();
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        EXPECT_EQ(messages, received);
+
+        std::cout << name << ", " << producers << " producers: " << std::fixed
+                  << std::setprecision(2) << messages / (elapsed.count() / 1e9) / 1e6
+                  << "M messages/s" << std::endl;
+    }
+}
+
+}
+
+TEST(RunLoop, QueueThroughput) {
+    stress<LockedQueue>("mutex queue", 1000000);
+    stress<LockFreeQueue>("lock-free queue", 1000000);
+}
+
+// Includes waking up the loop, which only happens for the first message of every batch.
+TEST(RunLoop, InvokeThroughput) {
+    const std::size_t messages = 1000000;
+
+    for (std::size_t producers = 1; producers <= 8; producers *= 2) {
+        std::promise<util::RunLoop*> started;
+        std::size_t received = 0;
+
+        const auto start = Clock::now();
+
+        std::thread consumer([&] {
+            util::RunLoop loop;
+            started.set_value(&loop);
+            loop.run();
+        });
+        util::RunLoop* loop = started.get_future().get();
+
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; p++) {
+            threads.emplace_back([&, p] {
+                for (std::size_t i = p; i < messages; i += producers) {
+                    loop->invoke([&received] { received++; });
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        loop->stop();
+        consumer.join();
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        EXPECT_EQ(messages, received);
+
+        std::cout << "RunLoop::invoke, " << producers << " producers: " << std::fixed
+                  << std::setprecision(2) << messages / (elapsed.count() / 1e9) / 1e6
+                  << "M messages/s" << std::endl;
+    }
+}
@@ -0,0 +1,374 @@
+#include "../fixtures/util.hpp"
+#include "allocations.hpp"
+#include "fixtures.hpp"
+
+#include <mbgl/map/environment.hpp>
+#include <mbgl/map/source.hpp>
+#include <mbgl/map/sprite.hpp>
+#include <mbgl/map/vector_tile.hpp>
+#include <mbgl/map/vector_tile_data.hpp>
+#include <mbgl/geometry/glyph_atlas.hpp>
+#include <mbgl/geometry/sprite_atlas.hpp>
+#include <mbgl/storage/file_source.hpp>
+#include <mbgl/storage/response_cache.hpp>
+#include <mbgl/style/style.hpp>
+#include <mbgl/style/style_layer.hpp>
+#include <mbgl/text/glyph_store.hpp>
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/io.hpp>
+#include <mbgl/util/std.hpp>
+#include <mbgl/util/uv_detail.hpp>
+#include <mbgl/util/worker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace mbgl;
+
+namespace {
+
+void writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += char((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += char(value);
+}
+
+void writeVarint(std::string& out, uint32_t field, uint64_t value) {
+    writeVarint(out, field << 3);
+    writeVarint(out, value);
+}
+
+void writeSvarint(std::string& out, uint32_t field, int32_t value) {
+    writeVarint(out, field, uint32_t((value << 1) ^ (value >> 31)));
+}
+
+void writeMessage(std::string& out, uint32_t field, const std::string& message) {
+    writeVarint(out, (field << 3) | 2);
+    writeVarint(out, message.size());
+    out += message;
+}
+
+// Generates a glyph PBF for the range in a URL like ".../0-255.pbf". Every glyph has the
+// same metrics, which is enough to exercise shaping and placement.
+std::string glyphs(const std::string& url) {
+    const std::size_t slash = url.rfind('/');
+    const std::string range = url.substr(slash + 1, url.rfind(".pbf") - slash - 1);
+    const uint32_t first = std::stoul(range);
+    const uint32_t last = std::stoul(range.substr(range.find('-') + 1));
+
+    const uint32_t width = 10, height = 14, buffer = 3;
+
+    std::string fontstack;
+    writeMessage(fontstack, 1, "Open Sans Regular, Arial Unicode MS Regular");
+    writeMessage(fontstack, 2, range);
+    for (uint32_t id = first; id <= last; id++) {
+        std::string glyph;
+        writeVarint(glyph, 1, id);
+        writeMessage(glyph, 2, std::string((width + 2 * buffer) * (height + 2 * buffer), '\x80'));
+        writeVarint(glyph, 3, width);
+        writeVarint(glyph, 4, height);
+        writeSvarint(glyph, 5, 1);
+        writeSvarint(glyph, 6, -12);
+        writeVarint(glyph, 7, width + 2);
+        writeMessage(fontstack, 3, glyph);
+    }
+
+    std::string result;
+    writeMessage(result, 1, fontstack);
+    return result;
+}
+
+// Answers glyph requests with generated glyphs and fails everything else, so that tiles can
+// be parsed without network access.
+class BenchFileSource : public FileSource {
+public:
+    Request* request(const Resource& resource, uv_loop_t*, const Environment& env, Callback callback) override {
+        request(resource, env, callback);
+        return nullptr;
+    }
+
+    void cancel(Request*) override {}
+
+    void request(const Resource& resource, const Environment&, Callback callback) override {
+        Response res;
+        if (resource.kind == Resource::Kind::Glyphs) {
+            res.status = Response::Successful;
+            res.data = std::make_shared<std::string>(glyphs(resource.url));
+        } else {
+            res.message = "no network access in benchmarks";
+        }
+        callback(res);
+    }
+
+    void abort(const Environment&) override {}
+};
+
+struct Fixture {
+    std::string name;
+    TileID id;
+    std::shared_ptr<const std::string> data;
+    std::size_t features;
+};
+
+std::vector<Fixture> loadFixtures(const std::string& directory) {
+    std::vector<Fixture> fixtures;
+    for (const auto& file : bench::tileFixtures(directory)) {
+        const std::string name = file.substr(file.rfind('/') + 1);
+        int z = 0, x = 0, y = 0;
+        sscanf(name.c_str(), "%d-%d-%d", &z, &x, &y);
+
+        Fixture fixture { name, TileID(z, x, y), std::make_shared<std::string>(util::read_file(file)), 0 };
+        VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(fixture.data->data()), fixture.data->size()));
+        for (const auto& layerName : { "water", "admin" }) {
+            if (auto layer = tile.getLayer(layerName)) {
+                fixture.features += layer->featureCount();
+            }
+        }
+        fixtures.push_back(std::move(fixture));
+    }
+    return fixtures;
+}
+
+// Loads the style, optionally keeping only the layers of one type.
+util::ptr<Style> loadStyle(StyleLayerType type = StyleLayerType::Unknown) {
+    const std::string json = util::read_file("test/fixtures/bench/streets.style.json");
+    auto style = std::make_shared<Style>();
+    style->loadJSON(reinterpret_cast<const uint8_t *>(json.c_str()));
+    if (type != StyleLayerType::Unknown) {
+        style->layers.erase(std::remove_if(style->layers.begin(), style->layers.end(),
+            [type](const util::ptr<StyleLayer>& layer) { return layer->type != type; }),
+            style->layers.end());
+    }
+    return style;
+}
+
+// Everything a VectorTileData needs to parse, minus the GL context: atlases are only
+// uploaded when rendering.
+class Parser {
+public:
+    Parser()
+        : env(fileSource),
+          glyphAtlas(1024, 1024),
+          glyphStore(env),
+          spriteAtlas(512, 512),
+          sprite(Sprite::Create("", 1.0, env)) {
+        spriteAtlas.setSprite(sprite);
+    }
+
+    class Tile : public VectorTileData {
+    public:
+        Tile(const Fixture& fixture, Parser& parser, util::ptr<Style> style_)
+            : VectorTileData(fixture.id, 22, style_, parser.glyphAtlas, parser.glyphStore,
+                             parser.spriteAtlas, parser.sprite, style_->sources.front()->info) {
+            data = fixture.data;
+            state = State::loaded;
+        }
+
+        std::size_t bucketCount() const { return buckets.size(); }
+
+        // What TileData::request() does with the response.
+        void load(const Response& res) {
+            data = res.data;
+            state = State::loaded;
+        }
+    };
+
+    BenchFileSource fileSource;
+    Environment env;
+    GlyphAtlas glyphAtlas;
+    GlyphStore glyphStore;
+    SpriteAtlas spriteAtlas;
+    util::ptr<Sprite> sprite;
+};
+
+struct Result {
+    std::size_t features = 0;
+    std::size_t buckets = 0;
+    std::size_t allocations = 0;
+    std::chrono::nanoseconds elapsed { 0 };
+};
+
+Result parse(Parser& parser, const Fixture& fixture, const util::ptr<Style>& style, int iterations) {
+    Result result;
+    for (int i = 0; i < iterations; i++) {
+        Parser::Tile tile(fixture, parser, style);
+
+        const std::size_t before = bench::allocations();
+        const auto start = Clock::now();
+        tile.parse();
+        result.elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        result.allocations += bench::allocations() - before;
+
+        EXPECT_TRUE(tile.ready());
+        result.features += fixture.features;
+        result.buckets += tile.bucketCount();
+    }
+    return result;
+}
+
+void report(const std::string& name, const Result& result, int iterations) {
+    std::cout << name << ": " << result.buckets / iterations << " buckets" << std::endl
+              << std::fixed << std::setprecision(2)
+              << "  " << double(result.allocations) / iterations << " allocations per tile, "
+              << double(result.allocations) / result.features << " per feature" << std::endl
+              << "  " << double(result.elapsed.count()) / result.features << " ns per feature, "
+              << double(result.elapsed.count()) / iterations / 1e6 << " ms per tile" << std::endl;
+}
+
+}
+
+TEST(TileParser, Parse) {
+    const auto fixtures = loadFixtures("test/fixtures/tiles/streets");
+    ASSERT_FALSE(fixtures.empty());
+
+    Parser parser;
+    EnvironmentScope scope(parser.env, ThreadType::Map, "Map");
+    const auto style = loadStyle();
+    parser.glyphStore.setURL(style->glyph_url);
+
+    const int iterations = 20;
+    for (const auto& fixture : fixtures) {
+        // Load the glyphs before measuring.
+        parse(parser, fixture, style, 1);
+        report(fixture.name, parse(parser, fixture, style, iterations), iterations);
+    }
+}
+
+TEST(TileParser, Buckets) {
+    const auto fixtures = loadFixtures("test/fixtures/tiles/streets");
+    ASSERT_FALSE(fixtures.empty());
+
+    Parser parser;
+    EnvironmentScope scope(parser.env, ThreadType::Map, "Map");
+
+    const int iterations = 20;
+    for (const auto type : { StyleLayerType::Fill, StyleLayerType::Line, StyleLayerType::Symbol }) {
+        const auto style = loadStyle(type);
+        ASSERT_FALSE(style->layers.empty());
+        parser.glyphStore.setURL(style->glyph_url);
+
+        for (const auto& fixture : fixtures) {
+            std::ostringstream name;
+            name << fixture.name << " (" << type << ")";
+            parse(parser, fixture, style, 1);
+            report(name.str(), parse(parser, fixture, style, iterations), iterations);
+        }
+    }
+}
+
+TEST(TileParser, Threads) {
+    const auto fixtures = loadFixtures("test/fixtures/tiles/streets");
+    ASSERT_FALSE(fixtures.empty());
+
+    Parser parser;
+    EnvironmentScope scope(parser.env, ThreadType::Map, "Map");
+    const auto style = loadStyle();
+    parser.glyphStore.setURL(style->glyph_url);
+    parse(parser, fixtures.front(), style, 1);
+
+    const std::size_t tiles = 32;
+    const unsigned maxThreads = std::max(4u, 2 * std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::atomic<std::size_t> next(0);
+        std::atomic<std::size_t> features(0);
+
+        const auto start = Clock::now();
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&] {
+                EnvironmentScope workerScope(parser.env, ThreadType::TileWorker, "TileWorker_bench");
+                std::size_t i;
+                while ((i = next++) < tiles) {
+                    features += parse(parser, fixtures[i % fixtures.size()], style, 1).features;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        const double seconds = elapsed.count() / 1e9;
+
+        std::cout << threads << " threads: " << std::fixed << std::setprecision(2)
+                  << tiles / seconds << " tiles/s, "
+                  << features / seconds / 1e3 << "k features/s" << std::endl;
+    }
+}
+
+TEST(TileParser, Latency) {
+    const auto fixtures = loadFixtures("test/fixtures/tiles/streets");
+    ASSERT_FALSE(fixtures.empty());
+
+    Parser parser;
+    EnvironmentScope scope(parser.env, ThreadType::Map, "Map");
+    const auto style = loadStyle();
+    parser.glyphStore.setURL(style->glyph_url);
+    for (const auto& fixture : fixtures) {
+        parse(parser, fixture, style, 1);
+    }
+
+    // One tile at a time, so that only the buckets of a single tile are built in parallel.
+    const int iterations = 20;
+    const unsigned maxThreads = std::max(4u, 2 * std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        Worker worker(uv_default_loop(), threads);
+
+        for (const auto& fixture : fixtures) {
+            Result result;
+            worker.send([&] {
+                EnvironmentScope workerScope(parser.env, ThreadType::TileWorker, "TileWorker_bench");
+                result = parse(parser, fixture, style, iterations);
+            }, nullptr);
+            uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+            std::cout << fixture.name << ", " << threads << " threads: " << std::fixed
+                      << std::setprecision(2) << double(result.elapsed.count()) / iterations / 1e6
+                      << " ms per tile" << std::endl;
+        }
+    }
+
+    // Closes the workers' async handles.
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST(TileParser, Response) {
+    const auto fixtures = loadFixtures("test/fixtures/tiles/streets");
+    ASSERT_FALSE(fixtures.empty());
+
+    Parser parser;
+    EnvironmentScope scope(parser.env, ThreadType::Map, "Map");
+    const auto style = loadStyle();
+    ResponseCache memoryCache(64 * 1024 * 1024);
+
+    // The file source hands the response to the memory cache and to the tile, which share its
+    // body, so only the bookkeeping is allocated, whatever the size of the tile.
+    for (const auto& fixture : fixtures) {
+        Parser::Tile tile(fixture, parser, style);
+
+        const std::size_t before = bench::allocatedBytes();
+
+        auto res = std::make_shared<Response>();
+        res->status = Response::Successful;
+        res->data = fixture.data;
+        const std::shared_ptr<const Response> response = std::move(res);
+        memoryCache.put({ Resource::Tile, fixture.name }, response);
+        tile.load(*response);
+
+        const std::size_t allocated = bench::allocatedBytes() - before;
+        EXPECT_LT(allocated, fixture.data->size());
+
+        std::cout << fixture.name << ": " << fixture.data->size() << " bytes, "
+                  << allocated << " bytes allocated to hand it to the cache and the tile" << std::endl;
+    }
+}
@@ -0,0 +1,127 @@
+#include "../fixtures/util.hpp"
+#include "allocations.hpp"
+#include "fixtures.hpp"
+
+#include <mbgl/map/vector_tile.hpp>
+#include <mbgl/style/filter_expression.hpp>
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/io.hpp>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace mbgl;
+
+namespace {
+
+std::vector<std::string> layerNames(const std::string& data) {
+    std::vector<std::string> names;
+    pbf tile_pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    while (tile_pbf.next(3)) {
+        pbf layer_pbf = tile_pbf.message();
+        if (layer_pbf.next(1)) {
+            names.push_back(layer_pbf.string());
+        }
+    }
+    return names;
+}
+
+}
+
+TEST(VectorTile, DecodeAllocations) {
+    const auto files = bench::tileFixtures("test/fixtures/tiles/streets");
+    ASSERT_FALSE(files.empty());
+
+    const int iterations = 100;
+
+    for (const auto& file : files) {
+        const std::string data = util::read_file(file);
+        const auto names = layerNames(data);
+
+        std::size_t features = 0;
+        std::size_t decodeAllocations = 0;
+        std::size_t featureAllocations = 0;
+        std::size_t geometryAllocations = 0;
+
+        GeometryCollection geometries;
+
+        const auto start = Clock::now();
+
+        for (int i = 0; i < iterations; i++) {
+            std::size_t before = bench::allocations();
+            VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+            decodeAllocations += bench::allocations() - before;
+
+            for (const auto& name : names) {
+                before = bench::allocations();
+                auto layer = tile.getLayer(name);
+                decodeAllocations += bench::allocations() - before;
+                ASSERT_TRUE(layer.get());
+
+                for (std::size_t j = 0; j < layer->featureCount(); j++) {
+                    before = bench::allocations();
+                    auto feature = layer->getFeature(j);
+                    feature->getType();
+                    feature->getValue("class");
+                    featureAllocations += bench::allocations() - before;
+
+                    before = bench::allocations();
+                    geometries.clear();
+                    feature->getGeometries(geometries);
+                    geometryAllocations += bench::allocations() - before;
+
+                    features++;
+                }
+            }
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+
+        std::cout << file << ": " << features / iterations << " features in " << names.size() << " layers" << std::endl
+                  << std::fixed << std::setprecision(2)
+                  << "  decode:   " << double(decodeAllocations) / iterations << " allocations per tile" << std::endl
+                  << "  features: " << double(featureAllocations) / features << " allocations per feature" << std::endl
+                  << "  geometry: " << double(geometryAllocations) / features << " allocations per feature" << std::endl
+                  << "  " << double(elapsed.count()) / features << " ns per feature" << std::endl;
+    }
+}
+
+TEST(VectorTile, FilterEvaluation) {
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+    auto layer = tile.getLayer("admin");
+    ASSERT_TRUE(layer.get());
+
+    rapidjson::Document doc;
+    doc.Parse<0>("[\"all\", [\"==\", \"$type\", \"LineString\"], [\"in\", \"admin_level\", 2, 3], [\"==\", \"maritime\", 0], [\"!=\", \"disputed\", 1]]");
+    const FilterExpression filter = parseFilterExpression(doc);
+
+    const int iterations = 200;
+    std::size_t features = 0;
+    std::size_t expressionMatches = 0;
+    std::size_t compiledMatches = 0;
+
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (std::size_t j = 0; j < layer->featureCount(); j++) {
+            expressionMatches += evaluate(filter, GeometryTileFeatureExtractor(*layer->getFeature(j)));
+            features++;
+        }
+    }
+    const auto expressionTime = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        const auto compiled = layer->compileFilter(filter);
+        for (std::size_t j = 0; j < layer->featureCount(); j++) {
+            compiledMatches += compiled->evaluate(*layer->getFeature(j));
+        }
+    }
+    const auto compiledTime = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+
+    EXPECT_EQ(expressionMatches, compiledMatches);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "expression: " << double(expressionTime.count()) / features << " ns per feature" << std::endl
+              << "compiled:   " << double(compiledTime.count()) / features << " ns per feature" << std::endl;
+}
@@ -0,0 +1,66 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/worker.hpp>
+
+#include <uv.h>
+
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+using namespace mbgl;
+
+namespace {
+
+// Burns roughly the given number of iterations worth of CPU time.
+double spin(std::size_t iterations) {
+    double value = 1;
+    for (std::size_t i = 0; i < iterations; i++) {
+        value = std::sqrt(value + i);
+    }
+    return value;
+}
+
+void stress(const std::string& name, std::size_t jobs, std::size_t iterations) {
+    uv_loop_t* loop = uv_default_loop();
+
+    for (std::size_t threads = 1; threads <= 32; threads *= 2) {
+        std::atomic<std::size_t> done(0);
+        std::size_t after = 0;
+
+        const auto start = Clock::now();
+        {
+            Worker worker(loop, threads);
+            for (std::size_t i = 0; i < jobs; i++) {
+                // Mixed priorities, so that threads have to pick from their queues.
+                worker.send([&] { done += spin(iterations) > 0; }, [&] { after++; }, i % 7);
+            }
+            uv_run(loop, UV_RUN_DEFAULT);
+
+            EXPECT_EQ(jobs, done);
+            EXPECT_EQ(jobs, after);
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+
+        std::cout << name << ", " << std::setw(2) << threads << " threads: " << std::fixed
+                  << std::setprecision(2) << jobs / (elapsed.count() / 1e9) / 1e3 << "k jobs/s"
+                  << std::endl;
+
+        // Closes the worker's async handle.
+        uv_run(loop, UV_RUN_DEFAULT);
+    }
+}
+
+}
+
+// Many tiny jobs: dominated by queueing, stealing and completion overhead.
+TEST(Worker, Overhead) {
+    stress("empty jobs", 200000, 0);
+}
+
+// Jobs of a few dozen µs each: dominated by how well the threads are kept busy.
+TEST(Worker, Throughput) {
+    stress("short jobs", 20000, 2000);
+}
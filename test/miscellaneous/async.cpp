@@ -0,0 +1,114 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/async.hpp>
+
+#include <string>
+#include <thread>
+
+using namespace mbgl;
+
+TEST(Async, Resolved) {
+    auto async = util::Async<int>::resolved(1);
+    EXPECT_TRUE(async.isResolved());
+
+    // Steps chained to a completed step run right away.
+    int result = 0;
+    async.then([](int value) { return value + 1; }).then([&](int value) { result = value; });
+    EXPECT_EQ(2, result);
+
+    // Completed steps can't be canceled or completed again.
+    async.cancel();
+    async.resolve(5);
+    EXPECT_TRUE(async.isResolved());
+    EXPECT_FALSE(async.isCanceled());
+}
+
+TEST(Async, Chain) {
+    auto first = util::Async<int>::pending();
+    auto second = util::Async<std::string>::pending();
+
+    std::string result;
+    first.then([&](int value) {
+        EXPECT_EQ(1, value);
+        return second;
+    }).then([&](const std::string& value) {
+        result = value;
+    });
+
+    first.resolve(1);
+    EXPECT_EQ("", result);
+    second.resolve("two");
+    EXPECT_EQ("two", result);
+}
+
+TEST(Async, Cancel) {
+    bool canceled = false;
+    auto first = util::Async<int>::pending();
+    first.onCancel([&] { canceled = true; });
+
+    auto chain = first.then([](int) {
+        ADD_FAILURE() << "Canceled steps should not run";
+        return std::string();
+    });
+
+    chain.cancel();
+    EXPECT_TRUE(chain.isCanceled());
+    EXPECT_TRUE(first.isCanceled());
+    EXPECT_TRUE(canceled);
+
+    // Completing a canceled step does nothing.
+    first.resolve(1);
+    EXPECT_FALSE(first.isResolved());
+
+    // Steps returning an empty handle cancel the rest of the chain.
+    auto other = util::Async<int>::pending();
+    auto empty = other.then([](int) { return util::Async<int>(); });
+    empty.then([](int) { ADD_FAILURE() << "Canceled steps should not run"; });
+    other.resolve(1);
+    EXPECT_TRUE(empty.isCanceled());
+}
+
+TEST(Async, KeepCanceler) {
+    int canceled = 0;
+    auto async = util::Async<int>::pending();
+    async.onCancel([&] { canceled++; });
+
+    int result = 0;
+    async.then([&](int value) { result = value; });
+    async.resolveAndKeepCanceler(1);
+    EXPECT_EQ(1, result);
+
+    // The step completed, but canceling it still cancels the work that goes on.
+    async.cancel();
+    EXPECT_EQ(1, canceled);
+    EXPECT_TRUE(async.isResolved());
+
+    // Once released, the canceler doesn't run anymore.
+    auto other = util::Async<int>::pending();
+    other.onCancel([&] { canceled++; });
+    other.resolveAndKeepCanceler(2);
+    other.release();
+    other.cancel();
+    EXPECT_EQ(1, canceled);
+}
+
+TEST(Async, Threads) {
+    auto async = util::Async<int>::pending();
+
+    std::thread::id id;
+    auto chain = async.then([&](int value) {
+        id = std::this_thread::get_id();
+        return value * 2;
+    });
+
+    // Steps run in the thread that completes the step they wait for.
+    std::thread thread([&] { async.resolve(21); });
+    const auto threadID = thread.get_id();
+    thread.join();
+
+    EXPECT_EQ(threadID, id);
+
+    int result = 0;
+    chain.then([&](int value) { result = value; });
+    EXPECT_EQ(42, result);
+}
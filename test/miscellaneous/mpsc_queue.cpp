@@ -0,0 +1,89 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/mpsc_queue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace mbgl;
+
+namespace {
+
+struct Node {
+    Node(std::size_t producer_, std::size_t sequence_) : producer(producer_), sequence(sequence_) {}
+
+    const std::size_t producer;
+    const std::size_t sequence;
+    Node* next = nullptr;
+};
+
+}
+
+TEST(MPSCQueue, Order) {
+    util::MPSCQueue<Node> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(nullptr, queue.drain());
+
+    Node a(0, 0), b(0, 1), c(0, 2);
+    EXPECT_TRUE(queue.push(&a));
+    EXPECT_FALSE(queue.push(&b));
+    EXPECT_FALSE(queue.empty());
+
+    Node* node = queue.drain();
+    EXPECT_TRUE(queue.empty());
+    ASSERT_EQ(&a, node);
+    ASSERT_EQ(&b, node->next);
+    EXPECT_EQ(nullptr, node->next->next);
+
+    // The first node after draining reports the queue as empty again.
+    EXPECT_TRUE(queue.push(&c));
+    EXPECT_EQ(&c, queue.drain());
+}
+
+TEST(MPSCQueue, Producers) {
+    const std::size_t producers = 4;
+    const std::size_t messages = 10000;
+
+    util::MPSCQueue<Node> queue;
+    std::atomic<bool> done(false);
+    std::vector<std::size_t> received(producers, 0);
+    bool ordered = true;
+
+    std::thread consumer([&] {
+        while (true) {
+            // Read before draining, so that nothing pushed by the producers is missed.
+            const bool last = done;
+            Node* node = queue.drain();
+            while (node) {
+                std::unique_ptr<Node> current(node);
+                node = node->next;
+                ordered = ordered && current->sequence == received[current->producer];
+                received[current->producer]++;
+            }
+            if (last) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (std::size_t i = 0; i < messages; i++) {
+                queue.push(new Node(p, i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done = true;
+    consumer.join();
+
+    // Messages of each producer arrive in the order they were sent.
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(std::vector<std::size_t>(producers, messages), received);
+}
@@ -0,0 +1,74 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/pbf.hpp>
+
+#include <vector>
+
+using namespace mbgl;
+
+namespace {
+
+std::vector<uint8_t> encode(uint64_t value) {
+    std::vector<uint8_t> bytes;
+    while (value >= 0x80) {
+        bytes.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    bytes.push_back(uint8_t(value));
+    return bytes;
+}
+
+}
+
+TEST(PBF, Varint) {
+    const uint64_t values[] = { 0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFF, 0x100000000, 0xFFFFFFFFFFFFFFFF };
+
+    for (uint64_t value : values) {
+        std::vector<uint8_t> bytes = encode(value);
+
+        // Near the end of the buffer, which uses the bounds-checked path.
+        pbf checked(bytes.data(), bytes.size());
+        EXPECT_EQ(value, checked.varint<uint64_t>());
+        EXPECT_FALSE(checked);
+
+        // With enough bytes following, which uses the unchecked path.
+        bytes.resize(bytes.size() + 10, 0);
+        pbf fast(bytes.data(), bytes.size());
+        EXPECT_EQ(value, fast.varint<uint64_t>());
+        EXPECT_EQ(bytes.data() + encode(value).size(), fast.data);
+    }
+}
+
+TEST(PBF, VarintErrors) {
+    const std::vector<uint8_t> unterminated = { 0x80, 0x80 };
+    pbf short_pbf(unterminated.data(), unterminated.size());
+    EXPECT_THROW(short_pbf.varint(), pbf::unterminated_varint_exception);
+
+    const std::vector<uint8_t> tooLong(16, 0x80);
+    pbf long_pbf(tooLong.data(), tooLong.size());
+    EXPECT_THROW(long_pbf.varint<uint64_t>(), pbf::varint_too_long_exception);
+
+    pbf long_checked(tooLong.data(), 10);
+    EXPECT_THROW(long_checked.varint<uint64_t>(), pbf::varint_too_long_exception);
+}
+
+TEST(PBF, Packed) {
+    // Field 1, length-delimited, containing the zigzag-encoded values 1, -1, 150, -300.
+    std::vector<uint8_t> bytes = { 0x0A, 0x00, 0x02, 0x01 };
+    for (uint8_t byte : encode(300)) bytes.push_back(byte);
+    for (uint8_t byte : encode(599)) bytes.push_back(byte);
+    bytes[1] = bytes.size() - 2;
+
+    pbf message(bytes.data(), bytes.size());
+    ASSERT_TRUE(message.next(1));
+
+    std::vector<int32_t> values = { 42 };
+    pbf svarints = message;
+    svarints.packedSvarint(values);
+    EXPECT_EQ((std::vector<int32_t>{ 1, -1, 150, -300 }), values);
+    EXPECT_FALSE(svarints);
+
+    std::vector<uint32_t> raw;
+    message.packedVarint(raw);
+    EXPECT_EQ((std::vector<uint32_t>{ 2, 1, 300, 599 }), raw);
+}
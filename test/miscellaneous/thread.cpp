@@ -0,0 +1,48 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/thread.hpp>
+
+#include <uv.h>
+
+#include <atomic>
+
+using namespace mbgl;
+
+namespace {
+
+// Starts an unreferenced timer on its thread's loop, and closes it when it is destroyed.
+class Closing {
+public:
+    explicit Closing(std::atomic<bool>& closed_) : closed(closed_) {}
+
+    void start() {
+        timer = new uv_timer_t;
+        timer->data = &closed;
+        uv_timer_init(util::RunLoop::Get()->get(), timer);
+        uv_unref(reinterpret_cast<uv_handle_t*>(timer));
+    }
+
+    ~Closing() {
+        uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
+            *reinterpret_cast<std::atomic<bool>*>(handle->data) = true;
+            delete reinterpret_cast<uv_timer_t*>(handle);
+        });
+    }
+
+private:
+    std::atomic<bool>& closed;
+    uv_timer_t* timer = nullptr;
+};
+
+}
+
+TEST(Thread, CloseHandles) {
+    std::atomic<bool> closed(false);
+    {
+        util::Thread<Closing> thread("Closing", closed);
+        thread.invoke(&Closing::start);
+    }
+
+    // The object was destroyed while the loop still ran, which closed the timer.
+    EXPECT_TRUE(closed);
+}
@@ -0,0 +1,298 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/map/environment.hpp>
+#include <mbgl/map/source.hpp>
+#include <mbgl/map/sprite.hpp>
+#include <mbgl/map/vector_tile_data.hpp>
+#include <mbgl/renderer/symbol_bucket.hpp>
+#include <mbgl/geometry/glyph_atlas.hpp>
+#include <mbgl/geometry/sprite_atlas.hpp>
+#include <mbgl/storage/file_source.hpp>
+#include <mbgl/style/style.hpp>
+#include <mbgl/text/glyph_store.hpp>
+#include <mbgl/util/io.hpp>
+#include <mbgl/util/uv_detail.hpp>
+#include <mbgl/util/worker.hpp>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace mbgl;
+
+namespace {
+
+void writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += char((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += char(value);
+}
+
+void writeVarint(std::string& out, uint32_t field, uint64_t value) {
+    writeVarint(out, field << 3);
+    writeVarint(out, value);
+}
+
+void writeMessage(std::string& out, uint32_t field, const std::string& message) {
+    writeVarint(out, (field << 3) | 2);
+    writeVarint(out, message.size());
+    out += message;
+}
+
+// Generates a glyph PBF for the range in a URL like ".../0-255.pbf", with the same metrics for
+// every glyph.
+std::string glyphs(const std::string& url) {
+    const std::size_t slash = url.rfind('/');
+    const std::string range = url.substr(slash + 1, url.rfind(".pbf") - slash - 1);
+    const uint32_t first = std::stoul(range);
+    const uint32_t last = std::stoul(range.substr(range.find('-') + 1));
+
+    const uint32_t width = 10, height = 14, buffer = 3;
+
+    std::string fontstack;
+    writeMessage(fontstack, 1, "Open Sans Regular, Arial Unicode MS Regular");
+    writeMessage(fontstack, 2, range);
+    for (uint32_t id = first; id <= last; id++) {
+        std::string glyph;
+        writeVarint(glyph, 1, id);
+        writeMessage(glyph, 2, std::string((width + 2 * buffer) * (height + 2 * buffer), '\x80'));
+        writeVarint(glyph, 3, width);
+        writeVarint(glyph, 4, height);
+        writeVarint(glyph, 7, width + 2);
+        writeMessage(fontstack, 3, glyph);
+    }
+
+    std::string result;
+    writeMessage(result, 1, fontstack);
+    return result;
+}
+
+// Holds on to glyph requests until they are answered explicitly.
+class GlyphFileSource : public FileSource {
+public:
+    Request* request(const Resource& resource, uv_loop_t*, const Environment& env, Callback callback) override {
+        request(resource, env, callback);
+        return nullptr;
+    }
+
+    void cancel(Request*) override {}
+
+    void request(const Resource& resource, const Environment&, Callback callback) override {
+        ASSERT_EQ(Resource::Kind::Glyphs, resource.kind);
+        pending.emplace_back(resource.url, callback);
+        requests++;
+    }
+
+    void abort(const Environment&) override {}
+
+    // Answers the requests for URLs that contain the filter.
+    void respond(const std::string& filter = "") {
+        auto waiting = std::move(pending);
+        pending.clear();
+        for (const auto& request : waiting) {
+            if (request.first.find(filter) == std::string::npos) {
+                pending.push_back(request);
+                continue;
+            }
+            Response res;
+            res.status = Response::Successful;
+            res.data = std::make_shared<std::string>(glyphs(request.first));
+            request.second(res);
+        }
+    }
+
+    std::vector<std::pair<std::string, Callback>> pending;
+    std::size_t requests = 0;
+};
+
+class PartialTile : public VectorTileData {
+public:
+    PartialTile(const std::string& data_, util::ptr<Style> style_, GlyphAtlas& glyphAtlas_,
+                GlyphStore& glyphStore_, SpriteAtlas& spriteAtlas_, util::ptr<Sprite> sprite_)
+        : VectorTileData(TileID(0, 0, 0), 22, style_, glyphAtlas_, glyphStore_, spriteAtlas_,
+                         sprite_, style_->sources.front()->info) {
+        data = std::make_shared<std::string>(data_);
+        state = State::loaded;
+    }
+
+    bool hasBucket(const std::string& bucket) const { return buckets.count(bucket); }
+    std::size_t waitingSymbolBuckets() const { return symbolBuckets.size(); }
+
+    // The glyph and icon vertices of each symbol bucket.
+    std::map<std::string, std::pair<std::size_t, std::size_t>> symbolSizes() const {
+        std::map<std::string, std::pair<std::size_t, std::size_t>> result;
+        for (const auto& pair : buckets) {
+            if (auto symbol = dynamic_cast<const SymbolBucket*>(pair.second.get())) {
+                result[pair.first] = { symbol->textVertexCount(), symbol->iconVertexCount() };
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::size_t> bufferSizes() const {
+        return { fillVertexBuffer.index(), lineVertexBuffer.index(), triangleElementsBuffer.index(),
+                 lineElementsBuffer.index(), pointElementsBuffer.index() };
+    }
+};
+
+}
+
+TEST(TileParser, PartialSymbols) {
+    GlyphFileSource fileSource;
+    Environment env(fileSource);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    const std::string json = util::read_file("test/fixtures/bench/streets.style.json");
+    auto style = std::make_shared<Style>();
+    style->loadJSON(reinterpret_cast<const uint8_t *>(json.c_str()));
+
+    GlyphAtlas glyphAtlas(1024, 1024);
+    GlyphStore glyphStore(env);
+    glyphStore.setURL(style->glyph_url);
+    SpriteAtlas spriteAtlas(512, 512);
+    auto sprite = Sprite::Create("", 1.0, env);
+
+    PartialTile tile(util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf"), style,
+                     glyphAtlas, glyphStore, spriteAtlas, sprite);
+
+    // The glyphs are still loading: fill and line buckets are built, symbol buckets are not.
+    tile.parse();
+    EXPECT_EQ(TileData::State::partial, tile.state);
+    EXPECT_TRUE(tile.renderable());
+    EXPECT_FALSE(tile.ready());
+    EXPECT_TRUE(tile.hasBucket("water"));
+    EXPECT_TRUE(tile.hasBucket("admin_country"));
+    EXPECT_FALSE(tile.hasBucket("admin_label"));
+    EXPECT_FALSE(tile.dependenciesLoaded());
+
+    const std::size_t requests = fileSource.requests;
+    EXPECT_LT(0u, requests);
+
+    // Parsing again before the glyphs arrived doesn't request them again.
+    tile.parse();
+    EXPECT_EQ(TileData::State::partial, tile.state);
+    EXPECT_EQ(requests, fileSource.requests);
+
+    fileSource.respond();
+    EXPECT_TRUE(tile.dependenciesLoaded());
+
+    tile.parse();
+    EXPECT_EQ(TileData::State::parsed, tile.state);
+    EXPECT_TRUE(tile.hasBucket("water"));
+    EXPECT_TRUE(tile.hasBucket("admin_label"));
+    EXPECT_EQ(requests, fileSource.requests);
+}
+
+TEST(TileParser, PartialSymbolsResume) {
+    GlyphFileSource fileSource;
+    Environment env(fileSource);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    // A second label layer, which needs glyphs of another range than the first.
+    std::string json = util::read_file("test/fixtures/bench/streets.style.json");
+    json.insert(json.rfind(']'), R"JSON(, {
+    "id": "admin_label_ru",
+    "type": "symbol",
+    "source": "mapbox",
+    "source-layer": "admin",
+    "filter": ["<=", "admin_level", 2],
+    "layout": {
+      "symbol-placement": "line",
+      "text-field": "\u0423\u0440\u043e\u0432\u0435\u043d\u044c {admin_level}",
+      "text-font": "Open Sans Regular, Arial Unicode MS Regular",
+      "text-max-size": 12
+    }
+  })JSON");
+    auto style = std::make_shared<Style>();
+    style->loadJSON(reinterpret_cast<const uint8_t *>(json.c_str()));
+
+    GlyphAtlas glyphAtlas(1024, 1024);
+    GlyphStore glyphStore(env);
+    glyphStore.setURL(style->glyph_url);
+    SpriteAtlas spriteAtlas(512, 512);
+    auto sprite = Sprite::Create("", 1.0, env);
+
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    PartialTile resumed(data, style, glyphAtlas, glyphStore, spriteAtlas, sprite);
+
+    // Parses while the glyphs are loading, and resumes as they are loaded.
+    resumed.parse();
+    resumed.parse();
+    EXPECT_EQ(TileData::State::partial, resumed.state);
+    EXPECT_EQ(0u, resumed.waitingSymbolBuckets());
+    const auto bufferSizes = resumed.bufferSizes();
+
+    // The first label layer is built and waits for the second.
+    fileSource.respond("/0-255.pbf");
+    resumed.parse();
+    EXPECT_EQ(TileData::State::partial, resumed.state);
+    EXPECT_EQ(1u, resumed.waitingSymbolBuckets());
+    EXPECT_FALSE(resumed.hasBucket("admin_label"));
+
+    fileSource.respond();
+    resumed.parse();
+    EXPECT_EQ(TileData::State::parsed, resumed.state);
+    EXPECT_EQ(0u, resumed.waitingSymbolBuckets());
+    EXPECT_TRUE(resumed.hasBucket("admin_label"));
+    EXPECT_TRUE(resumed.hasBucket("admin_label_ru"));
+
+    // The buffers hold what a tile parsed at once holds, once.
+    PartialTile whole(data, style, glyphAtlas, glyphStore, spriteAtlas, sprite);
+    whole.parse();
+    EXPECT_EQ(TileData::State::parsed, whole.state);
+
+    EXPECT_EQ(bufferSizes, resumed.bufferSizes());
+    EXPECT_EQ(whole.bufferSizes(), resumed.bufferSizes());
+
+    const auto symbolSizes = resumed.symbolSizes();
+    EXPECT_EQ(whole.symbolSizes(), symbolSizes);
+    ASSERT_FALSE(symbolSizes.empty());
+    std::size_t vertices = 0;
+    for (const auto& pair : symbolSizes) {
+        vertices += pair.second.first + pair.second.second;
+    }
+    EXPECT_LT(0u, vertices);
+}
+
+TEST(TileParser, Parallel) {
+    GlyphFileSource fileSource;
+    Environment env(fileSource);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    const std::string json = util::read_file("test/fixtures/bench/streets.style.json");
+    auto style = std::make_shared<Style>();
+    style->loadJSON(reinterpret_cast<const uint8_t *>(json.c_str()));
+
+    GlyphAtlas glyphAtlas(1024, 1024);
+    GlyphStore glyphStore(env);
+    glyphStore.setURL(style->glyph_url);
+    SpriteAtlas spriteAtlas(512, 512);
+    auto sprite = Sprite::Create("", 1.0, env);
+
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    PartialTile serial(data, style, glyphAtlas, glyphStore, spriteAtlas, sprite);
+    PartialTile parallel(data, style, glyphAtlas, glyphStore, spriteAtlas, sprite);
+
+    // Outside of a worker, the buckets are built one source layer after the other.
+    serial.parse();
+
+    {
+        Worker worker(uv_default_loop(), 4);
+        worker.send([&] {
+            EnvironmentScope workerScope(env, ThreadType::TileWorker, "TileWorker");
+            parallel.parse();
+        }, nullptr);
+        uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+    }
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    // The slices are joined in the same order, whichever thread built them.
+    EXPECT_EQ(serial.state, parallel.state);
+    EXPECT_EQ(serial.bufferSizes(), parallel.bufferSizes());
+    EXPECT_LT(0u, parallel.bufferSizes().front());
+    EXPECT_TRUE(parallel.hasBucket("water"));
+    EXPECT_TRUE(parallel.hasBucket("admin_country"));
+}
@@ -0,0 +1,116 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/map/vector_tile.hpp>
+#include <mbgl/util/io.hpp>
+
+using namespace mbgl;
+
+TEST(VectorTile, getLayer) {
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+
+    auto water = tile.getLayer("water");
+    ASSERT_TRUE(water.get());
+    EXPECT_EQ(48u, water->featureCount());
+
+    // Layers are decoded once and then reused.
+    EXPECT_EQ(water, tile.getLayer("water"));
+
+    EXPECT_TRUE(tile.getLayer("admin").get());
+    EXPECT_FALSE(tile.getLayer("road").get());
+    EXPECT_FALSE(tile.getLayer("").get());
+}
+
+TEST(VectorTile, getValue) {
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+
+    auto admin = tile.getLayer("admin");
+    ASSERT_TRUE(admin.get());
+    ASSERT_LT(0u, admin->featureCount());
+
+    auto feature = admin->getFeature(0);
+    EXPECT_EQ(FeatureType::LineString, feature->getType());
+    EXPECT_TRUE(bool(feature->getValue("admin_level")));
+    EXPECT_FALSE(bool(feature->getValue("osm_id")));
+    EXPECT_FALSE(bool(feature->getValue("admin")));
+
+    EXPECT_THROW(admin->getFeature(admin->featureCount()), std::out_of_range);
+}
+
+TEST(VectorTile, getGeometries) {
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+
+    auto water = tile.getLayer("water");
+    ASSERT_TRUE(water.get());
+
+    auto feature = water->getFeature(0);
+    ASSERT_EQ(FeatureType::Polygon, feature->getType());
+
+    GeometryCollection geometries;
+    feature->getGeometries(geometries);
+    const std::size_t lines = geometries.size();
+    ASSERT_LT(0u, lines);
+
+    for (const auto ring : geometries) {
+        ASSERT_LT(3u, ring.size());
+        EXPECT_EQ(ring.front(), ring.back());
+    }
+
+    // Decoding into the same collection appends the lines.
+    feature->getGeometries(geometries);
+    ASSERT_EQ(2 * lines, geometries.size());
+    for (std::size_t i = 0; i < lines; i++) {
+        ASSERT_EQ(geometries[i].size(), geometries[lines + i].size());
+        EXPECT_TRUE(std::equal(geometries[i].begin(), geometries[i].end(), geometries[lines + i].begin()));
+    }
+
+    const GeometryLines second(geometries, lines, geometries.size());
+    EXPECT_EQ(lines, second.size());
+    EXPECT_EQ(geometries[lines].begin(), second[0].begin());
+
+    geometries.clear();
+    EXPECT_TRUE(geometries.empty());
+}
+
+TEST(VectorTile, compileFilter) {
+    const std::string data = util::read_file("test/fixtures/tiles/streets/0-0-0.vector.pbf");
+    VectorTile tile(pbf(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+
+    auto admin = tile.getLayer("admin");
+    ASSERT_TRUE(admin.get());
+
+    const char* filters[] = {
+        "[\"==\", \"admin_level\", 2]",
+        "[\"!=\", \"admin_level\", 2]",
+        "[\">=\", \"admin_level\", 3]",
+        "[\"in\", \"admin_level\", 2, 4, \"3\"]",
+        "[\"!in\", \"admin_level\", 2, 4]",
+        "[\"==\", \"missing\", 1]",
+        "[\"!=\", \"missing\", 1]",
+        "[\"all\", [\"==\", \"$type\", \"LineString\"], [\"==\", \"maritime\", 0], [\"<=\", \"admin_level\", 2]]",
+        "[\"any\", [\"==\", \"disputed\", 1], [\"==\", \"maritime\", 1]]",
+        "[\"none\", [\"==\", \"disputed\", 1], [\"in\", \"admin_level\", 3, 4]]",
+        "[\"all\"]",
+        "[\"any\"]",
+    };
+
+    for (const char* json : filters) {
+        rapidjson::Document doc;
+        doc.Parse<0>(json);
+        const FilterExpression filter = parseFilterExpression(doc);
+        const auto compiled = admin->compileFilter(filter);
+
+        for (std::size_t i = 0; i < admin->featureCount(); i++) {
+            auto feature = admin->getFeature(i);
+            EXPECT_EQ(evaluate(filter, GeometryTileFeatureExtractor(*feature)), compiled->evaluate(*feature)) << json;
+        }
+
+        // Evaluating again uses the memoized comparison results.
+        for (std::size_t i = 0; i < admin->featureCount(); i++) {
+            auto feature = admin->getFeature(i);
+            EXPECT_EQ(evaluate(filter, GeometryTileFeatureExtractor(*feature)), compiled->evaluate(*feature)) << json;
+        }
+    }
+}
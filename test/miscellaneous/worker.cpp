@@ -0,0 +1,424 @@
+#include "../fixtures/util.hpp"
+
+#include <mbgl/util/worker.hpp>
+#include <mbgl/util/uv_detail.hpp>
+#include <mbgl/util/chrono.hpp>
+#include <mbgl/util/std.hpp>
+
+#include <uv.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mbgl;
+
+TEST(Worker, DefaultThreadCount) {
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 0);
+        EXPECT_EQ(Worker::defaultThreadCount(), worker.getThreadCount());
+        EXPECT_LE(1u, worker.getThreadCount());
+    }
+
+    // Closes the worker's async handle.
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, Resize) {
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 2, true);
+        EXPECT_EQ(2u, worker.getThreadCount());
+
+        std::atomic<int> done(0);
+        int after = 0;
+
+        const auto send = [&](int count) {
+            for (int i = 0; i < count; i++) {
+                worker.send([&] { done++; }, [&] { after++; });
+            }
+        };
+
+        send(100);
+        worker.setThreadCount(8);
+        EXPECT_EQ(8u, worker.getThreadCount());
+        send(100);
+        worker.setThreadCount(1);
+        EXPECT_EQ(1u, worker.getThreadCount());
+        send(100);
+
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        EXPECT_EQ(300, done);
+        EXPECT_EQ(300, after);
+    }
+
+    // Closes the worker's async handle.
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
+#if defined(__linux__)
+TEST(Worker, Pinned) {
+    // Pinned threads stay within the CPUs of the thread that created the pool.
+    cpu_set_t original;
+    CPU_ZERO(&original);
+    ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(original), &original));
+    int cpu = -1;
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &original)) {
+            cpu = i;
+        }
+    }
+    ASSERT_LE(0, cpu);
+
+    cpu_set_t restricted;
+    CPU_ZERO(&restricted);
+    CPU_SET(cpu, &restricted);
+    ASSERT_EQ(0, pthread_setaffinity_np(pthread_self(), sizeof(restricted), &restricted));
+
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 4, true);
+        ASSERT_EQ(0, pthread_setaffinity_np(pthread_self(), sizeof(original), &original));
+
+        std::atomic<int> pinned(0);
+        for (int i = 0; i < 16; i++) {
+            worker.send([&] {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+                if (CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set)) {
+                    pinned++;
+                }
+            }, [] {});
+        }
+
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        EXPECT_EQ(16, pinned);
+    }
+
+    // Closes the worker's async handle.
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+#endif
+
+TEST(Worker, Priority) {
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 1);
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool started = false;
+        bool blocked = true;
+
+        std::vector<std::string> order;
+        std::vector<std::string> after;
+
+        // Keeps the only thread busy until all other work is queued.
+        worker.send([&] {
+            std::unique_lock<std::mutex> lock(mutex);
+            started = true;
+            condition.notify_one();
+            condition.wait(lock, [&] { return !blocked; });
+        }, nullptr);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return started; });
+        }
+
+        const auto send = [&](const std::string& name, double priority) {
+            return worker.send([&order, name] { order.push_back(name); },
+                               [&after, name] { after.push_back(name); }, priority);
+        };
+
+        auto b = send("b", 3);
+        auto c = send("c", 1);
+        auto d = send("d", 2);
+        auto e = send("e", 4);
+
+        d->setPriority(0);
+        c->cancel();
+        b.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocked = false;
+            condition.notify_one();
+        }
+
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        EXPECT_EQ((std::vector<std::string> { "d", "b", "e" }), order);
+        EXPECT_EQ((std::vector<std::string> { "d", "b", "e" }), after);
+    }
+
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, UrgentWorkSentLater) {
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 1);
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool blocked = true;
+        bool urgentSent = false;
+
+        std::vector<std::string> order;
+
+        const auto record = [&](const std::string& name) {
+            std::unique_lock<std::mutex> lock(mutex);
+            order.push_back(name);
+            condition.notify_all();
+
+            // The first request keeps the thread busy, after it moved a few requests to its queue.
+            if (order.size() == 1) {
+                condition.wait(lock, [&] { return !blocked; });
+            }
+        };
+
+        for (int i = 0; i < 8; i++) {
+            worker.send([&] { record("regular"); }, nullptr, 2);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return !order.empty(); });
+        }
+
+        worker.send([&] { record("urgent"); }, nullptr, 1);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocked = false;
+            urgentSent = true;
+            condition.notify_all();
+        }
+
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        EXPECT_TRUE(urgentSent);
+        ASSERT_EQ(9u, order.size());
+        EXPECT_EQ("urgent", order[1]);
+    }
+
+    // Closes the worker's async handle.
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, CompletionsBeforeLongWork) {
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 1);
+
+        std::atomic<bool> finished(false);
+        bool afterFirst = false;
+        bool finishedBeforeAfterFirst = true;
+
+        // The first request takes long enough for the thread to expect the next one to hold on to
+        // its completion for too long, so the completion is sent before the next one starts.
+        worker.send([] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); }, [&] {
+            afterFirst = true;
+            finishedBeforeAfterFirst = finished;
+        }, 0);
+        worker.send([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            finished = true;
+        }, nullptr, 1);
+
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        EXPECT_TRUE(afterFirst);
+        EXPECT_FALSE(finishedBeforeAfterFirst);
+    }
+
+    // Closes the worker's async handle.
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, SharedPool) {
+    uv_loop_t* loop = uv_default_loop();
+    uv::loop other;
+    {
+        auto pool = std::make_shared<WorkerPool>(1);
+        Worker a(loop, pool);
+        Worker b(*other, pool);
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool started = false;
+        bool blocked = true;
+
+        std::vector<std::string> order;
+        int afterA = 0;
+        int afterB = 0;
+
+        // Keeps the only thread busy until all other work is queued.
+        a.send([&] {
+            std::unique_lock<std::mutex> lock(mutex);
+            started = true;
+            condition.notify_one();
+            condition.wait(lock, [&] { return !blocked; });
+        }, nullptr);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return started; });
+        }
+
+        for (int i = 0; i < 20; i++) {
+            a.send([&] { order.push_back("a"); }, [&] { afterA++; });
+        }
+        for (int i = 0; i < 3; i++) {
+            b.send([&] { order.push_back("b"); }, [&] { afterB++; });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocked = false;
+            condition.notify_one();
+        }
+
+        uv_run(loop, UV_RUN_DEFAULT);
+        uv_run(*other, UV_RUN_DEFAULT);
+
+        // The second worker doesn't wait for the first one's backlog.
+        ASSERT_EQ(23u, order.size());
+        const auto last = std::find(order.rbegin(), order.rend(), "b");
+        EXPECT_LT(order.rend() - last, 12);
+
+        EXPECT_EQ(20, afterA);
+        EXPECT_EQ(3, afterB);
+    }
+
+    uv_run(loop, UV_RUN_DEFAULT);
+    uv_run(*other, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, DetachDuringOtherWork) {
+    uv_loop_t* loop = uv_default_loop();
+    uv::loop other;
+    {
+        auto pool = std::make_shared<WorkerPool>(1);
+        auto a = util::make_unique<Worker>(loop, pool);
+        Worker b(*other, pool);
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        int stage = 0;
+        std::atomic<bool> ranA(false);
+
+        const auto advance = [&](int value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stage = value;
+            condition.notify_all();
+        };
+        const auto wait = [&](int value) {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return stage >= value; });
+        };
+
+        // Keeps the only thread busy while the next two requests are queued, so that it takes
+        // them together.
+        b.send([&] { advance(1); wait(2); }, nullptr, 3);
+        wait(1);
+        b.send([&] { advance(3); wait(4); }, nullptr, 4);
+        b.send([&] {
+            advance(5);
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }, nullptr, 5);
+        advance(2);
+
+        // The request of the first worker goes before the long one, and its completion is
+        // batched while the long one runs.
+        wait(3);
+        a->send([&] { ranA = true; }, nullptr, 0);
+        advance(4);
+        wait(5);
+        EXPECT_TRUE(ranA);
+
+        // The first worker doesn't wait for the long request to be done.
+        const auto start = Clock::now();
+        a.reset();
+        EXPECT_GT(std::chrono::milliseconds(150), Clock::now() - start);
+
+        uv_run(*other, UV_RUN_DEFAULT);
+    }
+
+    uv_run(loop, UV_RUN_DEFAULT);
+    uv_run(*other, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, SharedPoolLifetime) {
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker a(loop, WorkerPool::shared());
+        Worker b(loop, WorkerPool::shared());
+        a.setThreadCount(Worker::defaultThreadCount() + 1);
+        EXPECT_EQ(Worker::defaultThreadCount() + 1, b.getThreadCount());
+    }
+
+    // The pool went away with its last worker.
+    EXPECT_EQ(Worker::defaultThreadCount(), WorkerPool::shared()->getThreadCount());
+
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
+TEST(Worker, Parallel) {
+    // Outside of a pool, the tasks run one after the other on the calling thread.
+    std::vector<int> order;
+    std::vector<WorkerPool::Fn> tasks;
+    for (int i = 0; i < 5; i++) {
+        tasks.emplace_back([&order, i] { order.push_back(i); });
+    }
+    WorkerPool::parallel(std::move(tasks));
+    EXPECT_EQ((std::vector<int> { 0, 1, 2, 3, 4 }), order);
+
+    uv_loop_t* loop = uv_default_loop();
+    {
+        Worker worker(loop, 4);
+
+        std::atomic<int> done(0);
+        bool caught = false;
+
+        worker.send([&] {
+            std::vector<WorkerPool::Fn> many;
+            for (int i = 0; i < 100; i++) {
+                many.emplace_back([&] { done++; });
+            }
+            WorkerPool::parallel(std::move(many));
+
+            std::vector<WorkerPool::Fn> failing;
+            failing.emplace_back([] { throw std::runtime_error("failed"); });
+            failing.emplace_back([&] { done++; });
+            try {
+                WorkerPool::parallel(std::move(failing));
+            } catch (const std::runtime_error&) {
+                caught = true;
+            }
+        }, nullptr);
+
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        EXPECT_EQ(101, done);
+        EXPECT_TRUE(caught);
+    }
+
+    uv_run(loop, UV_RUN_DEFAULT);
+}
@@ -0,0 +1,98 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/storage/response_cache.hpp>
+#include <mbgl/storage/sqlite_cache.hpp>
+
+TEST_F(Storage, CacheMemory) {
+    SCOPED_TEST(CacheMemory);
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+
+    const Resource resource { Resource::Unknown, "http://127.0.0.1:3000/test?cachecontrol=max-age=30" };
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ(0u, fs.getMemoryCacheHits());
+        EXPECT_EQ(1u, fs.getMemoryCacheMisses());
+
+        // The fresh response is answered from memory, without copying it.
+        const Response* first = &res;
+        fs.request(resource, uv_default_loop(), env, [&, first](const Response &res2) {
+            EXPECT_EQ(first, &res2);
+            EXPECT_EQ(1u, fs.getMemoryCacheHits());
+            EXPECT_EQ(1u, fs.getMemoryCacheMisses());
+
+            CacheMemory.finish();
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, CacheMemoryDisabled) {
+    SCOPED_TEST(CacheMemoryDisabled);
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+    fs.setMemoryCacheSize(0);
+
+    const Resource resource { Resource::Unknown, "http://127.0.0.1:3000/test?cachecontrol=max-age=30" };
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+        // The response is read from the file cache instead.
+        fs.request(resource, uv_default_loop(), env, [&, res](const Response &res2) {
+            EXPECT_EQ(*res.data, *res2.data);
+            EXPECT_EQ(0u, fs.getMemoryCacheHits());
+            EXPECT_EQ(2u, fs.getMemoryCacheMisses());
+
+            CacheMemoryDisabled.finish();
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, CacheMemoryEvict) {
+    using namespace mbgl;
+
+    const auto response = [](std::size_t size) {
+        auto res = std::make_shared<Response>();
+        res->data = std::make_shared<std::string>(size, 'x');
+        return std::shared_ptr<const Response>(std::move(res));
+    };
+
+    const Resource a { Resource::Unknown, "a" };
+    const Resource b { Resource::Unknown, "b" };
+    const Resource c { Resource::Unknown, "c" };
+
+    ResponseCache cache(3 * (sizeof(Response) + 1000));
+    cache.put(a, response(1000));
+    cache.put(b, response(1000));
+    EXPECT_NE(nullptr, cache.get(a));
+
+    // b is the least recently used response.
+    cache.put(c, response(1000));
+    EXPECT_EQ(nullptr, cache.get(b));
+    EXPECT_NE(nullptr, cache.get(a));
+    EXPECT_NE(nullptr, cache.get(c));
+    EXPECT_GE(3 * (sizeof(Response) + 1000), cache.size());
+
+    // Responses that don't fit aren't stored, and replace the ones they update.
+    cache.put(a, response(10000));
+    EXPECT_EQ(nullptr, cache.get(a));
+    EXPECT_NE(nullptr, cache.get(c));
+
+    cache.setMaximumSize(0);
+    EXPECT_EQ(nullptr, cache.get(c));
+    EXPECT_EQ(0u, cache.size());
+}
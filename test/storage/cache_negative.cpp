@@ -0,0 +1,146 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/storage/sqlite_cache.hpp>
+#include <mbgl/util/chrono.hpp>
+
+namespace {
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(mbgl::SystemClock::now().time_since_epoch()).count();
+}
+
+// The number of requests the test server got for missing resources.
+int negativeRequests() {
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    int count = -1;
+    fs.request({ Resource::Unknown, "http://127.0.0.1:3000/negative/requests" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        count = std::stoi(*res.data);
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+    return count;
+}
+
+}
+
+TEST_F(Storage, CacheNegative) {
+    SCOPED_TEST(Missing)
+    SCOPED_TEST(Empty)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+    fs.setNegativeCacheTTL(std::chrono::seconds(60));
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    const int requests = negativeRequests();
+
+    // Neither response says how long it is valid, so they are cached for the negative TTL. The
+    // second requests are answered from memory.
+    const Resource missing { Resource::Tile, "http://127.0.0.1:3000/negative/missing" };
+    fs.request(missing, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::NotFound, res.status);
+        EXPECT_EQ("HTTP status code 404", res.message);
+        EXPECT_LT(now() + 50, res.expires);
+        EXPECT_GE(now() + 60, res.expires);
+
+        fs.request(missing, uv_default_loop(), env, [&, res](const Response &res2) {
+            EXPECT_EQ(Response::NotFound, res2.status);
+            EXPECT_EQ(res.expires, res2.expires);
+            Missing.finish();
+        });
+    });
+
+    const Resource empty { Resource::Tile, "http://127.0.0.1:3000/negative/empty" };
+    fs.request(empty, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ("", *res.data);
+        EXPECT_LT(now() + 50, res.expires);
+
+        fs.request(empty, uv_default_loop(), env, [&](const Response &res2) {
+            EXPECT_EQ(Response::Successful, res2.status);
+            EXPECT_EQ("", *res2.data);
+            Empty.finish();
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    EXPECT_EQ(2u, fs.getMemoryCacheHits());
+    EXPECT_EQ(requests + 2, negativeRequests());
+}
+
+TEST_F(Storage, CacheNegativeTilesOnly) {
+    SCOPED_TEST(CacheNegativeTilesOnly)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+    fs.setNegativeCacheTTL(std::chrono::seconds(60));
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    const int requests = negativeRequests();
+
+    // A missing style may be published any moment, so it isn't cached for the negative TTL.
+    const Resource resource { Resource::JSON, "http://127.0.0.1:3000/negative/missing" };
+    fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::NotFound, res.status);
+        EXPECT_EQ(0, res.expires);
+
+        fs.request(resource, uv_default_loop(), env, [&](const Response &res2) {
+            EXPECT_EQ(Response::NotFound, res2.status);
+            CacheNegativeTilesOnly.finish();
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    EXPECT_EQ(requests + 2, negativeRequests());
+}
+
+TEST_F(Storage, CacheNegativeExpires) {
+    SCOPED_TEST(CacheNegativeExpires)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+
+    // Answers from the file cache.
+    fs.setMemoryCacheSize(0);
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    const int requests = negativeRequests();
+
+    // The server says for how long the resource is missing, which overrides the negative TTL.
+    const Resource resource { Resource::Tile, "http://127.0.0.1:3000/negative/expiring" };
+    fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::NotFound, res.status);
+        EXPECT_LT(now() + 110, res.expires);
+        EXPECT_GE(now() + 120, res.expires);
+
+        fs.request(resource, uv_default_loop(), env, [&, res](const Response &res2) {
+            EXPECT_EQ(Response::NotFound, res2.status);
+            EXPECT_EQ(res.expires, res2.expires);
+            CacheNegativeExpires.finish();
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    EXPECT_EQ(requests + 1, negativeRequests());
+}
@@ -0,0 +1,111 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/map/environment.hpp>
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/storage/sqlite_cache.hpp>
+#include <mbgl/util/async.hpp>
+
+TEST_F(Storage, CacheStaleChanged) {
+    SCOPED_TEST(CacheStaleChanged)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+    fs.setStaleWhileRevalidate(true);
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    int notifications = 0;
+
+    const Resource resource { Resource::Unknown, "http://127.0.0.1:3000/stale/changed" };
+    fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ(0, res.expires);
+
+        // The stale response comes first, and then the one that replaced it.
+        fs.request(resource, uv_default_loop(), env, [&, res](const Response &res2) {
+            EXPECT_EQ(Response::Successful, res2.status);
+            if (++notifications == 1) {
+                EXPECT_EQ(*res.data, *res2.data);
+            } else {
+                EXPECT_NE(*res.data, *res2.data);
+                CacheStaleChanged.finish();
+            }
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    EXPECT_EQ(2, notifications);
+}
+
+TEST_F(Storage, CacheStaleSame) {
+    SCOPED_TEST(CacheStaleSame)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+    fs.setStaleWhileRevalidate(true);
+
+    // Answers from the file cache.
+    fs.setMemoryCacheSize(0);
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    int notifications = 0;
+
+    const Resource resource { Resource::Unknown, "http://127.0.0.1:3000/stale/same" };
+    fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ("unchanged", res.etag);
+
+        // The response didn't change when it was revalidated, so only the stale one comes.
+        fs.request(resource, uv_default_loop(), env, [&](const Response &res2) {
+            EXPECT_EQ(Response::Successful, res2.status);
+            EXPECT_EQ("Response", *res2.data);
+            EXPECT_EQ(0, res2.expires);
+            notifications++;
+            CacheStaleSame.finish();
+        });
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    EXPECT_EQ(1, notifications);
+}
+
+TEST_F(Storage, CacheStaleCancel) {
+    SCOPED_TEST(CacheStaleCancel)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache);
+    fs.setStaleWhileRevalidate(true);
+
+    Environment env(fs);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    const Resource resource { Resource::Unknown, "http://127.0.0.1:3000/stale/changed" };
+    util::Async<Response> stale;
+
+    env.request(resource).then([&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+
+        // Canceling the step that completed with the stale response cancels the revalidation.
+        stale = env.requestWithUpdates(resource, [&](const Response &) {
+            ADD_FAILURE() << "Canceled requests should not be updated";
+        });
+        stale.then([&, res](const Response &res2) {
+            EXPECT_EQ(*res.data, *res2.data);
+            stale.cancel();
+            CacheStaleCancel.finish();
+        });
+    });
+
+    uv_run(env.loop, UV_RUN_DEFAULT);
+}
@@ -9,6 +9,10 @@
 
 #include <sqlite3.h>
 
+#include <functional>
+#include <limits>
+#include <thread>
+
 TEST_F(Storage, DatabaseDoesNotExist) {
     using namespace mbgl;
 
@@ -185,6 +189,9 @@ TEST_F(Storage, DatabaseLockedWrite) {
 
     SQLiteCache cache("test/fixtures/database/locked.db");
 
+    // Commit every write right away.
+    cache.setWriteBatch(1, Duration::zero());
+
     {
         // Adds a file (which should fail).
         Log::setObserver(util::make_unique<FixtureLogObserver>());
@@ -218,11 +225,11 @@ TEST_F(Storage, DatabaseLockedWrite) {
 
         loop.invoke([&] {
             auto response = std::make_shared<Response>();
-            response->data = "Demo";
+            response->data = std::make_shared<std::string>("Demo");
             cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
             cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
                 EXPECT_NE(nullptr, res.get());
-                EXPECT_EQ("Demo", res->data);
+                EXPECT_EQ("Demo", *res->data);
                 loop.stop();
             });
         });
@@ -246,6 +253,9 @@ TEST_F(Storage, DatabaseLockedRefresh) {
 
     SQLiteCache cache("test/fixtures/database/locked.db");
 
+    // Commit every write right away.
+    cache.setWriteBatch(1, Duration::zero());
+
     // Then, lock the file and try again.
     FileLock guard("test/fixtures/database/locked.db");
 
@@ -257,7 +267,7 @@ TEST_F(Storage, DatabaseLockedRefresh) {
 
         loop.invoke([&] {
             auto response = std::make_shared<Response>();
-            response->data = "Demo";
+            response->data = std::make_shared<std::string>("Demo");
             cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
             cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
                 EXPECT_EQ(nullptr, res.get());
@@ -280,7 +290,7 @@ TEST_F(Storage, DatabaseLockedRefresh) {
 
         loop.invoke([&] {
             auto response = std::make_shared<Response>();
-            response->data = "Demo";
+            response->data = std::make_shared<std::string>("Demo");
             cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Refresh);
             cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
                 EXPECT_EQ(nullptr, res.get());
@@ -306,7 +316,10 @@ TEST_F(Storage, DatabaseDeleted) {
     createDir("test/fixtures/database");
     deleteFile("test/fixtures/database/locked.db");
 
-    SQLiteCache cache("test/fixtures/database/locked.db");
+    auto cache = util::make_unique<SQLiteCache>("test/fixtures/database/locked.db");
+
+    // Commit every write right away.
+    cache->setWriteBatch(1, Duration::zero());
 
     {
         // Adds a file.
@@ -316,11 +329,11 @@ TEST_F(Storage, DatabaseDeleted) {
 
         loop.invoke([&] {
             auto response = std::make_shared<Response>();
-            response->data = "Demo";
-            cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
-            cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
+            response->data = std::make_shared<std::string>("Demo");
+            cache->put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
+            cache->get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
                 EXPECT_NE(nullptr, res.get());
-                EXPECT_EQ("Demo", res->data);
+                EXPECT_EQ("Demo", *res->data);
                 loop.stop();
             });
         });
@@ -340,17 +353,21 @@ TEST_F(Storage, DatabaseDeleted) {
 
         loop.invoke([&] {
             auto response = std::make_shared<Response>();
-            response->data = "Demo";
-            cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
-            cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
+            response->data = std::make_shared<std::string>("Demo");
+            cache->put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
+            cache->get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
                 EXPECT_NE(nullptr, res.get());
-                EXPECT_EQ("Demo", res->data);
+                EXPECT_EQ("Demo", *res->data);
                 loop.stop();
             });
         });
 
         loop.run();
 
+        // The read may be answered before the write was attempted. Destroying the cache waits
+        // for the writes.
+        cache.reset();
+
         auto observer = Log::removeObserver();
         auto flo = dynamic_cast<FixtureLogObserver*>(observer.get());
         EXPECT_EQ(1ul, flo->count({ EventSeverity::Error, Event::Database, 8, "attempt to write a readonly database" }));
@@ -377,11 +394,11 @@ TEST_F(Storage, DatabaseInvalid) {
 
         loop.invoke([&] {
             auto response = std::make_shared<Response>();
-            response->data = "Demo";
+            response->data = std::make_shared<std::string>("Demo");
             cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
             cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
                 EXPECT_NE(nullptr, res.get());
-                EXPECT_EQ("Demo", res->data);
+                EXPECT_EQ("Demo", *res->data);
                 loop.stop();
             });
         });
@@ -393,3 +410,371 @@ TEST_F(Storage, DatabaseInvalid) {
         EXPECT_EQ(1ul, flo->count({ EventSeverity::Warning, Event::Database, -1, "Trashing invalid database" }));
     }
 }
+
+namespace {
+
+void execute(const std::string& path, const std::string& sql) {
+    sqlite3* db = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE, nullptr));
+    sqlite3_busy_timeout(db, 1000);
+    EXPECT_EQ(SQLITE_OK, sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr));
+    sqlite3_close(db);
+}
+
+int64_t count(const std::string& path) {
+    sqlite3* db = nullptr;
+    sqlite3_stmt* stmt = nullptr;
+    int64_t result = -1;
+    sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
+
+    // The cache may be writing in the meantime.
+    sqlite3_busy_timeout(db, 1000);
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM `http_cache`", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        result = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return result;
+}
+
+// Reads are answered by other threads than the writes, so they don't wait for the writes that
+// were queued before them.
+bool waitFor(std::function<bool ()> condition) {
+    for (int attempts = 0; attempts < 500; attempts++) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+}
+
+TEST_F(Storage, DatabaseEvictEntries) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/evict.db");
+    const std::string path = "test/fixtures/database/evict.db";
+
+    SQLiteCache cache(path);
+
+    // Commit every write right away.
+    cache.setWriteBatch(1, Duration::zero());
+    cache.setMaximumCacheEntries(10);
+
+    auto response = std::make_shared<Response>();
+    response->data = std::make_shared<std::string>("Demo");
+    response->expires = std::numeric_limits<int32_t>::max();
+
+    util::RunLoop loop;
+
+    loop.invoke([&] {
+        for (int i = 0; i < 10; i++) {
+            cache.put({ Resource::Unknown, "mapbox://" + std::to_string(i) }, response, FileCache::Hint::Full);
+        }
+
+        // Waits for the puts, without reading any of them.
+        EXPECT_TRUE(waitFor([&] { return count(path) == 10; }));
+
+        // 0 was accessed least recently, and 5 expired.
+        for (int i = 0; i < 10; i++) {
+            execute(path, "UPDATE `http_cache` SET `accessed` = " + std::to_string(100 + i) +
+                          " WHERE `url` = 'mapbox://" + std::to_string(i) + "'");
+        }
+        execute(path, "UPDATE `http_cache` SET `expires` = 1 WHERE `url` = 'mapbox://5'");
+
+        // Reading 0 makes 1 the least recently accessed response.
+        cache.get({ Resource::Unknown, "mapbox://0" }, [&] (std::unique_ptr<Response> res0) {
+            EXPECT_NE(nullptr, res0.get());
+
+            // Exceeding the limit evicts the expired response first, then the least recently
+            // accessed one, so that the cache shrinks to 90%.
+            cache.put({ Resource::Unknown, "mapbox://10" }, response, FileCache::Hint::Full);
+            EXPECT_TRUE(waitFor([&] { return count(path) == 9; }));
+
+            cache.get({ Resource::Unknown, "mapbox://5" }, [&] (std::unique_ptr<Response> res5) {
+                EXPECT_EQ(nullptr, res5.get());
+                cache.get({ Resource::Unknown, "mapbox://1" }, [&] (std::unique_ptr<Response> res1) {
+                    EXPECT_EQ(nullptr, res1.get());
+                    cache.get({ Resource::Unknown, "mapbox://0" }, [&] (std::unique_ptr<Response> res0b) {
+                        EXPECT_NE(nullptr, res0b.get());
+                        loop.stop();
+                    });
+                });
+            });
+        });
+    });
+
+    loop.run();
+}
+
+TEST_F(Storage, DatabaseEvictSize) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/evict_size.db");
+    const std::string path = "test/fixtures/database/evict_size.db";
+
+    const uint64_t maximumSize = 256 * 1024;
+
+    SQLiteCache cache(path);
+
+    // Commit every write right away.
+    cache.setWriteBatch(1, Duration::zero());
+
+    util::RunLoop loop;
+
+    // Images aren't compressed, and neither is this data.
+    uint32_t seed = 1;
+    const auto random = [&] {
+        std::string data(8192, '\0');
+        for (auto& c : data) {
+            seed = seed * 1103515245 + 12345;
+            c = char(seed >> 24);
+        }
+        return data;
+    };
+
+    loop.invoke([&] {
+        for (int i = 0; i < 100; i++) {
+            auto response = std::make_shared<Response>();
+            response->data = std::make_shared<std::string>(random());
+            response->expires = std::numeric_limits<int32_t>::max();
+            cache.put({ Resource::Image, "mapbox://" + std::to_string(i) }, response, FileCache::Hint::Full);
+        }
+
+        // Commits and evictions are interleaved, so the limit is set once the responses are stored.
+        EXPECT_TRUE(waitFor([&] { return count(path) == 100; }));
+        cache.setMaximumCacheSize(maximumSize);
+
+        // Evictions run in batches.
+        EXPECT_TRUE(waitFor([&] {
+            const int64_t entries = count(path);
+            return entries > 0 && entries * 8192 <= int64_t(maximumSize);
+        }));
+        loop.stop();
+    });
+
+    loop.run();
+}
+
+TEST_F(Storage, DatabaseAddAccessTimes) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/old.db");
+    const std::string path = "test/fixtures/database/old.db";
+
+    // A database created before access times were recorded.
+    execute(path, "CREATE TABLE `http_cache` ("
+                  "`url` TEXT PRIMARY KEY NOT NULL, `status` INTEGER NOT NULL, `kind` INTEGER NOT NULL, "
+                  "`modified` INTEGER, `etag` TEXT, `expires` INTEGER, `data` BLOB, "
+                  "`compressed` INTEGER NOT NULL DEFAULT 0);"
+                  "INSERT INTO `http_cache` (`url`, `status`, `kind`, `data`) "
+                  "VALUES ('mapbox://test', 1, 0, 'Demo');");
+
+    Log::setObserver(util::make_unique<FixtureLogObserver>());
+
+    SQLiteCache cache(path);
+    cache.setMaximumCacheEntries(10);
+
+    util::RunLoop loop;
+
+    loop.invoke([&] {
+        cache.get({ Resource::Unknown, "mapbox://test" }, [&] (std::unique_ptr<Response> res) {
+            ASSERT_NE(nullptr, res.get());
+            EXPECT_EQ("Demo", *res->data);
+            loop.stop();
+        });
+    });
+
+    loop.run();
+
+    // The table is migrated rather than recreated, which keeps the responses.
+    auto observer = Log::removeObserver();
+    EXPECT_TRUE(dynamic_cast<FixtureLogObserver*>(observer.get())->unchecked().empty());
+    EXPECT_EQ(1, count(path));
+}
+
+TEST_F(Storage, DatabaseWriteBatch) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/batch.db");
+    const std::string path = "test/fixtures/database/batch.db";
+
+    SQLiteCache cache(path);
+    cache.setWriteBatch(3, std::chrono::hours(1));
+
+    util::RunLoop loop;
+
+    loop.invoke([&] {
+        auto response = std::make_shared<Response>();
+        response->data = std::make_shared<std::string>("Demo");
+        response->expires = 100;
+        cache.put({ Resource::Unknown, "mapbox://a" }, response, FileCache::Hint::Full);
+
+        auto refreshed = std::make_shared<Response>();
+        refreshed->expires = 200;
+        cache.put({ Resource::Unknown, "mapbox://a" }, refreshed, FileCache::Hint::Refresh);
+        cache.put({ Resource::Unknown, "mapbox://b" }, response, FileCache::Hint::Full);
+
+        // Reads see the writes that aren't committed yet.
+        cache.get({ Resource::Unknown, "mapbox://a" }, [&, response] (std::unique_ptr<Response> res) {
+            ASSERT_NE(nullptr, res.get());
+            EXPECT_EQ("Demo", *res->data);
+            EXPECT_EQ(200, res->expires);
+            EXPECT_EQ(0, count(path));
+
+            // The third write commits all of them.
+            cache.put({ Resource::Unknown, "mapbox://c" }, response, FileCache::Hint::Full);
+            cache.get({ Resource::Unknown, "mapbox://a" }, [&] (std::unique_ptr<Response> res2) {
+                ASSERT_NE(nullptr, res2.get());
+                EXPECT_EQ(200, res2->expires);
+                EXPECT_TRUE(waitFor([&] { return count(path) == 3; }));
+                loop.stop();
+            });
+        });
+    });
+
+    loop.run();
+}
+
+TEST_F(Storage, DatabaseWriteInterval) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/interval.db");
+    const std::string path = "test/fixtures/database/interval.db";
+
+    SQLiteCache cache(path);
+    cache.setWriteBatch(100, std::chrono::milliseconds(10));
+
+    util::RunLoop loop;
+
+    std::function<void (int)> wait = [&](int attempts) {
+        cache.get({ Resource::Unknown, "mapbox://none" }, [&, attempts] (std::unique_ptr<Response>) {
+            if (count(path) < 1 && attempts > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                wait(attempts - 1);
+                return;
+            }
+            EXPECT_EQ(1, count(path));
+            loop.stop();
+        });
+    };
+
+    loop.invoke([&] {
+        auto response = std::make_shared<Response>();
+        response->data = std::make_shared<std::string>("Demo");
+        cache.put({ Resource::Unknown, "mapbox://a" }, response, FileCache::Hint::Full);
+
+        // The write is committed once it waited for long enough.
+        wait(100);
+    });
+
+    loop.run();
+}
+
+TEST_F(Storage, DatabaseWriteShutdown) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/shutdown.db");
+    const std::string path = "test/fixtures/database/shutdown.db";
+
+    {
+        SQLiteCache cache(path);
+        cache.setWriteBatch(100, std::chrono::hours(1));
+
+        util::RunLoop loop;
+
+        loop.invoke([&] {
+            auto response = std::make_shared<Response>();
+            response->data = std::make_shared<std::string>("Demo");
+            cache.put({ Resource::Unknown, "mapbox://a" }, response, FileCache::Hint::Full);
+            cache.put({ Resource::Unknown, "mapbox://b" }, response, FileCache::Hint::Full);
+            cache.get({ Resource::Unknown, "mapbox://a" }, [&] (std::unique_ptr<Response> res) {
+                EXPECT_NE(nullptr, res.get());
+                EXPECT_EQ(0, count(path));
+                loop.stop();
+            });
+        });
+
+        loop.run();
+    }
+
+    // Destroying the cache commits the pending writes.
+    EXPECT_EQ(2, count(path));
+}
+
+TEST_F(Storage, DatabaseWriteShutdownLimited) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/shutdown_limited.db");
+    const std::string path = "test/fixtures/database/shutdown_limited.db";
+
+    {
+        SQLiteCache cache(path);
+        cache.setWriteBatch(100, std::chrono::hours(1));
+        cache.setMaximumCacheEntries(2);
+
+        util::RunLoop loop;
+
+        loop.invoke([&] {
+            auto response = std::make_shared<Response>();
+            response->data = std::make_shared<std::string>("Demo");
+            cache.put({ Resource::Unknown, "mapbox://a" }, response, FileCache::Hint::Full);
+            cache.put({ Resource::Unknown, "mapbox://b" }, response, FileCache::Hint::Full);
+            cache.put({ Resource::Unknown, "mapbox://c" }, response, FileCache::Hint::Full);
+            cache.get({ Resource::Unknown, "mapbox://a" }, [&] (std::unique_ptr<Response> res) {
+                EXPECT_NE(nullptr, res.get());
+                loop.stop();
+            });
+        });
+
+        loop.run();
+    }
+
+    // The pending writes exceed the limit, which is enforced once the cache is used again.
+    EXPECT_EQ(3, count(path));
+}
+
+TEST_F(Storage, DatabaseReadWhileWriting) {
+    using namespace mbgl;
+
+    createDir("test/fixtures/database");
+    deleteFile("test/fixtures/database/wal.db");
+    const std::string path = "test/fixtures/database/wal.db";
+
+    SQLiteCache cache(path);
+    cache.setWriteBatch(1, Duration::zero());
+
+    util::RunLoop loop;
+
+    loop.invoke([&] {
+        auto response = std::make_shared<Response>();
+        response->data = std::make_shared<std::string>("Demo");
+        cache.put({ Resource::Unknown, "mapbox://test" }, response, FileCache::Hint::Full);
+        EXPECT_TRUE(waitFor([&] { return count(path) == 1; }));
+
+        // Another connection writing to the database doesn't block reads.
+        Log::setObserver(util::make_unique<FixtureLogObserver>());
+        auto guard = std::make_shared<FileLock>(path);
+
+        cache.get({ Resource::Unknown, "mapbox://test" }, [&, guard] (std::unique_ptr<Response> res) {
+            ASSERT_NE(nullptr, res.get());
+            EXPECT_EQ("Demo", *res->data);
+            loop.stop();
+        });
+    });
+
+    loop.run();
+
+    auto observer = Log::removeObserver();
+    EXPECT_TRUE(dynamic_cast<FixtureLogObserver*>(observer.get())->unchecked().empty());
+}
@@ -0,0 +1,122 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/map/environment.hpp>
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/util/async.hpp>
+
+#include <thread>
+
+TEST_F(Storage, HTTPChain) {
+    SCOPED_TEST(HTTPChain)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    Environment env(fs);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    // The second request only starts once the first one completed.
+    env.request({ Resource::Unknown, "http://127.0.0.1:3000/test" })
+        .then([&](const Response &res) {
+            EXPECT_EQ(Response::Successful, res.status);
+            EXPECT_EQ("Hello World!", *res.data);
+            return env.request({ Resource::Unknown, "http://127.0.0.1:3000/delayed" });
+        })
+        .then([](const Response &res) {
+            return *res.data;
+        })
+        .then([&](const std::string &data) {
+            EXPECT_EQ("Response", data);
+            HTTPChain.finish();
+        });
+
+    uv_run(env.loop, UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, HTTPChainCancel) {
+    SCOPED_TEST(HTTPChainCancel)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    Environment env(fs);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    auto first = env.request({ Resource::Unknown, "http://127.0.0.1:3000/test" });
+    util::Async<Response> second;
+
+    auto chain = first.then([&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        second = env.request({ Resource::Unknown, "http://127.0.0.1:3000/delayed" });
+        return second;
+    });
+
+    chain.then([&](const Response &) {
+        ADD_FAILURE() << "Canceled steps should not run";
+    });
+
+    // Canceling the chain while it waits for the second request cancels that request, and the
+    // first one, which completed already, stays resolved.
+    first.then([&](const Response &) {
+        chain.cancel();
+        EXPECT_TRUE(first.isResolved());
+        EXPECT_TRUE(second.isCanceled());
+        EXPECT_TRUE(chain.isCanceled());
+        HTTPChainCancel.finish();
+    });
+
+    uv_run(env.loop, UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, HTTPChainCancelFirst) {
+    SCOPED_TEST(HTTPChainCancelFirst)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    Environment env(fs);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    auto first = env.request({ Resource::Unknown, "http://127.0.0.1:3000/test" });
+    auto chain = first.then([&](const Response &) {
+        ADD_FAILURE() << "Canceled steps should not run";
+        return env.request({ Resource::Unknown, "http://127.0.0.1:3000/test" });
+    });
+
+    // Canceling the end of the chain cancels the pending request at its start.
+    chain.cancel();
+    EXPECT_TRUE(first.isCanceled());
+    HTTPChainCancelFirst.finish();
+
+    uv_run(env.loop, UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, HTTPChainCancelAsync) {
+    SCOPED_TEST(HTTPChainCancelAsync)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    Environment env(fs);
+    EnvironmentScope scope(env, ThreadType::Map, "Map");
+
+    auto async = env.requestAsync({ Resource::Unknown, "http://127.0.0.1:3000/delayed" });
+    async.then([&](const Response &) {
+        ADD_FAILURE() << "Canceled steps should not run";
+    });
+
+    // Requests without a loop can be canceled from any thread.
+    std::thread([&] { async.cancel(); }).join();
+    EXPECT_TRUE(async.isCanceled());
+
+    // Outlives the canceled request, had it been answered.
+    env.request({ Resource::Unknown, "http://127.0.0.1:3000/delayed" })
+        .then([&](const Response &res) {
+            EXPECT_EQ("Response", *res.data);
+            HTTPChainCancelAsync.finish();
+        });
+
+    uv_run(env.loop, UV_RUN_DEFAULT);
+}
@@ -0,0 +1,93 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/storage/default_file_source.hpp>
+
+TEST_F(Storage, HTTPPriority) {
+    SCOPED_TEST(HTTPPriority)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    fs.setMaximumConnections(1, 1);
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    const std::string prefix = "http://127.0.0.1:3000/priority/";
+    int remaining = 6;
+
+    const auto load = [&](const Resource &resource) {
+        fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+            EXPECT_EQ(Response::Successful, res.status);
+            if (--remaining) {
+                return;
+            }
+
+            // The first request was running while the others were waiting.
+            fs.request({ Resource::Unknown, prefix + "order" }, uv_default_loop(), env,
+                       [&](const Response &order) {
+                EXPECT_EQ(Response::Successful, order.status);
+                EXPECT_EQ("A,S,B,Q,P", *order.data);
+                HTTPPriority.finish();
+            });
+        });
+    };
+
+    load({ Resource::Tile, prefix + "A" });
+    load({ Resource::Tile, prefix + "P", Resource::Priority::Prefetch });
+    load({ Resource::Tile, prefix + "B" });
+    load({ Resource::Tile, prefix + "Q", Resource::Priority::Prefetch });
+    load({ Resource::JSON, prefix + "S" });
+
+    // The map needs a tile that was prefetched so far.
+    load({ Resource::Tile, prefix + "Q" });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, HTTPPriorityPerHost) {
+    SCOPED_TEST(HTTPPriorityPerHost)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    fs.setMaximumConnections(1, 2);
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    const std::string prefix = "http://127.0.0.1:3000/priority/";
+    int remaining = 5;
+
+    const auto load = [&](const Resource &resource) {
+        fs.request(resource, uv_default_loop(), env, [&](const Response &res) {
+            EXPECT_EQ(Response::Successful, res.status);
+            if (--remaining) {
+                return;
+            }
+
+            fs.request({ Resource::Unknown, prefix + "order" }, uv_default_loop(), env,
+                       [&](const Response &order) {
+                EXPECT_EQ(Response::Successful, order.status);
+
+                // The request to the other host runs alongside the first one, in either order.
+                std::string data = *order.data;
+                const std::size_t other = data.find("O,");
+                ASSERT_NE(std::string::npos, other);
+                data.erase(other, 2);
+                EXPECT_EQ("A,S,B,C", data);
+                HTTPPriorityPerHost.finish();
+            });
+        });
+    };
+
+    // The host's only connection is busy, so the style resource doesn't wait behind the other
+    // tiles in libcurl's queue.
+    load({ Resource::Tile, prefix + "A" });
+    load({ Resource::Tile, prefix + "B" });
+    load({ Resource::Tile, prefix + "C" });
+    load({ Resource::Tile, "http://localhost:3000/priority/O" });
+    load({ Resource::JSON, prefix + "S" });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
@@ -22,7 +22,7 @@ TEST_F(Storage, HTTPReading) {
                [&](const Response &res) {
         EXPECT_EQ(uv_thread_self(), mainThread);
         EXPECT_EQ(Response::Successful, res.status);
-        EXPECT_EQ("Hello World!", res.data);
+        EXPECT_EQ("Hello World!", *res.data);
         EXPECT_EQ(0, res.expires);
         EXPECT_EQ(0, res.modified);
         EXPECT_EQ("", res.etag);
@@ -33,7 +33,7 @@ TEST_F(Storage, HTTPReading) {
     fs.request({ Resource::Unknown, "http://127.0.0.1:3000/doesnotexist" }, uv_default_loop(),
                env, [&](const Response &res) {
         EXPECT_EQ(uv_thread_self(), mainThread);
-        EXPECT_EQ(Response::Error, res.status);
+        EXPECT_EQ(Response::NotFound, res.status);
         EXPECT_EQ("HTTP status code 404", res.message);
         EXPECT_EQ(0, res.expires);
         EXPECT_EQ(0, res.modified);
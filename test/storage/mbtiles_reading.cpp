@@ -0,0 +1,124 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/storage/sqlite_cache.hpp>
+
+TEST_F(Storage, MBTilesTile) {
+    SCOPED_TEST(Root)
+    SCOPED_TEST(Flipped)
+    SCOPED_TEST(Gzipped)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr, "test/fixtures/storage");
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/0/0/0" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ("Tile 0/0/0", *res.data);
+        EXPECT_EQ(0, res.expires);
+        EXPECT_EQ("", res.message);
+        Root.finish();
+    });
+
+    // The rows of MBTiles count from the bottom.
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/1/0/0.pbf" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ("Tile 1/0/0", *res.data);
+        Flipped.finish();
+    });
+
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/1/1/1" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ("Tile 1/1/1", *res.data);
+        Gzipped.finish();
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, MBTilesNotCached) {
+    SCOPED_TEST(MBTilesNotCached)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+    DefaultFileSource fs(&cache, "test/fixtures/storage");
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    // Local tiles skip the caches.
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/0/0/0" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        EXPECT_EQ("Tile 0/0/0", *res.data);
+        EXPECT_EQ(0u, fs.getMemoryCacheHits());
+        EXPECT_EQ(0u, fs.getMemoryCacheMisses());
+        MBTilesNotCached.finish();
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, MBTilesMissing) {
+    SCOPED_TEST(MBTilesMissing)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr, "test/fixtures/storage");
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    // Tiles that aren't in the file are missing, not errors, like tiles a server doesn't have.
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/1/1/0" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::NotFound, res.status);
+        EXPECT_EQ("Tile not found", res.message);
+        EXPECT_EQ("", *res.data);
+        MBTilesMissing.finish();
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
+
+TEST_F(Storage, MBTilesErrors) {
+    SCOPED_TEST(Invalid)
+    SCOPED_TEST(TooDeep)
+    SCOPED_TEST(NoFile)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr, "test/fixtures/storage");
+
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/a/0/0" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Error, res.status);
+        EXPECT_EQ("Invalid MBTiles URL", res.message);
+        Invalid.finish();
+    });
+
+    // Zoom levels beyond 30 can't be flipped to MBTiles rows.
+    fs.request({ Resource::Tile, "mbtiles://tiles.mbtiles/31/0/0" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Error, res.status);
+        EXPECT_EQ("Invalid MBTiles URL", res.message);
+        TooDeep.finish();
+    });
+
+    fs.request({ Resource::Tile, "mbtiles://does_not_exist.mbtiles/0/0/0" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Error, res.status);
+        EXPECT_EQ("unable to open database file", res.message);
+        NoFile.finish();
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+}
@@ -0,0 +1,114 @@
+#include "storage.hpp"
+
+#include <uv.h>
+
+#include <mbgl/map/environment.hpp>
+#include <mbgl/map/offline_region.hpp>
+#include <mbgl/storage/default_file_source.hpp>
+#include <mbgl/storage/sqlite_cache.hpp>
+
+namespace {
+
+mbgl::OfflineRegionDefinition definition() {
+    mbgl::OfflineRegionDefinition result;
+    result.styleURL = "http://127.0.0.1:3000/offline/style.json";
+    result.bounds = { { -80, -170 }, { 80, 170 } };
+    result.minZoom = 0;
+    result.maxZoom = 1;
+    return result;
+}
+
+// The number of requests the test server got for the offline style.
+std::string offlineRequests() {
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    auto &env = *static_cast<const Environment *>(nullptr);
+
+    std::string count;
+    fs.request({ Resource::Unknown, "http://127.0.0.1:3000/offline/requests" }, uv_default_loop(), env,
+               [&](const Response &res) {
+        EXPECT_EQ(Response::Successful, res.status);
+        count = *res.data;
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+    return count;
+}
+
+}
+
+TEST_F(Storage, OfflineRegion) {
+    SCOPED_TEST(OfflineRegionDownload)
+    SCOPED_TEST(OfflineRegionCached)
+
+    using namespace mbgl;
+
+    SQLiteCache cache(":memory:");
+
+    {
+        DefaultFileSource fs(&cache);
+        OfflineRegion region(fs, uv_default_loop(), definition());
+        region.setMaximumConcurrency(4);
+
+        uint64_t updates = 0;
+        region.download([&](const OfflineRegion::Progress &progress) {
+            EXPECT_EQ(++updates, progress.completed);
+            EXPECT_FALSE(progress.completed < progress.total && progress.complete);
+            if (progress.complete) {
+                // The style and the TileJSON, 5 vector tiles at zoom levels 0 and 1, the raster
+                // tiles of zoom level 1, which is shown at both, 2 sprite files, and the 256 glyph
+                // ranges of the font.
+                EXPECT_EQ(269u, progress.total);
+                EXPECT_EQ(269u, progress.completed);
+                EXPECT_EQ(0u, progress.failed);
+                EXPECT_LT(0u, progress.bytes);
+                OfflineRegionDownload.finish();
+            }
+        });
+
+        uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+    }
+
+    const std::string requests = offlineRequests();
+
+    {
+        // The resources are fresh in the cache now, so downloading the region again doesn't
+        // request any of them.
+        DefaultFileSource fs(&cache);
+        OfflineRegion region(fs, uv_default_loop(), definition());
+        region.download([&](const OfflineRegion::Progress &progress) {
+            if (progress.complete) {
+                EXPECT_EQ(269u, progress.completed);
+                EXPECT_EQ(0u, progress.failed);
+                OfflineRegionCached.finish();
+            }
+        });
+
+        uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+    }
+
+    EXPECT_EQ(requests, offlineRequests());
+}
+
+TEST_F(Storage, OfflineRegionCancel) {
+    SCOPED_TEST(OfflineRegionCancel)
+
+    using namespace mbgl;
+
+    DefaultFileSource fs(nullptr);
+    OfflineRegion region(fs, uv_default_loop(), definition());
+    region.setMaximumConcurrency(1);
+    region.download([&](const OfflineRegion::Progress &progress) {
+        // Once the style is loaded, the resources it uses are queued.
+        EXPECT_EQ(1u, progress.completed);
+        EXPECT_LT(1u, progress.total);
+        EXPECT_FALSE(progress.complete);
+        region.cancel();
+        OfflineRegionCancel.finish();
+    });
+
+    uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+    EXPECT_EQ(1u, region.getProgress().completed);
+}
@@ -3,6 +3,8 @@
 'use strict';
 
 var express = require('express');
+var fs = require('fs');
+var path = require('path');
 var app = express();
 
 // We're manually setting Etag headers.
@@ -92,10 +94,155 @@ app.get('/delayed', function(req, res) {
 });
 
 
+// Responses for stale-while-revalidate, which are stale right away. The first one changes every
+// time it is revalidated, the second one never does. The first one is delayed, so that the stale
+// response is delivered before the revalidated one arrives.
+var staleChangedCounter = 0;
+app.get('/stale/changed', function(req, res) {
+    res.setHeader('Cache-Control', 'must-revalidate');
+    var body = 'Response ' + (++staleChangedCounter);
+    setTimeout(function() {
+        res.send(body);
+    }, 50);
+});
+
+app.get('/stale/same', function(req, res) {
+    res.setHeader('Cache-Control', 'must-revalidate');
+    if (req.headers['if-none-match'] == 'unchanged') {
+        res.status(304).end();
+    } else {
+        res.setHeader('ETag', 'unchanged');
+        res.status(200).send('Response');
+    }
+});
+
+
+// Missing resources and empty tiles. The number of times they were requested is reported by
+// /negative/requests.
+var negativeRequests = 0;
+app.get('/negative/requests', function(req, res) {
+    res.send(String(negativeRequests));
+});
+
+app.get('/negative/missing', function(req, res) {
+    negativeRequests++;
+    res.status(404).send('Not Found');
+});
+
+app.get('/negative/empty', function(req, res) {
+    negativeRequests++;
+    res.status(204).end();
+});
+
+app.get('/negative/expiring', function(req, res) {
+    negativeRequests++;
+    res.setHeader('Cache-Control', 'max-age=120');
+    res.status(404).send('Not Found');
+});
+
+
 app.get('/load/:number(\\d+)', function(req, res) {
     res.send('Request ' + req.params.number);
 });
 
+
+// Records the order in which requests arrive, and reports it with /priority/order. Responses take
+// a while so that the requests that follow have to wait.
+var priorityOrder = [];
+app.get('/priority/order', function(req, res) {
+    res.send(priorityOrder.join(','));
+    priorityOrder = [];
+});
+
+app.get('/priority/:name', function(req, res) {
+    priorityOrder.push(req.params.name);
+    setTimeout(function() {
+        res.send('Response ' + req.params.name);
+    }, 50);
+});
+
+
+// A style for offline regions. Its resources can be cached for 30 seconds, and the number of
+// times they were requested is reported by /offline/requests.
+var offlineRequests = 0;
+function offline(res) {
+    offlineRequests++;
+    res.setHeader('Cache-Control', 'max-age=30');
+    return res;
+}
+
+app.get('/offline/requests', function(req, res) {
+    res.send(String(offlineRequests));
+});
+
+app.get('/offline/style.json', function(req, res) {
+    offline(res).json({
+        version: 7,
+        sources: {
+            vector: {
+                type: 'vector',
+                url: 'http://127.0.0.1:3000/offline/tilejson.json'
+            },
+            raster: {
+                type: 'raster',
+                tiles: [ 'http://127.0.0.1:3000/offline/raster/{z}/{x}/{y}.png' ],
+                tileSize: 256,
+                maxzoom: 1
+            }
+        },
+        sprite: 'http://127.0.0.1:3000/offline/sprite',
+        glyphs: 'http://127.0.0.1:3000/offline/glyphs/{fontstack}/{range}.pbf',
+        layers: [{
+            id: 'satellite',
+            type: 'raster',
+            source: 'raster'
+        }, {
+            id: 'labels',
+            type: 'symbol',
+            source: 'vector',
+            'source-layer': 'poi_label',
+            layout: {
+                'text-field': '{name}',
+                'text-font': 'Open Sans Regular'
+            }
+        }]
+    });
+});
+
+app.get('/offline/tilejson.json', function(req, res) {
+    offline(res).json({
+        tiles: [ 'http://127.0.0.1:3000/offline/tiles/{z}/{x}/{y}.pbf' ],
+        maxzoom: 14
+    });
+});
+
+app.get('/offline/tiles/:z/:x/:y.pbf', function(req, res) {
+    offline(res).send('Vector tile ' + req.params.z + '/' + req.params.x + '/' + req.params.y);
+});
+
+app.get('/offline/raster/:z/:x/:y.png', function(req, res) {
+    offline(res).send('Raster tile ' + req.params.z + '/' + req.params.x + '/' + req.params.y);
+});
+
+app.get('/offline/sprite.json', function(req, res) {
+    offline(res).json({});
+});
+
+app.get('/offline/sprite.png', function(req, res) {
+    offline(res).send('Sprite');
+});
+
+app.get('/offline/glyphs/:fontstack/:range.pbf', function(req, res) {
+    offline(res).send('Glyphs ' + req.params.fontstack + ' ' + req.params.range);
+});
+
+
+// The same vector tile for all coordinates, for benchmarks.
+var benchTile = fs.readFileSync(path.join(__dirname, '../fixtures/tiles/streets/0-0-0.vector.pbf'));
+app.get('/bench/tiles/:z/:x/:y', function(req, res) {
+    res.send(benchTile);
+});
+
 var server = app.listen(3000, function () {
     var host = server.address().address;
     var port = server.address().port;
@@ -40,6 +40,7 @@
 
         'headless/headless.cpp',
 
+        'miscellaneous/async.cpp',
         'miscellaneous/clip_ids.cpp',
         'miscellaneous/bilinear.cpp',
         'miscellaneous/comparisons.cpp',
@@ -47,20 +48,30 @@
         'miscellaneous/functions.cpp',
         'miscellaneous/mapbox.cpp',
         'miscellaneous/merge_lines.cpp',
+        'miscellaneous/mpsc_queue.cpp',
+        'miscellaneous/pbf.cpp',
         'miscellaneous/rotation_range.cpp',
         'miscellaneous/style_parser.cpp',
         'miscellaneous/text_conversions.cpp',
+        'miscellaneous/thread.cpp',
         'miscellaneous/tile.cpp',
+        'miscellaneous/tile_parser.cpp',
         'miscellaneous/variant.cpp',
+        'miscellaneous/vector_tile.cpp',
+        'miscellaneous/worker.cpp',
 
         'storage/storage.hpp',
         'storage/storage.cpp',
+        'storage/cache_memory.cpp',
+        'storage/cache_negative.cpp',
         'storage/cache_response.cpp',
         'storage/cache_revalidate.cpp',
+        'storage/cache_stale.cpp',
         'storage/database.cpp',
         'storage/directory_reading.cpp',
         'storage/file_reading.cpp',
         'storage/http_cancel.cpp',
+        'storage/http_chain.cpp',
         'storage/http_coalescing.cpp',
         'storage/http_environment.cpp',
         'storage/http_error.cpp',
@@ -68,7 +79,63 @@
         'storage/http_load.cpp',
         'storage/http_noloop.cpp',
         'storage/http_other_loop.cpp',
+        'storage/http_priority.cpp',
         'storage/http_reading.cpp',
+        'storage/mbtiles_reading.cpp',
+        'storage/offline_region.cpp',
+      ],
+      'libraries': [
+        '<@(uv_static_libs)',
+      ],
+      'variables': {
+        'cflags_cc': [
+          '<@(uv_cflags)',
+          '<@(opengl_cflags)',
+          '<@(boost_cflags)',
+        ],
+        'ldflags': [
+          '<@(uv_ldflags)',
+        ],
+      },
+      'conditions': [
+        ['OS == "mac"', {
+          'xcode_settings': {
+            'OTHER_CPLUSPLUSFLAGS': [ '<@(cflags_cc)' ],
+            'OTHER_LDFLAGS': [ '<@(ldflags)' ],
+          },
+        }, {
+         'cflags_cc': [ '<@(cflags_cc)' ],
+         'libraries': [ '<@(ldflags)' ],
+        }],
+      ],
+    },
+    { 'target_name': 'bench',
+      'type': 'executable',
+      'include_dirs': [ '../include', '../src' ],
+      'dependencies': [
+        'symlink_TEST_DATA',
+        '../mbgl.gyp:core',
+        '../mbgl.gyp:platform-<(platform_lib)',
+        '../mbgl.gyp:http-<(http_lib)',
+        '../mbgl.gyp:asset-<(asset_lib)',
+        '../mbgl.gyp:cache-<(cache_lib)',
+        '../deps/gtest/gtest.gyp:gtest'
+      ],
+      'sources': [
+        'fixtures/main.cpp',
+        'fixtures/util.hpp',
+        'fixtures/util.cpp',
+
+        'bench/allocations.hpp',
+        'bench/allocations.cpp',
+        'bench/fixtures.hpp',
+        'bench/fixtures.cpp',
+        'bench/file_source.cpp',
+        'bench/pbf.cpp',
+        'bench/run_loop.cpp',
+        'bench/tile_parser.cpp',
+        'bench/vector_tile.cpp',
+        'bench/worker.cpp',
       ],
       'libraries': [
         '<@(uv_static_libs)',